@@ -5,6 +5,7 @@
 #include <uplink.h>
 #include "desktop-server.h"
 #include "desktop-ui.h"
+#include <ctime>
 
 static const bool sendPingPongColorFeedback = true;
 static const bool dumpStatsPeriodically = true;
@@ -18,7 +19,38 @@ struct ExampleServerSession : DesktopServerSession
     ExampleServerSession(int socketDescriptor, Server* server)
         : DesktopServerSession(socketDescriptor, server)
     {
+        // Images are decompressed on demand below, and compressed color images are echoed back as is.
+        lazyCameraImageDecompression = true;
+    }
+
+    ~ExampleServerSession()
+    {
+        // The recorder goes away before the wire does.
+        setMessageTap(0);
+    }
+
+    void toggleRecording()
+    {
+        if (recorder.isOpen())
+        {
+            setMessageTap(0);
+
+            recorder.close();
+
+            uplink_log_info("Recording stopped: %llu messages.", (unsigned long long) recorder.numRecordedMessages());
+
+            return;
+        }
+
+        // Received messages are stored as they came, with their payloads still compressed.
+        const String path = formatted_copy("uplink-recording-%lld.skan", (long long) time(0));
+
+        if (!recorder.open(path.c_str()))
+            return;
 
+        setMessageTap(&recorder);
+
+        uplink_log_info("Recording to %s.", path.c_str());
     }
 
     void toggleExposureAndWhiteBalance()
@@ -54,7 +86,7 @@ struct ExampleServerSession : DesktopServerSession
     {
         if (command == "RecordButtonPressed")
         {
-            std::cout << "Start Recording Pressed!" << std::endl;
+            toggleRecording();
         }
         else if (command == "AutoLevelButtonPressed")
         {
@@ -89,31 +121,34 @@ struct ExampleServerSession : DesktopServerSession
 
             if (!cameraFrame.colorImage.isEmpty())
             {
-                server().ui().setColorImage(
-                    (const uint8*)cameraFrame.colorImage.planes[0].buffer,
-                    int(cameraFrame.colorImage.width),
-                    int(cameraFrame.colorImage.height)
-                    );
+                const Image& colorImage = cameraFrame.colorImage.decompressed();
+
+                server().ui().setColorImage(colorImage);
             }
 
 
             if (!cameraFrame.depthImage.isEmpty())
             {
-                uint16* depthBuffer = (uint16*)cameraFrame.depthImage.planes[0].buffer;
-                int     depthWidth = int(cameraFrame.depthImage.width);
-                int     depthHeight = int(cameraFrame.depthImage.height);
+                const Image& depthImage = cameraFrame.depthImage.decompressed();
+
+                int depthWidth = int(depthImage.width);
+                int depthHeight = int(depthImage.height);
+
+                // Convert shifts to depth values, with the table matching the sensor calibration.
+                shiftToDepth.update(depthImage.cameraInfo);
 
-                // Convert shifts to depth values.
-                shift2depth(depthBuffer, depthWidth * depthHeight);
+                depthBuffer.resize(depthWidth * depthHeight);
+
+                shiftToDepth.convert((const uint16*)depthImage.planes[0].buffer, depthBuffer.data(), depthBuffer.size());
 
                 server().ui().setDepthImage(
-                    depthBuffer,
+                    depthBuffer.data(),
                     depthWidth,
                     depthHeight
                     );
             }
 
-            // Send ping-pong feedback image.
+            // Send ping-pong feedback image. Compressed color images are sent back without recompression.
             // FIXME: This const-cast sucks.
             if (sendPingPongColorFeedback && !cameraFrame.colorImage.isEmpty())
                 //sendFeedbackImage(const_cast<Image&>(cameraFrame.colorImage));
@@ -142,6 +177,10 @@ struct ExampleServerSession : DesktopServerSession
 
         return true;
     }
+
+    ShiftToDepthTable   shiftToDepth;
+    std::vector<uint16> depthBuffer;
+    SessionRecorder     recorder;
 };
 
 //------------------------------------------------------------------------------
@@ -32,6 +32,18 @@ public:
 public:
     bool operator== (const CameraCalibration& rhs) const;
 
+public:
+    // Brown-Conrady lens model, on normalized image coordinates. Unset coefficients count as zero.
+    bool hasDistortion () const;
+    void distort   (float x, float y, float& distortedX, float& distortedY) const;
+    void undistort (float distortedX, float distortedY, float& x, float& y) const; // Iterative inversion.
+
+public:
+    // Rigid transform from the camera frame to the calibration reference frame, as a row-major rotation and a translation.
+    // Unset extrinsics give the identity.
+    bool hasExtrinsics () const;
+    void extrinsics (float rotation [9], float translation [3]) const;
+
 public:
     float fx;
     float fy;
@@ -6,6 +6,7 @@
 
 # include "./camera-calibration.h"
 # include "./core/macros.h"
+# include <algorithm>
 # include <cfloat>
 
 namespace uplink {
@@ -87,6 +88,116 @@ CameraCalibration::serializeWith (Serializer& s)
 
 # undef MEMBERS
 
+inline float
+camera_calibration_coefficient (float k)
+{
+    return -FLT_MAX == k || isnan(k) ? 0.f : k;
+}
+
+inline bool
+CameraCalibration::hasDistortion () const
+{
+    return
+           0.f != camera_calibration_coefficient(k1)
+        || 0.f != camera_calibration_coefficient(k2)
+        || 0.f != camera_calibration_coefficient(k3)
+        || 0.f != camera_calibration_coefficient(p1)
+        || 0.f != camera_calibration_coefficient(p2)
+        ;
+}
+
+inline void
+CameraCalibration::distort (float x, float y, float& distortedX, float& distortedY) const
+{
+    const float k1_ = camera_calibration_coefficient(k1);
+    const float k2_ = camera_calibration_coefficient(k2);
+    const float k3_ = camera_calibration_coefficient(k3);
+    const float p1_ = camera_calibration_coefficient(p1);
+    const float p2_ = camera_calibration_coefficient(p2);
+
+    const float r2     = x * x + y * y;
+    const float radial = 1.f + r2 * (k1_ + r2 * (k2_ + r2 * k3_));
+
+    distortedX = x * radial + 2.f * p1_ * x * y + p2_ * (r2 + 2.f * x * x);
+    distortedY = y * radial + p1_ * (r2 + 2.f * y * y) + 2.f * p2_ * x * y;
+}
+
+inline void
+CameraCalibration::undistort (float distortedX, float distortedY, float& x, float& y) const
+{
+    const float k1_ = camera_calibration_coefficient(k1);
+    const float k2_ = camera_calibration_coefficient(k2);
+    const float k3_ = camera_calibration_coefficient(k3);
+    const float p1_ = camera_calibration_coefficient(p1);
+    const float p2_ = camera_calibration_coefficient(p2);
+
+    x = distortedX;
+    y = distortedY;
+
+    // Fixed-point iteration, converging quickly for the mild distortions of depth and color cameras.
+    for (int n = 0; n < 10; ++n)
+    {
+        const float r2     = x * x + y * y;
+        const float radial = 1.f + r2 * (k1_ + r2 * (k2_ + r2 * k3_));
+
+        if (!(0.f < radial))
+            break;
+
+        const float dx = 2.f * p1_ * x * y + p2_ * (r2 + 2.f * x * x);
+        const float dy = p1_ * (r2 + 2.f * y * y) + 2.f * p2_ * x * y;
+
+        x = (distortedX - dx) / radial;
+        y = (distortedY - dy) / radial;
+    }
+}
+
+inline bool
+CameraCalibration::hasExtrinsics () const
+{
+    const float norm = qx * qx + qy * qy + qz * qz + qw * qw;
+
+    return
+           -FLT_MAX != tx && -FLT_MAX != ty && -FLT_MAX != tz
+        && -FLT_MAX != qx && -FLT_MAX != qy && -FLT_MAX != qz && -FLT_MAX != qw
+        && 0.f < norm && norm < FLT_MAX // Also excludes NANs.
+        ;
+}
+
+inline void
+CameraCalibration::extrinsics (float rotation [9], float translation [3]) const
+{
+    if (!hasExtrinsics())
+    {
+        static const float identity [9] = { 1.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f };
+
+        std::copy(identity, identity + 9, rotation);
+        std::fill(translation, translation + 3, 0.f);
+
+        return;
+    }
+
+    const float norm = std::sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+
+    const float x = qx / norm;
+    const float y = qy / norm;
+    const float z = qz / norm;
+    const float w = qw / norm;
+
+    rotation[0] = 1.f - 2.f * (y * y + z * z);
+    rotation[1] =       2.f * (x * y - z * w);
+    rotation[2] =       2.f * (x * z + y * w);
+    rotation[3] =       2.f * (x * y + z * w);
+    rotation[4] = 1.f - 2.f * (x * x + z * z);
+    rotation[5] =       2.f * (y * z - x * w);
+    rotation[6] =       2.f * (x * z - y * w);
+    rotation[7] =       2.f * (y * z + x * w);
+    rotation[8] = 1.f - 2.f * (x * x + y * y);
+
+    translation[0] = tx;
+    translation[1] = ty;
+    translation[2] = tz;
+}
+
 //------------------------------------------------------------------------------
 
 inline
@@ -44,6 +44,8 @@ ClientEndpoint::onSessionSetup(const uplink::SessionSetup &sessionSetup)
 
         currentSessionSettings = nextSessionSettings;
 
+        imageCodecs.maxShiftError = currentSessionSettings.depthCameraCodecMaxError;
+
         sendSessionSetupReply(SessionSetupReply(currentSessionId, SessionSetupStatus_Success));
     
         onSessionSetupSuccess();
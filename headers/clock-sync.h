@@ -0,0 +1,98 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./core/clocks.h"
+# include "./core/threads.h"
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// NTP-style estimate of the remote clock, from ClockSync exchanges, timestamped with getTime() on both ends.
+// Offsets are remote minus local times, and follow a linear drift, fitted over the fastest recent round trips.
+// Thread-safe.
+
+class ClockOffsetEstimator
+{
+public:
+    enum { MaxNumSamples = 32 };
+
+public:
+    ClockOffsetEstimator ();
+
+public:
+    void reset ();
+
+    // Request sent and reply received on the local clock. Request received and reply sent on the remote one.
+    void addSample (double requestSent, double requestReceived, double replySent, double replyReceived);
+
+public:
+    bool isValid () const;
+
+    double offset    (double localTime) const; // Remote minus local time, at the given local time.
+    double drift     () const; // Seconds per second.
+    double roundTrip () const; // Of the fastest recent exchange.
+
+    // Remote times, such as capture timestamps, mapped to the local clock.
+    bool localTime (double remoteTime, double& localTime) const;
+
+private:
+    struct Sample
+    {
+        double time; // Local, halfway through the exchange.
+        double offset;
+        double delay;
+    };
+
+    void fit ();
+
+private:
+    mutable Mutex mutex;
+    Sample        samples [MaxNumSamples];
+    int           numSamples;
+    int           nextSample;
+    double        referenceTime;
+    double        referenceOffset;
+    double        fittedDrift;
+    double        minDelay;
+};
+
+//------------------------------------------------------------------------------
+
+// Log-scaled histogram of latencies, from under a millisecond to over a second.
+
+class LatencyHistogram
+{
+public:
+    enum { NumBins = 12 }; // [0, 1) ms, [1, 2) ms, [2, 4) ms, ... [1024, +inf) ms.
+
+public:
+    LatencyHistogram ();
+
+public:
+    void reset ();
+    void add   (double seconds);
+
+public:
+    uint64 count      () const { return total; }
+    uint64 binCount   (int bin) const { return bins[bin]; }
+    double mean       () const; // Seconds.
+    double percentile (double fraction) const; // Upper bound of the matching bin, or the maximum, in seconds.
+
+    String toString () const;
+
+private:
+    uint64 bins [NumBins];
+    uint64 total;
+    double sum;
+    double maximum;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./clock-sync.hpp"
@@ -0,0 +1,223 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./clock-sync.h"
+# include <algorithm>
+# include <cmath>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline
+ClockOffsetEstimator::ClockOffsetEstimator ()
+{
+    reset();
+}
+
+inline void
+ClockOffsetEstimator::reset ()
+{
+    const MutexLocker _(mutex);
+
+    numSamples      = 0;
+    nextSample      = 0;
+    referenceTime   = 0.;
+    referenceOffset = 0.;
+    fittedDrift     = 0.;
+    minDelay        = 0.;
+}
+
+inline void
+ClockOffsetEstimator::addSample (double requestSent, double requestReceived, double replySent, double replyReceived)
+{
+    Sample sample;
+
+    sample.time   = .5 * (requestSent + replyReceived);
+    sample.offset = .5 * ((requestReceived - requestSent) + (replySent - replyReceived));
+    sample.delay  = std::max(0., (replyReceived - requestSent) - (replySent - requestReceived));
+
+    const MutexLocker _(mutex);
+
+    samples[nextSample] = sample;
+
+    nextSample = (nextSample + 1) % MaxNumSamples;
+    numSamples = std::min(numSamples + 1, int(MaxNumSamples));
+
+    fit();
+}
+
+inline void
+ClockOffsetEstimator::fit ()
+{
+    minDelay = samples[0].delay;
+
+    for (int n = 1; n < numSamples; ++n)
+        minDelay = std::min(minDelay, samples[n].delay);
+
+    // Slower exchanges were queued somewhere, on one way or the other, which skews their offsets.
+    const double maxDelay = 2. * minDelay + .0005;
+
+    double sumOfTimes   = 0.;
+    double sumOfOffsets = 0.;
+    int    count        = 0;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        if (maxDelay < samples[n].delay)
+            continue;
+
+        sumOfTimes   += samples[n].time;
+        sumOfOffsets += samples[n].offset;
+        ++count;
+    }
+
+    referenceTime   = sumOfTimes   / count;
+    referenceOffset = sumOfOffsets / count;
+
+    double covariance = 0.;
+    double variance   = 0.;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        if (maxDelay < samples[n].delay)
+            continue;
+
+        const double time = samples[n].time - referenceTime;
+
+        covariance += time * (samples[n].offset - referenceOffset);
+        variance   += time * time;
+    }
+
+    // Drifts need a few samples over a few seconds, and beyond a thousand parts per million, they are noise.
+    static const double maxDrift = 1e-3;
+
+    fittedDrift = 4 <= count && 1. < variance ? std::max(-maxDrift, std::min(covariance / variance, maxDrift)) : 0.;
+}
+
+inline bool
+ClockOffsetEstimator::isValid () const
+{
+    const MutexLocker _(mutex);
+
+    return 0 < numSamples;
+}
+
+inline double
+ClockOffsetEstimator::offset (double localTime) const
+{
+    const MutexLocker _(mutex);
+
+    return referenceOffset + fittedDrift * (localTime - referenceTime);
+}
+
+inline double
+ClockOffsetEstimator::drift () const
+{
+    const MutexLocker _(mutex);
+
+    return fittedDrift;
+}
+
+inline double
+ClockOffsetEstimator::roundTrip () const
+{
+    const MutexLocker _(mutex);
+
+    return minDelay;
+}
+
+inline bool
+ClockOffsetEstimator::localTime (double remoteTime, double& localTime) const
+{
+    const MutexLocker _(mutex);
+
+    return_false_unless(0 < numSamples);
+
+    // Solving: remoteTime = localTime + referenceOffset + fittedDrift * (localTime - referenceTime).
+    localTime = (remoteTime - referenceOffset + fittedDrift * referenceTime) / (1. + fittedDrift);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline
+LatencyHistogram::LatencyHistogram ()
+{
+    reset();
+}
+
+inline void
+LatencyHistogram::reset ()
+{
+    std::fill(bins, bins + NumBins, uint64(0));
+
+    total   = 0;
+    sum     = 0.;
+    maximum = 0.;
+}
+
+inline void
+LatencyHistogram::add (double seconds)
+{
+    seconds = std::max(0., seconds);
+
+    const double milliseconds = 1e3 * seconds;
+
+    const int bin = milliseconds < 1. ? 0 : std::min(1 + int(std::floor(std::log2(milliseconds))), int(NumBins) - 1);
+
+    ++bins[bin];
+    ++total;
+
+    sum    += seconds;
+    maximum = std::max(maximum, seconds);
+}
+
+inline double
+LatencyHistogram::mean () const
+{
+    return 0 == total ? 0. : sum / double(total);
+}
+
+inline double
+LatencyHistogram::percentile (double fraction) const
+{
+    return_zero_if(0 == total);
+
+    const uint64 rank = uint64(std::ceil(std::max(0., std::min(fraction, 1.)) * double(total)));
+
+    uint64 count = 0;
+
+    for (int bin = 0; bin < NumBins - 1; ++bin)
+    {
+        count += bins[bin];
+
+        if (rank <= count)
+            return std::min(1e-3 * double(1 << bin), maximum);
+    }
+
+    return maximum;
+}
+
+inline String
+LatencyHistogram::toString () const
+{
+    if (0 == total)
+        return "Latency: n/a";
+
+    return formatted_copy(
+        "Latency: %7.2f ms (median < %7.2f ms, 99%% < %7.2f ms, max %7.2f ms)",
+        1e3 * mean(),
+        1e3 * percentile(.5),
+        1e3 * percentile(.99),
+        1e3 * maximum
+    );
+}
+
+//------------------------------------------------------------------------------
+
+}
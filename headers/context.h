@@ -6,6 +6,8 @@
 
 # include "./core/platform.h"
 # include "./core/threads.h"
+# include "./core/tasks.h"
+# include "./metrics.h"
 # include <vector>
 
 namespace uplink {
@@ -17,6 +19,7 @@ class Context
 public:
     Context ()
     : _profiler(0)
+    , _tasks(0)
     {
         platform_startup();
     }
@@ -24,6 +27,7 @@ public:
 public:
     ~Context ()
     {
+        zero_delete(_tasks);
         zero_delete(_profiler);
 
         platform_shutdown();
@@ -43,6 +47,22 @@ public:
         _profiler->registerTasks();
     }
 
+public:
+    // Shared worker threads for parallel image processing, started on first use.
+    TaskPool& tasks ()
+    {
+        const MutexLocker _(_tasksCreation);
+
+        if (0 == _tasks)
+            _tasks = new TaskPool();
+
+        return *_tasks;
+    }
+
+public:
+    // Process-wide metrics, for monitoring. See: MetricsServer.
+    MetricsRegistry& metrics () { return _metrics; }
+
 public:
     void log_line (Verbosity verbosity, CString message)
     {
@@ -56,8 +76,11 @@ public:
     }
 
 private:
-    Profiler*     _profiler;
-    Mutex         _logging;
+    Profiler*       _profiler;
+    Mutex           _logging;
+    TaskPool*       _tasks;
+    Mutex           _tasksCreation;
+    MetricsRegistry _metrics;
 };
 
 //------------------------------------------------------------------------------
@@ -95,6 +118,17 @@ profiler_task_stopped (ProfilerTask task)
     profiler->taskStopped(profiler->taskIds[task]);
 }
 
+inline void
+profiler_thread_started (CString name)
+{
+    Profiler* const profiler = context.profiler();
+
+    if (0 == profiler)
+        return;
+
+    profiler->threadStarted(name);
+}
+
 inline void
 log_line (Verbosity verbosity, CString message)
 {
@@ -0,0 +1,62 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./types.h"
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// --------------------------------------
+// LOSSLESS COLOR STRIP CODING
+// --------------------------------------
+
+// Byte-oriented lossless coding of 8-bit pixels with 1, 2 or 3 channels, in the spirit of QOI.
+// Each strip of rows is coded with its own state, so strips can be encoded and decoded concurrently.
+
+// DECODE:
+// Step 0. Last pixel is initialized to 0, as well as the 64 entries of the recent pixels index.
+// Step 1. Proceed by decoding following opcodes until all pixels of the strip are decoded.
+
+// 00iiiiii - Next pixel is index[i].
+// 01dddddd - Next pixel is last pixel + small per-channel deltas.
+//            (3 channels: 2 bits each, biased by 2. 2 channels: 3 bits each, biased by 4. 1 channel: 6 bits, biased by 32.)
+// 10dddddd - Next pixel is last pixel + delta (6 bits, biased by 32) on the first channel, followed by one byte:
+//            (3 channels: 4 bits for each of the two remaining channels' deltas, relative to the first one, biased by 8.
+//             2 channels: second channel's delta, relative to the first one.)
+// 11rrrrrr - Next r + 1 pixels are same as last pixel. (r < 62)
+// 11111110 - Next pixel is given by the following channel bytes.
+
+// After decoding each opcode, except for runs, the decoded pixel is stored in index[hash(pixel)].
+
+enum { ColorStripMaxNumChannels = 3 };
+
+size_t color_strip_max_encoded_size (size_t width, size_t height, int numChannels);
+
+size_t color_strip_encode (
+    const uint8* rows,
+    size_t       bytesPerRow,
+    size_t       width,
+    size_t       height,
+    int          numChannels,
+    uint8*       output
+);
+
+bool color_strip_decode (
+    const uint8* input,
+    size_t       inputSize,
+    uint8*       rows,
+    size_t       bytesPerRow,
+    size_t       width,
+    size_t       height,
+    int          numChannels
+);
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./color-coding.hpp"
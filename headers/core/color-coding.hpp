@@ -0,0 +1,369 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./color-coding.h"
+# include <cassert>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+enum
+{
+    ColorStripOp_Index   = 0x00,
+    ColorStripOp_Diff    = 0x40,
+    ColorStripOp_Luma    = 0x80,
+    ColorStripOp_Run     = 0xc0,
+    ColorStripOp_Literal = 0xfe,
+
+    ColorStripOp_Mask    = 0xc0,
+
+    ColorStripMaxRun     = 62,
+};
+
+template < int NumChannels >
+inline uint32
+color_strip_load (const uint8* bytes)
+{
+    switch (NumChannels)
+    {
+        case 1: return bytes[0];
+        case 2: return bytes[0] | (uint32(bytes[1]) << 8);
+        default: return bytes[0] | (uint32(bytes[1]) << 8) | (uint32(bytes[2]) << 16);
+    }
+}
+
+template < int NumChannels >
+inline void
+color_strip_store (uint8* bytes, uint32 pixel)
+{
+                           bytes[0] = uint8(pixel      );
+    if (1 < NumChannels)   bytes[1] = uint8(pixel >>  8);
+    if (2 < NumChannels)   bytes[2] = uint8(pixel >> 16);
+}
+
+inline int
+color_strip_hash (uint32 pixel)
+{
+    return int((pixel & 0xff) * 3 + ((pixel >> 8) & 0xff) * 5 + ((pixel >> 16) & 0xff) * 7) & 63;
+}
+
+inline int
+color_strip_delta (uint32 pixel, uint32 last, int channel)
+{
+    return int(int8(uint8((pixel >> (8 * channel)) - (last >> (8 * channel)))));
+}
+
+inline uint32
+color_strip_add (uint32 last, int delta, int channel)
+{
+    const uint32 value = uint8((last >> (8 * channel)) + delta);
+
+    return (last & ~(uint32(0xff) << (8 * channel))) | (value << (8 * channel));
+}
+
+//------------------------------------------------------------------------------
+
+template < int NumChannels >
+inline uint8*
+color_strip_encode_pixel (uint8* output, uint32 pixel, uint32 last)
+{
+    const int d0 = color_strip_delta(pixel, last, 0);
+
+    switch (NumChannels)
+    {
+        case 1:
+        {
+            if (-32 <= d0 && d0 < 32)
+            {
+                *output++ = uint8(ColorStripOp_Diff | (d0 + 32));
+
+                return output;
+            }
+
+            break;
+        }
+
+        case 2:
+        {
+            const int d1 = color_strip_delta(pixel, last, 1);
+
+            if (-4 <= d0 && d0 < 4 && -4 <= d1 && d1 < 4)
+            {
+                *output++ = uint8(ColorStripOp_Diff | ((d0 + 4) << 3) | (d1 + 4));
+
+                return output;
+            }
+
+            if (-32 <= d0 && d0 < 32)
+            {
+                *output++ = uint8(ColorStripOp_Luma | (d0 + 32));
+                *output++ = uint8(d1 - d0); // Wraps around, like the channel values.
+
+                return output;
+            }
+
+            break;
+        }
+
+        default:
+        {
+            const int d1 = color_strip_delta(pixel, last, 1);
+            const int d2 = color_strip_delta(pixel, last, 2);
+
+            if (-2 <= d0 && d0 < 2 && -2 <= d1 && d1 < 2 && -2 <= d2 && d2 < 2)
+            {
+                *output++ = uint8(ColorStripOp_Diff | ((d0 + 2) << 4) | ((d1 + 2) << 2) | (d2 + 2));
+
+                return output;
+            }
+
+            const int d10 = d1 - d0;
+            const int d20 = d2 - d0;
+
+            if (-32 <= d0 && d0 < 32 && -8 <= d10 && d10 < 8 && -8 <= d20 && d20 < 8)
+            {
+                *output++ = uint8(ColorStripOp_Luma | (d0 + 32));
+                *output++ = uint8(((d10 + 8) << 4) | (d20 + 8));
+
+                return output;
+            }
+
+            break;
+        }
+    }
+
+    *output++ = uint8(ColorStripOp_Literal);
+
+    color_strip_store<NumChannels>(output, pixel);
+
+    return output + NumChannels;
+}
+
+template < int NumChannels >
+inline size_t
+color_strip_encode_pixels (const uint8* rows, size_t bytesPerRow, size_t width, size_t height, uint8* output)
+{
+    uint32 index [64] = { 0 };
+    uint32 last = 0;
+    int    run = 0;
+
+    uint8* const start = output;
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        const uint8* bytes = rows + y * bytesPerRow;
+
+        for (size_t x = 0; x < width; ++x, bytes += NumChannels)
+        {
+            const uint32 pixel = color_strip_load<NumChannels>(bytes);
+
+            if (pixel == last)
+            {
+                if (ColorStripMaxRun == ++run)
+                {
+                    *output++ = uint8(ColorStripOp_Run | (run - 1));
+                    run = 0;
+                }
+
+                continue;
+            }
+
+            if (0 < run)
+            {
+                *output++ = uint8(ColorStripOp_Run | (run - 1));
+                run = 0;
+            }
+
+            const int hash = color_strip_hash(pixel);
+
+            if (index[hash] == pixel)
+            {
+                *output++ = uint8(ColorStripOp_Index | hash);
+            }
+            else
+            {
+                index[hash] = pixel;
+
+                output = color_strip_encode_pixel<NumChannels>(output, pixel, last);
+            }
+
+            last = pixel;
+        }
+    }
+
+    if (0 < run)
+        *output++ = uint8(ColorStripOp_Run | (run - 1));
+
+    return size_t(output - start);
+}
+
+template < int NumChannels >
+inline bool
+color_strip_decode_pixels (const uint8* input, size_t inputSize, uint8* rows, size_t bytesPerRow, size_t width, size_t height)
+{
+    uint32 index [64] = { 0 };
+    uint32 pixel = 0;
+    int    run = 0;
+
+    const uint8* const end = input + inputSize;
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        uint8* bytes = rows + y * bytesPerRow;
+
+        for (size_t x = 0; x < width; ++x, bytes += NumChannels)
+        {
+            if (0 < run)
+            {
+                --run;
+            }
+            else
+            {
+                return_false_unless(input < end);
+
+                const int op = *input++;
+
+                if (ColorStripOp_Literal == op)
+                {
+                    return_false_unless(input + NumChannels <= end);
+
+                    pixel = color_strip_load<NumChannels>(input);
+                    input += NumChannels;
+                }
+                else switch (op & ColorStripOp_Mask)
+                {
+                    case ColorStripOp_Index:
+                    {
+                        pixel = index[op];
+
+                        break;
+                    }
+
+                    case ColorStripOp_Diff:
+                    {
+                        switch (NumChannels)
+                        {
+                            case 1:
+                                pixel = color_strip_add(pixel, (op & 0x3f) - 32, 0);
+                                break;
+
+                            case 2:
+                                pixel = color_strip_add(pixel, ((op >> 3) & 0x7) - 4, 0);
+                                pixel = color_strip_add(pixel, ( op       & 0x7) - 4, 1);
+                                break;
+
+                            default:
+                                pixel = color_strip_add(pixel, ((op >> 4) & 0x3) - 2, 0);
+                                pixel = color_strip_add(pixel, ((op >> 2) & 0x3) - 2, 1);
+                                pixel = color_strip_add(pixel, ( op       & 0x3) - 2, 2);
+                                break;
+                        }
+
+                        break;
+                    }
+
+                    case ColorStripOp_Luma:
+                    {
+                        return_false_unless(1 < NumChannels && input < end);
+
+                        const int d0   = (op & 0x3f) - 32;
+                        const int next = *input++;
+
+                        pixel = color_strip_add(pixel, d0, 0);
+
+                        if (2 == NumChannels)
+                        {
+                            pixel = color_strip_add(pixel, d0 + int(int8(uint8(next))), 1);
+                        }
+                        else
+                        {
+                            pixel = color_strip_add(pixel, d0 + (next >> 4) - 8, 1);
+                            pixel = color_strip_add(pixel, d0 + (next & 0xf) - 8, 2);
+                        }
+
+                        break;
+                    }
+
+                    default: // ColorStripOp_Run
+                    {
+                        run = op & 0x3f;
+
+                        break;
+                    }
+                }
+
+                index[color_strip_hash(pixel)] = pixel;
+            }
+
+            color_strip_store<NumChannels>(bytes, pixel);
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline size_t
+color_strip_max_encoded_size (size_t width, size_t height, int numChannels)
+{
+    // Literal pixels are the worst case: one opcode byte, followed by the channel bytes.
+    return width * height * (1 + numChannels);
+}
+
+inline size_t
+color_strip_encode (
+    const uint8* rows,
+    size_t       bytesPerRow,
+    size_t       width,
+    size_t       height,
+    int          numChannels,
+    uint8*       output
+)
+{
+    assert(0 != rows);
+    assert(0 != output);
+
+    switch (numChannels)
+    {
+        case 1: return color_strip_encode_pixels<1>(rows, bytesPerRow, width, height, output);
+        case 2: return color_strip_encode_pixels<2>(rows, bytesPerRow, width, height, output);
+        case 3: return color_strip_encode_pixels<3>(rows, bytesPerRow, width, height, output);
+    }
+
+    assert(false); // Unsupported channel count.
+
+    return 0;
+}
+
+inline bool
+color_strip_decode (
+    const uint8* input,
+    size_t       inputSize,
+    uint8*       rows,
+    size_t       bytesPerRow,
+    size_t       width,
+    size_t       height,
+    int          numChannels
+)
+{
+    assert(0 != input);
+    assert(0 != rows);
+
+    switch (numChannels)
+    {
+        case 1: return color_strip_decode_pixels<1>(input, inputSize, rows, bytesPerRow, width, height);
+        case 2: return color_strip_decode_pixels<2>(input, inputSize, rows, bytesPerRow, width, height);
+        case 3: return color_strip_decode_pixels<3>(input, inputSize, rows, bytesPerRow, width, height);
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+
+}
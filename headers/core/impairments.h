@@ -0,0 +1,123 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./platform.h"
+# include "./threads.h"
+# include <deque>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Simulated network conditions, for reproducible performance tests.
+// Specifications are comma-separated key=value lists, such as: bandwidth=20,latency=30,jitter=10,stall-every=2000,stall-for=250
+//     bandwidth    Link rate, in megabits per second. Zero means unlimited.
+//     burst        Token bucket depth, in kilobytes.
+//     latency      One-way delay, in milliseconds.
+//     jitter       Extra delay, uniformly drawn in [0, jitter] milliseconds. Byte order is preserved.
+//     stall-every  Mean interval between link stalls, in milliseconds. Zero disables stalls.
+//     stall-for    Stall duration, in milliseconds.
+//     seed         Seed of the jitter and stall draws, which are identical from one run to the next.
+
+struct NetworkImpairment
+{
+    NetworkImpairment ();
+
+    bool parse (const String& specification);
+
+    String toString () const;
+
+    bool isNone () const;
+
+    double bytesPerSecond;
+    Size   burstSize;
+    double latency;       // Seconds.
+    double jitter;        // Seconds.
+    double stallInterval; // Seconds.
+    double stallDuration; // Seconds.
+    uint32 seed;
+};
+
+//------------------------------------------------------------------------------
+
+// Connection decorator, imposing a network impairment on the bytes written to the wrapped connection.
+// Writes go through a token bucket, capping the bandwidth, then through a delay line, drained by a forwarding thread.
+// Reads are left untouched: wrap both ends of a wire to impair both directions.
+// Takes ownership of the wrapped connection. Wires stop decorated connections like any other.
+
+class ImpairedConnection : public TCPConnection
+{
+public:
+    // At most this many bytes wait in the delay line, after which writes block, as they would on a full socket buffer.
+    enum { MaxNumBytesInFlight = 8 * 1024 * 1024 };
+
+public:
+     ImpairedConnection (TCPConnection* connection, const NetworkImpairment& impairment);
+    ~ImpairedConnection ();
+
+public:
+    virtual bool read      (Byte* bytes, Size size);
+    virtual Size available () const;
+
+    virtual bool write (const Byte* bytes, Size size);
+
+    virtual void disconnect ();
+
+public:
+    const NetworkImpairment& getImpairment () const { return impairment; }
+
+private:
+    struct Chunk
+    {
+        Buffer bytes;
+        double due;
+    };
+
+    struct Forwarder : Thread
+    {
+        Forwarder (ImpairedConnection* that) : Thread("uplink::ImpairedConnection::Forwarder"), that(that) {}
+
+        virtual void run () { that->forward(); }
+
+        ImpairedConnection* that;
+    };
+
+private:
+    bool   acquire      (Size size);
+    double stalledUntil (double time);
+    void   forward      ();
+
+    static double draw (uint32& state); // In [0, 1).
+
+private:
+    TCPConnection* const    connection;
+    const NetworkImpairment impairment;
+
+    // Written by the writing thread only.
+    double tokens;
+    double lastRefill;
+    double lastDue;
+    uint32 jitterState;
+
+    Mutex             mutex;
+    Condition         queued;
+    Condition         forwarded;
+    std::deque<Chunk> chunks;
+    Size              numBytesInFlight;
+    double            stallStart;
+    double            stallEnd;
+    uint32            stallState;
+    bool              failed;
+    Forwarder         forwarder;
+
+    non_copyable(ImpairedConnection)
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./impairments.hpp"
@@ -0,0 +1,350 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./impairments.h"
+# include "./clocks.h"
+# include <algorithm>
+# include <cstdlib>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline
+NetworkImpairment::NetworkImpairment ()
+    : bytesPerSecond(0.)
+    , burstSize(64 * 1024)
+    , latency(0.)
+    , jitter(0.)
+    , stallInterval(0.)
+    , stallDuration(0.)
+    , seed(1)
+{
+}
+
+inline bool
+NetworkImpairment::parse (const String& specification)
+{
+    NetworkImpairment parsed;
+
+    for (size_t begin = 0; begin < specification.size();)
+    {
+        size_t end = specification.find(',', begin);
+
+        if (String::npos == end)
+            end = specification.size();
+
+        const String entry = specification.substr(begin, end - begin);
+
+        begin = end + 1;
+
+        if (entry.empty())
+            continue;
+
+        const size_t equal = entry.find('=');
+
+        if (String::npos == equal)
+        {
+            uplink_log_error("Invalid network impairment: %s", entry.c_str());
+
+            return false;
+        }
+
+        const String key  = entry.substr(0, equal);
+        const String text = entry.substr(equal + 1);
+
+        char* last = 0;
+
+        const double value = std::strtod(text.c_str(), &last);
+
+        if (text.empty() || '\0' != *last || value < 0.)
+        {
+            uplink_log_error("Invalid network impairment value: %s", entry.c_str());
+
+            return false;
+        }
+
+        if      ("bandwidth"   == key) parsed.bytesPerSecond = value * 1e6 / 8.;
+        else if ("burst"       == key) parsed.burstSize      = std::max(Size(1), Size(value * 1024.));
+        else if ("latency"     == key) parsed.latency        = value * 1e-3;
+        else if ("jitter"      == key) parsed.jitter         = value * 1e-3;
+        else if ("stall-every" == key) parsed.stallInterval  = value * 1e-3;
+        else if ("stall-for"   == key) parsed.stallDuration  = value * 1e-3;
+        else if ("seed"        == key) parsed.seed           = uint32(value);
+        else
+        {
+            uplink_log_error("Unknown network impairment: %s", key.c_str());
+
+            return false;
+        }
+    }
+
+    *this = parsed;
+
+    return true;
+}
+
+inline String
+NetworkImpairment::toString () const
+{
+    return formatted_copy(
+        "bandwidth=%g,burst=%g,latency=%g,jitter=%g,stall-every=%g,stall-for=%g,seed=%u",
+        bytesPerSecond * 8. / 1e6,
+        double(burstSize) / 1024.,
+        latency * 1e3,
+        jitter * 1e3,
+        stallInterval * 1e3,
+        stallDuration * 1e3,
+        unsigned(seed)
+    );
+}
+
+inline bool
+NetworkImpairment::isNone () const
+{
+    return
+           0. == bytesPerSecond
+        && 0. == latency
+        && 0. == jitter
+        && (0. == stallInterval || 0. == stallDuration)
+        ;
+}
+
+//------------------------------------------------------------------------------
+
+inline
+ImpairedConnection::ImpairedConnection (TCPConnection* connection, const NetworkImpairment& impairment)
+    : connection(connection)
+    , impairment(impairment)
+    , tokens(double(impairment.burstSize))
+    , lastRefill(getTime())
+    , lastDue(0.)
+    , jitterState(0 != impairment.seed ? impairment.seed : 1)
+    , numBytesInFlight(0)
+    , stallStart(0.)
+    , stallEnd(0.)
+    , stallState(impairment.seed ^ 0x9e3779b9u)
+    , failed(false)
+    , forwarder(this)
+{
+    assert(0 != connection);
+
+    if (0. < impairment.stallInterval && 0. < impairment.stallDuration)
+    {
+        stallStart = lastRefill + impairment.stallInterval * (.5 + draw(stallState));
+        stallEnd   = stallStart + impairment.stallDuration;
+    }
+
+    forwarder.start();
+}
+
+inline
+ImpairedConnection::~ImpairedConnection ()
+{
+    disconnect();
+
+    forwarder.join();
+
+    delete connection;
+}
+
+inline bool
+ImpairedConnection::read (Byte* bytes, Size size)
+{
+    return connection->read(bytes, size);
+}
+
+inline Size
+ImpairedConnection::available () const
+{
+    return connection->available();
+}
+
+inline bool
+ImpairedConnection::write (const Byte* bytes, Size size)
+{
+    assert(0 != bytes);
+    assert(0 < size);
+
+    if (impairment.isNone())
+        return connection->write(bytes, size);
+
+    while (0 < size)
+    {
+        const Size count = 0. < impairment.bytesPerSecond ? std::min(size, impairment.burstSize) : size;
+
+        return_false_unless(acquire(count));
+
+        // Jitter never reorders bytes, as on a stream transport.
+        const double due = std::max(getTime() + impairment.latency + impairment.jitter * draw(jitterState), lastDue);
+
+        lastDue = due;
+
+        {
+            const MutexLocker _(mutex);
+
+            chunks.push_back(Chunk());
+            chunks.back().bytes.assign(bytes, bytes + count);
+            chunks.back().due = due;
+
+            numBytesInFlight += count;
+
+            queued.signal();
+        }
+
+        bytes += count;
+        size  -= count;
+    }
+
+    return true;
+}
+
+inline void
+ImpairedConnection::disconnect ()
+{
+    TCPConnection::disconnect();
+
+    connection->disconnect();
+
+    const MutexLocker _(mutex);
+
+    queued.broadcast();
+    forwarded.broadcast();
+}
+
+inline bool
+ImpairedConnection::acquire (Size size)
+{
+    for (;;)
+    {
+        report_false_if("impaired connection: write: disconnecting", disconnecting);
+
+        double wait = 0.;
+
+        {
+            const MutexLocker _(mutex);
+
+            return_false_if(failed);
+
+            const double now = getTime();
+            const double until = stalledUntil(now);
+
+            if (now < until)
+            {
+                // No tokens accumulate while the link is stalled.
+                wait = until - now;
+                lastRefill = std::max(lastRefill, until);
+            }
+            else if (0 < numBytesInFlight && MaxNumBytesInFlight < numBytesInFlight + size)
+            {
+                forwarded.waitLocked(&mutex);
+
+                continue;
+            }
+            else if (0. < impairment.bytesPerSecond)
+            {
+                tokens = std::min(double(impairment.burstSize), tokens + std::max(0., now - lastRefill) * impairment.bytesPerSecond);
+                lastRefill = std::max(lastRefill, now);
+
+                if (tokens < double(size))
+                    wait = (double(size) - tokens) / impairment.bytesPerSecond;
+                else
+                    tokens -= double(size);
+            }
+        }
+
+        if (0. == wait)
+            return true;
+
+        // Sleeping in slices, so that disconnections are noticed.
+        Thread::sleep(float(std::min(wait, .01)));
+    }
+}
+
+inline double
+ImpairedConnection::stalledUntil (double time)
+{
+    // Assuming the mutex is already locked.
+
+    if (stallStart == stallEnd)
+        return time; // Stalls are disabled.
+
+    // Stalls follow one another in the same order, and at the same offsets, whatever the callers.
+    while (stallEnd <= time)
+    {
+        stallStart = stallEnd + impairment.stallInterval * (.5 + draw(stallState));
+        stallEnd   = stallStart + impairment.stallDuration;
+    }
+
+    return stallStart <= time ? stallEnd : time;
+}
+
+inline double
+ImpairedConnection::draw (uint32& state)
+{
+    // Xorshift, for identical sequences on all platforms.
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state <<  5;
+
+    return double(state) / 4294967296.;
+}
+
+inline void
+ImpairedConnection::forward ()
+{
+    for (;;)
+    {
+        Chunk chunk;
+        double wait = 0.;
+
+        {
+            const MutexLocker _(mutex);
+
+            while (!disconnecting && chunks.empty())
+                queued.waitLocked(&mutex);
+
+            return_if(disconnecting);
+
+            const double now = getTime();
+            const double due = std::max(chunks.front().due, stalledUntil(now));
+
+            if (now < due)
+            {
+                wait = due - now;
+            }
+            else
+            {
+                std::swap(chunk, chunks.front());
+
+                chunks.pop_front();
+            }
+        }
+
+        if (0. < wait)
+        {
+            Thread::sleep(float(std::min(wait, .01)));
+
+            continue;
+        }
+
+        const bool written = connection->write(chunk.bytes.data(), chunk.bytes.size());
+
+        const MutexLocker _(mutex);
+
+        numBytesInFlight -= chunk.bytes.size();
+
+        failed = failed || !written;
+
+        forwarded.broadcast();
+
+        return_if(failed);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,116 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./types.h"
+# include "./macros.h"
+# include <atomic>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Metric values, updated without locking from any thread. See: MetricsRegistry.
+
+class MetricCounter
+{
+public:
+    MetricCounter () : count(0) {}
+
+public:
+    void add (uint64 amount = 1) { count.fetch_add(amount, std::memory_order_relaxed); }
+
+    // Mirrors counts kept elsewhere, from collectors.
+    void set (uint64 value) { count.store(value, std::memory_order_relaxed); }
+
+    uint64 value () const { return count.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64> count;
+
+    non_copyable(MetricCounter)
+};
+
+//------------------------------------------------------------------------------
+
+class MetricGauge
+{
+public:
+    MetricGauge () : current(0.) {}
+
+public:
+    void set (double value) { current.store(value, std::memory_order_relaxed); }
+    void add (double amount);
+
+    double value () const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current;
+
+    non_copyable(MetricGauge)
+};
+
+//------------------------------------------------------------------------------
+
+// HDR-style histogram of durations: four linear sub-buckets per power of two, from one microsecond to a minute.
+// Relative errors stay under 25% over the whole range, and recording never allocates.
+
+class MetricHistogram
+{
+public:
+    enum
+    {
+        NumSubBucketsPerOctave = 4,
+        NumOctaves             = 26, // 2^26 microseconds: 67 seconds.
+        NumBuckets             = 1 + NumOctaves * NumSubBucketsPerOctave + 1, // Under a microsecond, octaves, overflow.
+    };
+
+public:
+    MetricHistogram ();
+
+public:
+    void add (double seconds);
+
+    void reset ();
+
+public:
+    uint64 count      () const { return total.load(std::memory_order_relaxed); }
+    double sum        () const; // Seconds.
+    uint64 bucket     (int index) const { return buckets[index].load(std::memory_order_relaxed); }
+    double percentile (double fraction) const; // Upper bound of the matching bucket, in seconds.
+
+    static double upperBound (int index); // Seconds. Infinite for the overflow bucket.
+
+private:
+    static int bucketOf (double seconds);
+
+private:
+    std::atomic<uint64> buckets [NumBuckets];
+    std::atomic<uint64> total;
+    std::atomic<uint64> nanoseconds;
+
+    non_copyable(MetricHistogram)
+};
+
+//------------------------------------------------------------------------------
+
+// Traffic of all TCP connections, as counted by the platform socket implementations.
+
+struct SocketMetrics
+{
+    MetricCounter bytesRead;
+    MetricCounter bytesWritten;
+    MetricCounter reads;   // System calls.
+    MetricCounter writes;  // System calls.
+    MetricCounter selects; // System calls, waiting for the sockets to be readable or writable.
+};
+
+SocketMetrics& socket_metrics ();
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./metrics.hpp"
@@ -0,0 +1,134 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./metrics.h"
+# include <cmath>
+# include <limits>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline void
+MetricGauge::add (double amount)
+{
+    double value = current.load(std::memory_order_relaxed);
+
+    while (!current.compare_exchange_weak(value, value + amount, std::memory_order_relaxed))
+        ; // The value was reloaded.
+}
+
+//------------------------------------------------------------------------------
+
+inline
+MetricHistogram::MetricHistogram ()
+{
+    reset();
+}
+
+inline void
+MetricHistogram::reset ()
+{
+    for (int n = 0; n < NumBuckets; ++n)
+        buckets[n].store(0, std::memory_order_relaxed);
+
+    total.store(0, std::memory_order_relaxed);
+    nanoseconds.store(0, std::memory_order_relaxed);
+}
+
+inline int
+MetricHistogram::bucketOf (double seconds)
+{
+    const double microseconds = 1e6 * seconds;
+
+    if (!(1. <= microseconds)) // Also catches NaNs.
+        return 0;
+
+    int exponent = 0;
+
+    const double mantissa = std::frexp(microseconds, &exponent); // In [.5, 1).
+
+    const int octave = exponent - 1;
+
+    if (NumOctaves <= octave)
+        return NumBuckets - 1;
+
+    const int subBucket = std::min(int((2. * mantissa - 1.) * NumSubBucketsPerOctave), int(NumSubBucketsPerOctave) - 1);
+
+    return 1 + octave * NumSubBucketsPerOctave + subBucket;
+}
+
+inline double
+MetricHistogram::upperBound (int index)
+{
+    if (0 == index)
+        return 1e-6;
+
+    if (NumBuckets - 1 <= index)
+        return std::numeric_limits<double>::infinity();
+
+    const int octave    = (index - 1) / NumSubBucketsPerOctave;
+    const int subBucket = (index - 1) % NumSubBucketsPerOctave;
+
+    return 1e-6 * std::ldexp(1. + double(subBucket + 1) / NumSubBucketsPerOctave, octave);
+}
+
+inline void
+MetricHistogram::add (double seconds)
+{
+    buckets[bucketOf(seconds)].fetch_add(1, std::memory_order_relaxed);
+
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    if (0. < seconds)
+        nanoseconds.fetch_add(uint64(1e9 * seconds), std::memory_order_relaxed);
+}
+
+inline double
+MetricHistogram::sum () const
+{
+    return 1e-9 * double(nanoseconds.load(std::memory_order_relaxed));
+}
+
+inline double
+MetricHistogram::percentile (double fraction) const
+{
+    uint64 counts [NumBuckets];
+    uint64 count = 0;
+
+    for (int n = 0; n < NumBuckets; ++n)
+        count += counts[n] = bucket(n);
+
+    return_zero_if(0 == count);
+
+    const uint64 rank = std::max(uint64(1), uint64(std::ceil(std::max(0., std::min(fraction, 1.)) * double(count))));
+
+    uint64 cumulated = 0;
+
+    for (int n = 0; n < NumBuckets; ++n)
+    {
+        cumulated += counts[n];
+
+        if (rank <= cumulated)
+            return upperBound(n);
+    }
+
+    return upperBound(NumBuckets - 1);
+}
+
+//------------------------------------------------------------------------------
+
+inline SocketMetrics&
+socket_metrics ()
+{
+    static SocketMetrics instance;
+
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -32,6 +32,7 @@
 # include "./streams.h"
 # include "./logging.h"
 # include "./profiling.h"
+# include "./metrics.h"
 # include "./memory.h"
 
 namespace uplink {
@@ -65,6 +66,10 @@ public:
     static TCPConnection* connect (CString host, uint16 port);
     static TCPConnection* create  (int descriptor);
 
+public:
+    // Makes pending and subsequent reads and writes fail, from any thread.
+    virtual void disconnect ();
+
 public:
     bool disconnecting;
 };
@@ -196,6 +201,7 @@ bool IsCurrentThread (const Thread& thread);
 // Conditions
 Condition* ConditionCreate();
 void ConditionWait(Condition* condition, Mutex* mutex);
+void ConditionWaitFor(Condition* condition, Mutex* mutex, float seconds); // Also returns on timeout.
 void ConditionSignal(Condition* condition);
 void ConditionBroadcast (Condition* condition);
 void ConditionDestroy(Condition* condition);
@@ -19,6 +19,12 @@ TCPConnection::~TCPConnection ()
 {
 }
 
+inline void
+TCPConnection::disconnect ()
+{
+    disconnecting = true;
+}
+
 inline TCPConnection*
 TCPConnection::connect (CString host, uint16 port)
 {
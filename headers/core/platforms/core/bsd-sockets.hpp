@@ -325,15 +325,26 @@ TCPConnection_create (int descriptor)
     setsockopt(descriptor, SOL_SOCKET, SO_NOSIGPIPE, &val, sizeof(int));
 
 
-    // Set TCP_NODELAY in hopes of having lower latency streaming.
-    int flag = 1;
-    int result = setsockopt(descriptor,       /* socket descriptor */
+    // Local stream sockets, such as socket pairs, carry connections too, but have no TCP options.
+    sockaddr_storage address;
+    socklen_t        addressSize = sizeof(address);
+
+    const bool isLocal = 0 == getsockname(descriptor, (sockaddr*) &address, &addressSize) && AF_UNIX == address.ss_family;
+
+    int result = 0;
+
+    if (!isLocal)
+    {
+        // Set TCP_NODELAY in hopes of having lower latency streaming.
+        int flag = 1;
+        result = setsockopt(descriptor,       /* socket descriptor */
                              IPPROTO_TCP,     /* set option at TCP level */
                              TCP_NODELAY,     /* name of option */
                              (char *) &flag,  /* the cast is historical cruft */
                              sizeof(int));    /* length of option value */
 
-    report_zero_if(ERROR_MESSAGE("set TCP nodelay socket option"), result < 0);
+        report_zero_if(ERROR_MESSAGE("set TCP nodelay socket option"), result < 0);
+    }
 
     {
         struct timeval tv;
@@ -380,6 +391,8 @@ BSDTCPConnection::read (Byte* bytes, Size size)
 
         const int status = select_single_read(socket.fd, 100);
 
+        socket_metrics().selects.add();
+
         if (0 == status)
         {
             continue; // Nothing to read, yet.
@@ -392,6 +405,8 @@ BSDTCPConnection::read (Byte* bytes, Size size)
 
         const ssize_t count = ::read(socket.fd, bytes, size);
 
+        socket_metrics().reads.add();
+
         if (0 == count)
         {
             uplink_log_error("connection: read: EOF");
@@ -403,6 +418,8 @@ BSDTCPConnection::read (Byte* bytes, Size size)
             return false;
         }
 
+        socket_metrics().bytesRead.add(uint64(count));
+
         size  -= count;
         bytes += count;
     }
@@ -425,6 +442,8 @@ BSDTCPConnection::write (const Byte* bytes, Size size)
 
         const int status = select_single_write(socket.fd, 100);
 
+        socket_metrics().selects.add();
+
         if (0 == status)
         {
             continue; // Cannot write just yet.
@@ -438,6 +457,8 @@ BSDTCPConnection::write (const Byte* bytes, Size size)
 
         const ssize_t count = ::write(socket.fd, bytes, size);
 
+        socket_metrics().writes.add();
+
         if (0 == count)
         {
             uplink_log_error("connection: write failed: EOF");
@@ -451,6 +472,8 @@ BSDTCPConnection::write (const Byte* bytes, Size size)
             return false;
         }
 
+        socket_metrics().bytesWritten.add(uint64(count));
+
         size  -= count;
         bytes += count;
     }
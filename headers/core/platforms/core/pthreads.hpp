@@ -4,6 +4,7 @@
 
 # include <stdlib.h>
 # include <unistd.h>
+# include <sys/time.h>
 
 namespace uplink { namespace platform {
 
@@ -28,6 +29,20 @@ inline void ConditionWait(Condition* condition, Mutex* mutex)
     pthread_cond_wait(condition, mutex);
 }
 
+inline void ConditionWaitFor(Condition* condition, Mutex* mutex, float seconds)
+{
+    timeval now;
+    gettimeofday(&now, 0);
+
+    const long nanoseconds = 1000L * now.tv_usec + long(1e9 * (seconds - float(int(seconds))));
+
+    timespec deadline;
+    deadline.tv_sec  = now.tv_sec + int(seconds) + nanoseconds / 1000000000L;
+    deadline.tv_nsec = nanoseconds % 1000000000L;
+
+    pthread_cond_timedwait(condition, mutex, &deadline);
+}
+
 inline void ConditionSignal(Condition* condition)
 {
     pthread_cond_signal(condition);
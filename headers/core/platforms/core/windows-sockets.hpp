@@ -204,6 +204,8 @@ WindowsTCPConnection::read (Byte* bytes, Size size)
 
         const int status = select_single_read(socket.fd, 100);
 
+        socket_metrics().selects.add();
+
         if (0 == status)
         {
             uplink_log_debug("TCPConnection: Nothing to read, yet.");
@@ -218,6 +220,8 @@ WindowsTCPConnection::read (Byte* bytes, Size size)
 //        const ssize_t count = ::read(descriptor, bytes, size);
         const int count = recv(socket.fd, reinterpret_cast<char*>(bytes), int(size), 0);
 
+        socket_metrics().reads.add();
+
         if (0 == count)
         {
             uplink_log_error("TCPConnection: read: EOF");
@@ -229,6 +233,8 @@ WindowsTCPConnection::read (Byte* bytes, Size size)
             return false;
         }
 
+        socket_metrics().bytesRead.add(uint64(count));
+
         size  -= count;
         bytes += count;
 
@@ -251,6 +257,8 @@ WindowsTCPConnection::write (const Byte* bytes, Size size)
 
         const int status = select_single_write(socket.fd, 100);
 
+        socket_metrics().selects.add();
+
         if (0 == status)
         {
             uplink_log_debug("TCPConnection: Cannot write, yet.");
@@ -264,6 +272,8 @@ WindowsTCPConnection::write (const Byte* bytes, Size size)
         // const ssize_t count = ::write(descriptor, bytes, size);
         const int count = send(socket.fd, reinterpret_cast<const char*>(bytes), int(size), 0);
 
+        socket_metrics().writes.add();
+
         if (0 == count)
         {
             uplink_log_error("TCPConnection: write: EOF");
@@ -275,6 +285,8 @@ WindowsTCPConnection::write (const Byte* bytes, Size size)
             return false;
         }
 
+        socket_metrics().bytesWritten.add(uint64(count));
+
         size  -= count;
         bytes += count;
 
@@ -32,6 +32,12 @@ ConditionWait (Condition* condition, Mutex* mutex)
     SleepConditionVariableCS(condition, mutex, INFINITE);
 }
 
+inline void
+ConditionWaitFor (Condition* condition, Mutex* mutex, float seconds)
+{
+    SleepConditionVariableCS(condition, mutex, DWORD(1e3f * seconds));
+}
+
 inline void
 ConditionSignal (Condition* condition)
 {
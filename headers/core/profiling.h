@@ -34,6 +34,7 @@ enum ProfilerTask {
 
 void profiler_task_started (ProfilerTask task);
 void profiler_task_stopped (ProfilerTask task);
+void profiler_thread_started (CString name);
 
 struct ScopedProfiledTask
 {
@@ -80,6 +81,9 @@ struct Profiler
     virtual void taskStarted (int identifier) = 0;
     virtual void taskStopped (int identifier) = 0;
 
+    // Called from each uplink thread, as it starts running.
+    virtual void threadStarted (CString name) {}
+
     std::vector<int> taskIds;
 };
 
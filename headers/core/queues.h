@@ -24,6 +24,8 @@ public:
         OneEveryTenDroppingStrategy
     };
 
+    static const int NumDroppingStrategies = OneEveryTenDroppingStrategy + 1;
+
 public:
     Queue ();
     ~Queue ();
@@ -38,10 +40,14 @@ public:
 public:
     void isEmpty ();
     float getUsageRatio () const;
+    int getSize () const;
+    uint64 getNumDropped () const; // Since construction.
+    uint64 getNumDropped (DroppingStrategy strategy) const; // Since construction, by that strategy. Shrinking the queue drops the oldest items.
 
 public:
     void setMaximumSize (int newMaximumSize);
     void setDroppingStategy (DroppingStrategy newStrategy);
+    DroppingStrategy getDroppingStrategy () const { return droppingStrategy; }
 
 public:
     void reset ();
@@ -66,6 +72,7 @@ private:
     mutable Mutex    mutex;
     int              count; // C++98 allows for o(n) std::list size implementations.
     Items            items;
+    uint64           numDropped [NumDroppingStrategies];
 
 private:
     int              maximumSize;
@@ -42,6 +42,7 @@ Queue () // Do not drop anything by default.
 , maximumSize(0)
 , droppingStrategy(RandomOneDroppingStrategy)
 {
+    std::fill(numDropped, numDropped + NumDroppingStrategies, uint64(0));
 }
 
 QUEUE_METHOD()
@@ -96,7 +97,38 @@ getUsageRatio () const
 {
     const MutexLocker _(mutex);
     
-    return 0 == count ? 0.f : float(count) / float(maximumSize);
+    return 0 == count || 0 == maximumSize ? 0.f : float(count) / float(maximumSize); // Unbounded queues are never full.
+}
+
+QUEUE_METHOD(int)
+getSize () const
+{
+    const MutexLocker _(mutex);
+
+    return count;
+}
+
+QUEUE_METHOD(uint64)
+getNumDropped () const
+{
+    const MutexLocker _(mutex);
+
+    uint64 total = 0;
+
+    for (int n = 0; n < NumDroppingStrategies; ++n)
+        total += numDropped[n];
+
+    return total;
+}
+
+QUEUE_METHOD(uint64)
+getNumDropped (DroppingStrategy strategy) const
+{
+    assert(0 <= strategy && strategy < NumDroppingStrategies);
+
+    const MutexLocker _(mutex);
+
+    return numDropped[strategy];
 }
 
 QUEUE_METHOD(void)
@@ -112,6 +144,7 @@ setMaximumSize (int newMaximumSize)
         std::advance(i, excess);
         items.erase(items.begin(), i);
         count = newMaximumSize;
+        numDropped[OldestOneDroppingStrategy] += excess;
     }
     
     maximumSize = newMaximumSize;
@@ -173,7 +206,13 @@ push (Item& newItem)
         
         // Zero-limit means: do not ever drop anything.
         if (0 < maximumSize && count == maximumSize)
+        {
+            const int previousCount = count;
+
             drop();
+
+            numDropped[droppingStrategy] += previousCount - count;
+        }
         
         items.splice(items.end(), tmp);
         
@@ -190,7 +229,7 @@ dropRandomly (int howMany)
     
     while (0 < howMany)
     {
-        const int index = int(float(rand()) / float(RAND_MAX + 1) * float(count));
+        const int index = int(float(rand()) / (float(RAND_MAX) + 1.f) * float(count));
         ItemsIterator i = items.begin();
         std::advance(i, index);
         items.erase(i); // FIXME: Recycle node.
@@ -95,6 +95,9 @@ struct Reader : Serializer
     virtual bool  putBytes (Byte* bytes , Size size) { return readBytes(bytes, size); }
     virtual bool readBytes (Byte* bytes , Size size) = 0;
 
+    // See InputStream::lend.
+    virtual const Byte* lendBytes (Size size, uplink_ref<void>& owner) { return 0; }
+
     bool read (Serializable& serializable);
 
     bool readMagic (CString magic);
@@ -117,6 +120,8 @@ struct InputStreamReader : Reader
 
     virtual bool readBytes (Byte* bytes , Size size);
 
+    virtual const Byte* lendBytes (Size size, uplink_ref<void>& owner);
+
     bool readAll (Buffer& buffer);
 
     bool   owned;
@@ -234,6 +234,13 @@ InputStreamReader::readBytes (Byte* bytes, Size size)
     return input->read(bytes, size);
 }
 
+inline const Byte*
+InputStreamReader::lendBytes (Size size, uplink_ref<void>& owner)
+{
+    return_zero_if(0 == size); // Nothing to lend.
+    return input->lend(size, owner);
+}
+
 inline bool
 InputStreamReader::readAll (Buffer& buffer)
 {
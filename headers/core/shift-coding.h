@@ -0,0 +1,85 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./types.h"
+# include "./bitstream.h"
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// -----------------------------------------------
+// NEAR-LOSSLESS DEPTH FRAME COMPRESSION
+// -----------------------------------------------
+
+// Shifts are predicted from the last reconstructed value, and prediction errors are quantized
+// with a step of 2 * maxError + 1, so that every reconstructed shift is within maxError of the original.
+// Zero shifts (no depth) are always reconstructed exactly.
+
+// The quantized deltas are coded with the OCC prefix code, delta units being quantization steps:
+
+// 00 - Next value is same as last value.
+// 11 - Next value is last value + 1 step.
+// 10 - Next value is last value - 1 step.
+// 010 - bbbbb - Next N values are same as last value.  (N - 5 encoded w/ 5 bits)
+// 0111 - bbbbbbbbbbb - Next value is X.  (X encoded w/ 11 bits)
+// 01101 - Next value is last value + 2 steps.
+// 01100 - Next value is last value - 2 steps.
+
+// With a maximum error of zero, the bitstream is identical to the lossless OCC one.
+
+enum { MaxShiftValue = 0x7ff }; // Shifts are 11-bit values.
+
+uint32 encode_near_lossless (const uint16* input, int numElements, uint8* output, uint32 outputSize, int maxError);
+
+bool decode_near_lossless (const uint8* input, uint32 inputSize, int numElements, uint16* output, int maxError);
+
+//------------------------------------------------------------------------------
+
+// -----------------------------------------------
+// RANS DEPTH FRAME COMPRESSION
+// -----------------------------------------------
+
+// Same delta and repeat modelling as the OCC code, with symbols entropy-coded by two interleaved
+// byte-wise rANS coders, using frequency tables computed for, and stored along, each frame.
+
+// Symbols:
+//  0 .. 30 - Next value is last value + (symbol - 15). Symbol 15 is a single repeat.
+//       31 - Next value is X.  (X stored as 16 raw bits)
+//  32 .. 46 - Next N values are same as last value, with 2^k <= N < 2^(k+1) and k = symbol - 31.
+//            (N - 2^k stored as k raw bits)
+
+// Raw bits are stored in their own stream, after the rANS one.
+
+// Stream layout, all integers being little-endian:
+//
+//     uint8  version
+//     uint8  probability bits
+//     uint16 symbol frequencies [RANSNumSymbols]
+//     uint32 number of symbols
+//     uint32 rANS stream size in bytes
+//     uint32 raw bits stream size in bytes
+//     rANS stream bytes
+//     raw bits stream bytes
+
+enum
+{
+    RANSNumSymbols       = 47,
+    RANSProbabilityBits  = 12,
+    RANSProbabilityScale = 1 << RANSProbabilityBits,
+};
+
+size_t rans_max_encoded_size (int numElements);
+
+uint32 encode_rans (const uint16* input, int numElements, uint8* output, uint32 outputSize);
+
+bool decode_rans (const uint8* input, uint32 inputSize, int numElements, uint16* output);
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./shift-coding.hpp"
@@ -0,0 +1,568 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./shift-coding.h"
+# include <cassert>
+# include <cstring>
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline void
+put_repeats (bitstream_t* bs, int numRepeats)
+{
+    while (0 < numRepeats)
+    {
+        if (numRepeats <= 4)
+        {
+            bs_put(bs, 0x0, uint8(2 * numRepeats)); // 00 for each repeat.
+
+            numRepeats = 0;
+        }
+        else
+        {
+            // We never encode less than 5, since multiple 2-bit single repeats are cheaper, then.
+            // We're only using 5 bits, so we can't encode more than 31 + 5 at once.
+            const int numberToEncode = std::min(numRepeats - 5, 31);
+
+            bs_put(bs, 0x2, 3); // 010
+            bs_put(bs, uint8(numberToEncode), 5);
+
+            numRepeats -= numberToEncode + 5;
+        }
+    }
+}
+
+inline uint32
+encode_near_lossless (const uint16* input, int numElements, uint8* output, uint32 outputSize, int maxError)
+{
+    assert(0 <= maxError);
+
+    const int step = 2 * maxError + 1;
+
+    int last       = 0;
+    int numRepeats = 0;
+
+    bitstream_t bs;
+    bs_init(&bs);
+    bs_attach(&bs, output, outputSize);
+
+    for (int n = 0; n < numElements; ++n)
+    {
+        const int value = input[n];
+        const int delta = value - last;
+
+        int steps = 0 <= delta
+            ?  ((delta + maxError) / step)
+            : -((maxError - delta) / step)
+            ;
+
+        int reconstructed = last + steps * step;
+
+        // Missing depth must stay missing, and measured depth must not become missing.
+        const bool representable = 0 == value
+            ? 0 == reconstructed
+            : 0 < reconstructed && reconstructed <= MaxShiftValue
+            ;
+
+        if (0 == steps && representable)
+        {
+            ++numRepeats;
+
+            continue;
+        }
+
+        put_repeats(&bs, numRepeats);
+        numRepeats = 0;
+
+        if (!representable || steps < -2 || 2 < steps)
+        {
+            bs_put(&bs, 0x7, 4); // 0111
+            bs_put(&bs, uint8(value >> 8), 3);
+            bs_put(&bs, uint8(value), 8);
+
+            reconstructed = value;
+        }
+        else if (1 == steps || -1 == steps)
+        {
+            bs_put(&bs, 1 == steps ? 0x3 : 0x2, 2); // 11, 10
+        }
+        else
+        {
+            bs_put(&bs, 2 == steps ? 0xd : 0xc, 5); // 01101, 01100
+        }
+
+        last = reconstructed;
+    }
+
+    put_repeats(&bs, numRepeats);
+
+    bs_flush(&bs);
+
+    return uint32(bs_bytes_used(&bs));
+}
+
+// Whether a bitstream ending at end has that many bits left to read.
+inline bool
+bs_has_bits (const bitstream_t& bs, const uint8* end, int numBits)
+{
+    return numBits <= 8 * (end - bs.pos) - (8 - int(bs.remain));
+}
+
+inline bool
+decode_near_lossless (const uint8* input, uint32 inputSize, int numElements, uint16* output, int maxError)
+{
+    assert(0 <= maxError);
+
+    const int step = 2 * maxError + 1;
+
+    int last = 0;
+
+    bitstream_t bs;
+    bs_init(&bs);
+    bs_attach(&bs, const_cast<uint8*>(input), int(inputSize));
+
+    const uint8* const end = input + inputSize;
+
+    // Each field is checked against the bits left before it is read, as codes span up to 15 bits.
+    while (0 < numElements)
+    {
+        report_false_unless("Truncated depth bitstream.", bs_has_bits(bs, end, 2));
+
+        const uint8 bit0 = bs_get(&bs, 1);
+        const uint8 bit1 = bs_get(&bs, 1);
+
+        if (0 == bit0 && 0 == bit1) // 00
+        {
+            *output++ = uint16(last);
+            --numElements;
+
+            continue;
+        }
+
+        if (1 == bit0) // 11, 10
+        {
+            last += 1 == bit1 ? step : -step;
+
+            *output++ = uint16(last);
+            --numElements;
+
+            continue;
+        }
+
+        report_false_unless("Truncated depth bitstream.", bs_has_bits(bs, end, 1));
+
+        if (0 == bs_get(&bs, 1)) // 010
+        {
+            report_false_unless("Truncated depth bitstream.", bs_has_bits(bs, end, 5));
+
+            const int numRepeats = bs_get(&bs, 5) + 5;
+
+            report_false_unless("Invalid depth bitstream repeat count.", numRepeats <= numElements);
+
+            std::fill(output, output + numRepeats, uint16(last));
+            output      += numRepeats;
+            numElements -= numRepeats;
+
+            continue;
+        }
+
+        report_false_unless("Truncated depth bitstream.", bs_has_bits(bs, end, 1));
+
+        if (0 == bs_get(&bs, 1)) // 0110
+        {
+            report_false_unless("Truncated depth bitstream.", bs_has_bits(bs, end, 1));
+
+            last += 1 == bs_get(&bs, 1) ? 2 * step : -2 * step;
+        }
+        else // 0111
+        {
+            report_false_unless("Truncated depth bitstream.", bs_has_bits(bs, end, 11));
+
+            const int high = bs_get(&bs, 3);
+
+            last = (high << 8) | bs_get(&bs, 8);
+        }
+
+        *output++ = uint16(last);
+        --numElements;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+enum
+{
+    RANSVersion       = 1,
+    RANSHeaderSize    = 2 + 2 * RANSNumSymbols + 3 * 4,
+    RANSMaxDelta      = 15,
+    RANSRepeatSymbol  = RANSMaxDelta,
+    RANSResetSymbol   = 2 * RANSMaxDelta + 1,
+    RANSMaxRunLength  = 0xffff,
+};
+
+static const uint32 RANSLowerBound = uint32(1) << 23;
+
+struct RANSBitWriter
+{
+    explicit RANSBitWriter (std::vector<uint8>& bytes)
+    : bytes(bytes)
+    , bits(0)
+    , numBits(0)
+    {
+    }
+
+    void put (uint32 value, int count)
+    {
+        bits |= uint64(value) << numBits;
+        numBits += count;
+
+        while (8 <= numBits)
+        {
+            bytes.push_back(uint8(bits));
+            bits >>= 8;
+            numBits -= 8;
+        }
+    }
+
+    void flush ()
+    {
+        if (0 < numBits)
+            bytes.push_back(uint8(bits));
+
+        bits = 0;
+        numBits = 0;
+    }
+
+    std::vector<uint8>& bytes;
+    uint64              bits;
+    int                 numBits;
+};
+
+struct RANSBitReader
+{
+    RANSBitReader (const uint8* begin, const uint8* end)
+    : pos(begin)
+    , end(end)
+    , bits(0)
+    , numBits(0)
+    {
+    }
+
+    bool get (int count, uint32& value)
+    {
+        while (numBits < count)
+        {
+            return_false_if(pos == end);
+
+            bits |= uint64(*pos++) << numBits;
+            numBits += 8;
+        }
+
+        value = uint32(bits & ((uint64(1) << count) - 1));
+        bits >>= count;
+        numBits -= count;
+
+        return true;
+    }
+
+    const uint8* pos;
+    const uint8* end;
+    uint64       bits;
+    int          numBits;
+};
+
+inline void rans_put16 (uint8*& bytes, uint32 value) { bytes[0] = uint8(value); bytes[1] = uint8(value >> 8); bytes += 2; }
+inline void rans_put32 (uint8*& bytes, uint32 value) { rans_put16(bytes, value & 0xffff); rans_put16(bytes, value >> 16); }
+
+inline uint32 rans_get16 (const uint8*& bytes) { const uint32 value = bytes[0] | (uint32(bytes[1]) << 8); bytes += 2; return value; }
+inline uint32 rans_get32 (const uint8*& bytes) { const uint32 low = rans_get16(bytes); return low | (rans_get16(bytes) << 16); }
+
+inline void
+rans_tokenize (const uint16* input, int numElements, std::vector<uint8>& symbols, RANSBitWriter& raw)
+{
+    int last = 0;
+
+    for (int n = 0; n < numElements;)
+    {
+        const int value = input[n];
+
+        if (value == last)
+        {
+            int length = 1;
+
+            while (n + length < numElements && length < RANSMaxRunLength && input[n + length] == last)
+                ++length;
+
+            if (1 == length)
+            {
+                symbols.push_back(uint8(RANSRepeatSymbol));
+            }
+            else
+            {
+                int k = 1;
+                while ((2 << k) <= length)
+                    ++k;
+
+                symbols.push_back(uint8(RANSResetSymbol + k));
+                raw.put(uint32(length - (1 << k)), k);
+            }
+
+            n += length;
+
+            continue;
+        }
+
+        const int delta = value - last;
+
+        if (-RANSMaxDelta <= delta && delta <= RANSMaxDelta)
+        {
+            symbols.push_back(uint8(delta + RANSMaxDelta));
+        }
+        else
+        {
+            symbols.push_back(uint8(RANSResetSymbol));
+            raw.put(uint32(value), 16);
+        }
+
+        last = value;
+        ++n;
+    }
+}
+
+// Scales symbol counts to frequencies summing to the probability scale, keeping every used symbol representable.
+inline void
+rans_normalize (const uint32 counts [RANSNumSymbols], uint32 total, uint32 frequencies [RANSNumSymbols])
+{
+    uint32 sum     = 0;
+    int    largest = 0;
+
+    for (int n = 0; n < RANSNumSymbols; ++n)
+    {
+        frequencies[n] = 0 == counts[n]
+            ? 0
+            : std::max(uint32(1), uint32(uint64(counts[n]) * RANSProbabilityScale / total))
+            ;
+
+        sum += frequencies[n];
+
+        if (frequencies[largest] < frequencies[n])
+            largest = n;
+    }
+
+    frequencies[largest] += RANSProbabilityScale;
+    frequencies[largest] -= sum;
+}
+
+inline size_t
+rans_max_encoded_size (int numElements)
+{
+    // At most two rANS bytes and two raw bytes per symbol, plus the flushed states and the header.
+    return RANSHeaderSize + 4 * size_t(numElements) + 8 + 1;
+}
+
+inline uint32
+encode_rans (const uint16* input, int numElements, uint8* output, uint32 outputSize)
+{
+    std::vector<uint8> symbols;
+    symbols.reserve(numElements);
+
+    std::vector<uint8> rawBytes;
+    rawBytes.reserve(numElements / 4);
+
+    RANSBitWriter raw(rawBytes);
+    rans_tokenize(input, numElements, symbols, raw);
+    raw.flush();
+
+    uint32 counts      [RANSNumSymbols] = { 0 };
+    uint32 frequencies [RANSNumSymbols] = { 0 };
+    uint32 starts      [RANSNumSymbols] = { 0 };
+
+    for (size_t n = 0; n < symbols.size(); ++n)
+        ++counts[symbols[n]];
+
+    if (!symbols.empty())
+        rans_normalize(counts, uint32(symbols.size()), frequencies);
+
+    for (int n = 1; n < RANSNumSymbols; ++n)
+        starts[n] = starts[n - 1] + frequencies[n - 1];
+
+    // The rANS stream is written backwards, from the last symbol to the first one.
+    std::vector<uint8> ransBytes(2 * symbols.size() + 8);
+
+    uint8* const ransEnd = ransBytes.data() + ransBytes.size();
+    uint8*       ransPos = ransEnd;
+
+    uint32 states [2] = { RANSLowerBound, RANSLowerBound };
+
+    for (size_t n = symbols.size(); 0 < n--;)
+    {
+        const int    symbol    = symbols[n];
+        const uint32 frequency = frequencies[symbol];
+        const uint32 maxState  = ((RANSLowerBound >> RANSProbabilityBits) << 8) * frequency;
+
+        uint32& state = states[n & 1];
+
+        while (maxState <= state)
+        {
+            *--ransPos = uint8(state);
+            state >>= 8;
+        }
+
+        state = ((state / frequency) << RANSProbabilityBits) + (state % frequency) + starts[symbol];
+    }
+
+    // Flush the second state first, so that the decoder reads the first one first.
+    for (int n = 1; 0 <= n; --n)
+    {
+        ransPos -= 4;
+
+        uint8* bytes = ransPos;
+        rans_put32(bytes, states[n]);
+    }
+
+    const size_t ransSize  = size_t(ransEnd - ransPos);
+    const size_t totalSize = RANSHeaderSize + ransSize + rawBytes.size();
+
+    report_zero_unless("rANS output buffer is too small.", totalSize <= outputSize);
+
+    uint8* bytes = output;
+
+    *bytes++ = uint8(RANSVersion);
+    *bytes++ = uint8(RANSProbabilityBits);
+
+    for (int n = 0; n < RANSNumSymbols; ++n)
+        rans_put16(bytes, frequencies[n]);
+
+    rans_put32(bytes, uint32(symbols.size()));
+    rans_put32(bytes, uint32(ransSize));
+    rans_put32(bytes, uint32(rawBytes.size()));
+
+    std::memcpy(bytes, ransPos, ransSize);
+    bytes += ransSize;
+
+    if (!rawBytes.empty())
+        std::memcpy(bytes, rawBytes.data(), rawBytes.size());
+
+    return uint32(totalSize);
+}
+
+inline bool
+decode_rans (const uint8* input, uint32 inputSize, int numElements, uint16* output)
+{
+    report_false_unless("Truncated rANS depth stream.", RANSHeaderSize <= inputSize);
+
+    const uint8* bytes = input;
+
+    const int version         = *bytes++;
+    const int probabilityBits = *bytes++;
+
+    report_false_unless("Unsupported rANS depth stream.", RANSVersion == version && RANSProbabilityBits == probabilityBits);
+
+    uint32 frequencies [RANSNumSymbols];
+    uint32 starts      [RANSNumSymbols];
+    uint8  slots       [RANSProbabilityScale];
+
+    uint32 sum = 0;
+
+    for (int n = 0; n < RANSNumSymbols; ++n)
+    {
+        frequencies[n] = rans_get16(bytes);
+        starts[n] = sum;
+
+        report_false_unless("Invalid rANS depth stream frequencies.", sum + frequencies[n] <= RANSProbabilityScale);
+
+        std::memset(slots + sum, n, frequencies[n]);
+
+        sum += frequencies[n];
+    }
+
+    const uint32 numSymbols = rans_get32(bytes);
+    const uint32 ransSize   = rans_get32(bytes);
+    const uint32 rawSize    = rans_get32(bytes);
+
+    report_false_unless("Truncated rANS depth stream.", uint64(RANSHeaderSize) + ransSize + rawSize <= inputSize);
+
+    if (0 == numSymbols)
+        return 0 == numElements;
+
+    report_false_unless("Invalid rANS depth stream.", RANSProbabilityScale == sum && 8 <= ransSize);
+
+    const uint8*       ransPos = bytes;
+    const uint8* const ransEnd = bytes + ransSize;
+
+    RANSBitReader raw(ransEnd, ransEnd + rawSize);
+
+    uint32 states [2];
+    states[0] = rans_get32(ransPos);
+    states[1] = rans_get32(ransPos);
+
+    int last = 0;
+
+    for (uint32 n = 0; n < numSymbols; ++n)
+    {
+        uint32& state = states[n & 1];
+
+        const uint32 slot   = state & (RANSProbabilityScale - 1);
+        const int    symbol = slots[slot];
+
+        state = frequencies[symbol] * (state >> RANSProbabilityBits) + slot - starts[symbol];
+
+        while (state < RANSLowerBound)
+        {
+            report_false_if("Truncated rANS depth stream.", ransPos == ransEnd);
+
+            state = (state << 8) | *ransPos++;
+        }
+
+        if (symbol < RANSResetSymbol)
+        {
+            report_false_unless("Invalid rANS depth stream.", 0 < numElements);
+
+            last += symbol - RANSMaxDelta;
+
+            *output++ = uint16(last);
+            --numElements;
+        }
+        else if (RANSResetSymbol == symbol)
+        {
+            uint32 value = 0;
+
+            report_false_unless("Invalid rANS depth stream.", 0 < numElements && raw.get(16, value));
+
+            last = int(value);
+
+            *output++ = uint16(last);
+            --numElements;
+        }
+        else
+        {
+            const int k = symbol - RANSResetSymbol;
+
+            uint32 extra = 0;
+
+            report_false_unless("Invalid rANS depth stream.", raw.get(k, extra));
+
+            const int length = (1 << k) + int(extra);
+
+            report_false_unless("Invalid rANS depth stream repeat count.", length <= numElements);
+
+            std::fill(output, output + length, uint16(last));
+            output      += length;
+            numElements -= length;
+        }
+    }
+
+    return 0 == numElements;
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -4,7 +4,7 @@
 
 #pragma once
 
-// FIXME: Dynamically compute the table with the camera info data, instead of using this fixed one.
+// NOTE: This fixed table matches the default calibration. See ShiftToDepthTable for calibrated conversions.
 
 # include "./types.h"
 
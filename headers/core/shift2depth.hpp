@@ -7,7 +7,7 @@
 # include "./shift2depth.h"
 # include "./macros.h"
 
-// FIXME: Dynamically compute the table with the camera info data, instead of using this fixed one.
+// NOTE: This fixed table matches the default calibration. See ShiftToDepthTable for calibrated conversions.
 
 namespace uplink {
 
@@ -24,6 +24,10 @@ public:
 public:
     virtual bool read (Byte* bytes, Size size) = 0;
     virtual Size available () const { return UnknownSize; }
+
+    // Streams over memory outliving them may lend the next bytes, instead of copying them.
+    // The owner keeps the lent bytes valid. Zero when the stream cannot lend.
+    virtual const Byte* lend (Size size, uplink_ref<void>& owner) { return 0; }
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./threads.h"
+# include <functional>
+# include <deque>
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// A fixed set of worker threads draining a shared task queue.
+// Threads waiting for a batch of tasks run pending tasks themselves, so batches may be nested.
+
+class TaskPool
+{
+public:
+    typedef std::function<void ()> Task;
+
+public:
+    explicit TaskPool (int numWorkers = -1); // Negative: one worker per additional hardware thread.
+            ~TaskPool ();
+
+public:
+    // Runs body(0) ... body(count - 1), possibly concurrently, and returns once they all completed.
+    void parallelFor (int count, const std::function<void (int)>& body);
+
+    // Runs the task later, on one of the workers.
+    void post (const Task& task);
+
+    int numWorkers () const { return int(workers.size()); }
+
+private:
+    struct Worker;
+
+    bool runPendingTask ();
+
+private:
+    Mutex                mutex;
+    Condition            pending;
+    Condition            completed;
+    std::deque<Task>     tasks;
+    std::vector<Worker*> workers;
+    bool                 stopping;
+
+    non_copyable(TaskPool)
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./tasks.hpp"
@@ -0,0 +1,187 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./tasks.h"
+# include <thread>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+struct TaskPool::Worker : Thread
+{
+    explicit Worker (TaskPool* pool)
+    : Thread("uplink::TaskPool::Worker")
+    , pool(pool)
+    {
+    }
+
+    virtual void run ()
+    {
+        while (true)
+        {
+            Task task;
+
+            {
+                const MutexLocker lock(pool->mutex);
+
+                while (pool->tasks.empty() && !pool->stopping)
+                    pool->pending.waitLocked(&pool->mutex);
+
+                if (pool->tasks.empty())
+                    return; // Stopping, and nothing is left to run.
+
+                task.swap(pool->tasks.front());
+                pool->tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    TaskPool* pool;
+};
+
+//------------------------------------------------------------------------------
+
+inline
+TaskPool::TaskPool (int numWorkers)
+: stopping(false)
+{
+    if (numWorkers < 0)
+    {
+        const int numHardwareThreads = int(std::thread::hardware_concurrency());
+
+        numWorkers = 1 < numHardwareThreads ? numHardwareThreads - 1 : 1;
+    }
+
+    for (int n = 0; n < numWorkers; ++n)
+    {
+        Worker* worker = new Worker(this);
+
+        workers.push_back(worker);
+
+        worker->start();
+    }
+}
+
+inline
+TaskPool::~TaskPool ()
+{
+    {
+        const MutexLocker lock(mutex);
+
+        stopping = true;
+
+        pending.broadcast();
+    }
+
+    // Workers drain the remaining tasks before stopping.
+    // Joining them first keeps them whole until their threads have returned, even the ones that did not get to run yet.
+    for (size_t n = 0; n < workers.size(); ++n)
+    {
+        workers[n]->join();
+
+        delete workers[n];
+    }
+}
+
+inline void
+TaskPool::parallelFor (int count, const std::function<void (int)>& body)
+{
+    if (count < 2 || workers.empty())
+    {
+        for (int n = 0; n < count; ++n)
+            body(n);
+
+        return;
+    }
+
+    int remaining = count - 1;
+
+    {
+        const MutexLocker lock(mutex);
+
+        for (int n = 1; n < count; ++n)
+        {
+            tasks.push_back([this, &body, &remaining, n] ()
+            {
+                body(n);
+
+                const MutexLocker lock(mutex);
+
+                --remaining;
+
+                completed.broadcast();
+            });
+        }
+
+        pending.broadcast();
+    }
+
+    body(0);
+
+    // Help with the pending tasks, then wait for the ones still running elsewhere.
+    while (true)
+    {
+        {
+            const MutexLocker lock(mutex);
+
+            if (0 == remaining)
+                return;
+
+            if (tasks.empty())
+            {
+                completed.waitLocked(&mutex);
+
+                continue;
+            }
+        }
+
+        runPendingTask();
+    }
+}
+
+inline void
+TaskPool::post (const Task& task)
+{
+    if (workers.empty())
+    {
+        task();
+
+        return;
+    }
+
+    const MutexLocker lock(mutex);
+
+    tasks.push_back(task);
+
+    pending.signal();
+}
+
+inline bool
+TaskPool::runPendingTask ()
+{
+    Task task;
+
+    {
+        const MutexLocker lock(mutex);
+
+        if (tasks.empty())
+            return false;
+
+        task.swap(tasks.front());
+        tasks.pop_front();
+    }
+
+    task();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+}
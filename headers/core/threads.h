@@ -49,6 +49,18 @@ struct Condition
         platform::ConditionWait(handle, mutex->handle);
     }
 
+    // The mutex must already be locked by the caller, which avoids missing notifications sent in-between.
+    void waitLocked (Mutex* mutex)
+    {
+        platform::ConditionWait(handle, mutex->handle);
+    }
+
+    // Same as waitLocked, giving up after the given duration.
+    void waitLockedFor (Mutex* mutex, float seconds)
+    {
+        platform::ConditionWaitFor(handle, mutex->handle, seconds);
+    }
+
     void signal ()
     {
         platform::ConditionSignal(handle);
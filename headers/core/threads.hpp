@@ -82,6 +82,10 @@ Thread::main (void* data)
         pthread_setname_np(that->name);
 # endif
 
+# if UPLINK_PROFILE
+    profiler_thread_started(that->name);
+# endif
+
     {
         const MutexLocker lock (that->mutex);
 
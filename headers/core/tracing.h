@@ -0,0 +1,81 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./platform.h"
+# include "./profiling.h"
+# include "./threads.h"
+# include <atomic>
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Built-in profiler, recording task start and stop events into per-thread rings of the most recent events.
+// Recording is lock-free, and timestamps are the platform monotonic ticks. Traces are dumped on demand,
+// in the Chrome trace event format, which both about:tracing and Perfetto load.
+// Tasks are only recorded in UPLINK_PROFILE builds. Install with Context::setProfiler.
+
+class TracingProfiler : public Profiler
+{
+public:
+    enum { DefaultNumEventsPerThread = 1 << 16 };
+
+public:
+    explicit TracingProfiler (size_t numEventsPerThread = DefaultNumEventsPerThread);
+    virtual ~TracingProfiler ();
+
+public:
+    virtual int  registerTask  (CString name, CString label);
+    virtual void taskStarted   (int identifier);
+    virtual void taskStopped   (int identifier);
+    virtual void threadStarted (CString name);
+
+public:
+    // Safe to call while recording. Events overwritten during the dump are left out.
+    String chromeTrace      () const;
+    bool   writeChromeTrace (CString path) const;
+
+    void clear ();
+
+private:
+    struct Event
+    {
+        int64 ticks;
+        int32 task;
+        int32 started;
+    };
+
+    struct Ring
+    {
+        Ring (size_t size, int threadId) : events(size), count(0), clearedAt(0), threadId(threadId) {}
+
+        std::vector<Event>  events;
+        std::atomic<uint64> count;     // Written by the owning thread only.
+        std::atomic<uint64> clearedAt; // Events before it are ignored.
+        int                 threadId;
+        String              threadName;
+    };
+
+private:
+    Ring& currentRing ();
+    void  record      (int identifier, bool started);
+
+private:
+    const uint64        instance; // Tells apart the rings of successive profilers, in thread-local storage.
+    mutable Mutex       mutex;
+    std::vector<Ring*>  rings;
+    std::vector<String> taskNames;
+    size_t              numEventsPerThread;
+
+    non_copyable(TracingProfiler)
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./tracing.hpp"
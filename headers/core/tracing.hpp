@@ -0,0 +1,229 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./tracing.h"
+# include <cstdio>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+inline uint64
+tracing_profiler_next_instance ()
+{
+    static std::atomic<uint64> next(1);
+
+    return next++;
+}
+
+inline String
+tracing_profiler_escaped (const String& text)
+{
+    String escaped;
+
+    for (size_t n = 0; n < text.size(); ++n)
+    {
+        const char c = text[n];
+
+        if ('"' == c || '\\' == c)
+            escaped += '\\';
+
+        if (0 <= c && c < ' ')
+            continue;
+
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+inline
+TracingProfiler::TracingProfiler (size_t numEventsPerThread)
+: instance(tracing_profiler_next_instance())
+, numEventsPerThread(std::max(size_t(2), numEventsPerThread))
+{
+}
+
+inline
+TracingProfiler::~TracingProfiler ()
+{
+    for (size_t n = 0; n < rings.size(); ++n)
+        delete rings[n];
+}
+
+inline int
+TracingProfiler::registerTask (CString name, CString label)
+{
+    const MutexLocker _(mutex);
+
+    taskNames.push_back(0 != label ? label : name);
+
+    return int(taskNames.size()) - 1;
+}
+
+inline TracingProfiler::Ring&
+TracingProfiler::currentRing ()
+{
+    static thread_local uint64 owner = 0;
+    static thread_local Ring*  ring  = 0;
+
+    if (instance != owner)
+    {
+        // Once per thread. Rings outlive their threads, so that their events can still be dumped.
+        const MutexLocker _(mutex);
+
+        ring  = new Ring(numEventsPerThread, int(rings.size()) + 1);
+        owner = instance;
+
+        rings.push_back(ring);
+    }
+
+    return *ring;
+}
+
+inline void
+TracingProfiler::record (int identifier, bool started)
+{
+    Ring& ring = currentRing();
+
+    const uint64 count = ring.count.load(std::memory_order_relaxed);
+
+    Event& event = ring.events[count % ring.events.size()];
+
+    event.ticks   = getTickCount();
+    event.task    = identifier;
+    event.started = started;
+
+    ring.count.store(count + 1, std::memory_order_release);
+}
+
+inline void
+TracingProfiler::taskStarted (int identifier)
+{
+    record(identifier, true);
+}
+
+inline void
+TracingProfiler::taskStopped (int identifier)
+{
+    record(identifier, false);
+}
+
+inline void
+TracingProfiler::threadStarted (CString name)
+{
+    Ring& ring = currentRing();
+
+    const MutexLocker _(mutex);
+
+    ring.threadName = 0 != name ? name : "";
+}
+
+inline void
+TracingProfiler::clear ()
+{
+    const MutexLocker _(mutex);
+
+    for (size_t n = 0; n < rings.size(); ++n)
+        rings[n]->clearedAt.store(rings[n]->count.load(std::memory_order_acquire));
+}
+
+inline String
+TracingProfiler::chromeTrace () const
+{
+    const MutexLocker _(mutex);
+
+    const double microsecondsPerTick = 1e6 / getTickFrequency();
+
+    String trace = "{\"traceEvents\":[\n";
+
+    bool first = true;
+
+    for (size_t r = 0; r < rings.size(); ++r)
+    {
+        const Ring& ring = *rings[r];
+
+        const uint64 size = ring.events.size();
+
+        if (!ring.threadName.empty())
+        {
+            trace += formatted_copy(
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n",
+                ring.threadId,
+                tracing_profiler_escaped(ring.threadName).c_str()
+            );
+
+            first = false;
+        }
+
+        const uint64 end = ring.count.load(std::memory_order_acquire);
+
+        const uint64 begin = std::max(ring.clearedAt.load(), end < size ? uint64(0) : end - size);
+
+        std::vector<Event> events;
+        events.reserve(size_t(end - begin));
+
+        for (uint64 n = begin; n < end; ++n)
+            events.push_back(ring.events[n % size]);
+
+        // Skip the events that the owning thread overwrote meanwhile, including the one it may still be writing.
+        const uint64 last        = ring.count.load(std::memory_order_acquire);
+        const uint64 firstIntact = last + 1 < size ? uint64(0) : last + 1 - size;
+
+        const size_t numOverwritten = size_t(std::min(end, std::max(begin, firstIntact)) - begin);
+
+        for (size_t n = numOverwritten; n < events.size(); ++n)
+        {
+            const Event& event = events[n];
+
+            const bool known = 0 <= event.task && size_t(event.task) < taskNames.size();
+
+            trace += formatted_copy(
+                "%s{\"name\":\"%s\",\"cat\":\"uplink\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                first ? "" : ",\n",
+                known ? tracing_profiler_escaped(taskNames[event.task]).c_str() : "Unknown",
+                event.started ? "B" : "E",
+                double(event.ticks) * microsecondsPerTick,
+                ring.threadId
+            );
+
+            first = false;
+        }
+    }
+
+    trace += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return trace;
+}
+
+inline bool
+TracingProfiler::writeChromeTrace (CString path) const
+{
+    const String trace = chromeTrace();
+
+    FILE* file = fopen(path, "wb");
+
+    report_false_unless("Cannot open the trace file.", 0 != file);
+
+    const bool written = trace.size() == fwrite(trace.data(), 1, trace.size(), file);
+
+    fclose(file);
+
+    report_false_unless("Cannot write the trace file.", written);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+}
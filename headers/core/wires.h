@@ -6,6 +6,7 @@
 
 # include "../message.h"
 # include "./threads.h"
+# include <deque>
 
 namespace uplink {
 
@@ -13,6 +14,18 @@ struct Endpoint;
 
 //------------------------------------------------------------------------------
 
+// Observes the messages a wire reads, as framed on the stream, before anything gets decoded.
+// Taps run on the wire receiving thread: they must copy what they keep, and return quickly.
+
+struct MessageTap
+{
+    virtual ~MessageTap () {}
+
+    virtual void tapMessage (const Message& message, const Byte* framedBytes, Size framedSize) = 0;
+};
+
+//------------------------------------------------------------------------------
+
 class Wire
 {
 public:
@@ -59,15 +72,81 @@ private:
         virtual void loop ();
     };
 
+private:
+    // Staged message reception, so that reading the stream never waits for image decompression:
+    // the receiver thread only reads messages, which are decoded on the context task pool,
+    // and then handed over to the endpoint by a delivery thread, in reception order.
+    class ReceivePipeline
+    {
+    public:
+         ReceivePipeline (Wire* wire, int maxNumMessagesInFlight);
+        ~ReceivePipeline ();
+
+    public:
+        // Takes ownership of the message, and blocks while the pipeline is full.
+        // Fails once a message could not be decoded or delivered, which also interrupts the wire reading.
+        bool push (Message* message);
+
+    private:
+        struct Slot
+        {
+            Message* message;
+            bool     decoded;
+            bool     succeeded;
+            bool     discarded;
+        };
+
+        struct Delivery : Thread
+        {
+            Delivery (ReceivePipeline* that) : Thread("uplink::Wire::ReceivePipeline::Delivery"), that(that) {}
+
+            virtual void run () { that->deliver(); }
+
+            ReceivePipeline* that;
+        };
+
+        void decode  (uint64 sequenceNumber);
+        void deliver ();
+
+    private:
+        Wire*            wire;
+        Endpoint*        endpoint;
+        const size_t     maxNumMessagesInFlight;
+        Mutex            mutex;
+        Condition        decoded;
+        Condition        delivered;
+        std::deque<Slot> slots;
+        uint64           firstSequenceNumber; // Of the oldest undelivered message.
+        int              numDecoding;
+        bool             stopping;
+        bool             failed;
+        Delivery         delivery;
+
+        non_copyable(ReceivePipeline)
+    };
+
+private:
+    // Wakes up the receiver, blocked reading the stream, so that it stops.
+    void interruptReceiver ();
+
 private:
     struct Sender : Loop
     {
-        Sender (Wire* that) : Loop(that, "uplink::Wire::Sender") {}
+        Sender (Wire* that) : Loop(that, "uplink::Wire::Sender"), woken(false) {}
 
         virtual void loop ();
 
+        // Ends the current wait for messages to send, or the next one.
+        void wake ();
+
+    private:
+        void waitForWake (float seconds);
+
     private:
         StopWatch keepAliveStopWatch;
+        Mutex     wakeMutex;
+        Condition wakeCondition;
+        bool      woken;
     };
 
 private:
@@ -8,6 +8,8 @@
 # include "../endpoints.h"
 # include "./threads.h"
 # include "./macros.h"
+# include "../context.h"
+# include <memory>
 
 namespace uplink {
 
@@ -46,7 +48,7 @@ Wire::stop ()
 {
     TCPConnection* connection = dynamic_cast<TCPConnection*>(stream);
     if (0 != connection)
-        connection->disconnecting = true;
+        connection->disconnect();
 
     receiver.join();
     sender.join();
@@ -58,7 +60,7 @@ Wire::stop ()
 inline void
 Wire::notifySender ()
 {
-    sender.notify();
+    sender.wake();
 }
 
 inline void
@@ -67,6 +69,14 @@ Wire::notifyReceiver ()
     sender.notify();
 }
 
+inline void
+Wire::interruptReceiver ()
+{
+    TCPConnection* connection = dynamic_cast<TCPConnection*>(stream);
+    if (0 != connection)
+        connection->disconnect();
+}
+
 //------------------------------------------------------------------------------
 
 inline
@@ -103,6 +113,11 @@ Wire::Receiver::loop ()
 {
     MessageInput messageInput(*that->stream, that->serializer);
 
+    std::unique_ptr<ReceivePipeline> pipeline;
+
+    if (0 < that->endpoint->receivePipelineDepth)
+        pipeline.reset(new ReceivePipeline(that, that->endpoint->receivePipelineDepth));
+
     while (isRunning())
     {
         Message* message = messageInput.readMessage();
@@ -112,9 +127,209 @@ Wire::Receiver::loop ()
         if (MessageKind_KeepAlive == message->kind())
             continue; // In effect ignoring the keep-alive message.
 
+        if (MessageKind_ClockSync == message->kind())
+        {
+            that->endpoint->receiveClockSync(message->as<ClockSync>(), getTime());
+
+            continue;
+        }
+
+        {
+            const MutexLocker _(that->endpoint->messageTapMutex);
+
+            if (0 != that->endpoint->messageTap)
+                that->endpoint->messageTap->tapMessage(*message, that->serializer.lastReadBytes(), that->serializer.lastReadSize());
+        }
+
         uplink_log_debug("Message received: %s (session: %d)", message->name(), message->sessionId);
 
-        report_unless("cannot receive network message", that->endpoint->receiveMessage(message));
+        if (0 == pipeline.get())
+        {
+            report_unless("cannot receive network message", that->endpoint->receiveMessage(message));
+
+            continue;
+        }
+
+        that->endpoint->messageReceived(*message);
+
+        // The serializer reuses its messages for the following reads, hence the copy. Image copies are shallow.
+        report_unless("cannot receive network message", pipeline->push(message->clone()));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+inline
+Wire::ReceivePipeline::ReceivePipeline (Wire* wire, int maxNumMessagesInFlight)
+    : wire(wire)
+    , endpoint(wire->endpoint)
+    , maxNumMessagesInFlight(size_t(std::max(1, maxNumMessagesInFlight)))
+    , firstSequenceNumber(0)
+    , numDecoding(0)
+    , stopping(false)
+    , failed(false)
+    , delivery(this)
+{
+    assert(0 != wire);
+    assert(0 != endpoint);
+
+    delivery.start();
+}
+
+inline
+Wire::ReceivePipeline::~ReceivePipeline ()
+{
+    {
+        const MutexLocker _(mutex);
+
+        stopping = true;
+
+        decoded.broadcast();
+    }
+
+    delivery.join();
+
+    {
+        // Decoding tasks still refer to their slots.
+        const MutexLocker _(mutex);
+
+        while (0 < numDecoding)
+            decoded.waitLocked(&mutex);
+    }
+
+    for (size_t n = 0; n < slots.size(); ++n)
+        delete slots[n].message;
+}
+
+inline bool
+Wire::ReceivePipeline::push (Message* message)
+{
+    assert(0 != message);
+
+    // Only images need decoding. Other messages wait for their turn to be delivered.
+    const bool needsDecoding = MessageKind_Image == message->kind() || MessageKind_CameraFrame == message->kind();
+
+    // Session setups change decoding settings, so following messages wait for them to be delivered.
+    const bool isBarrier = MessageKind_SessionSetup == message->kind() || MessageKind_SessionSetupReply == message->kind();
+
+    uint64 sequenceNumber = 0;
+
+    {
+        const MutexLocker _(mutex);
+
+        while (!failed && maxNumMessagesInFlight <= slots.size())
+            delivered.waitLocked(&mutex);
+
+        if (failed)
+        {
+            delete message;
+
+            return false;
+        }
+
+        const Slot slot = { message, !needsDecoding, true, false };
+
+        slots.push_back(slot);
+
+        sequenceNumber = firstSequenceNumber + slots.size() - 1;
+
+        if (needsDecoding)
+            ++numDecoding;
+        else
+            decoded.broadcast();
+    }
+
+    if (needsDecoding)
+        context.tasks().post([this, sequenceNumber] () { decode(sequenceNumber); });
+
+    if (isBarrier)
+    {
+        const MutexLocker _(mutex);
+
+        while (!failed && !slots.empty())
+            delivered.waitLocked(&mutex);
+    }
+
+    return true;
+}
+
+inline void
+Wire::ReceivePipeline::decode (uint64 sequenceNumber)
+{
+    Message* message = 0;
+
+    {
+        // Slots are only removed once decoded, so the index remains valid until then.
+        const MutexLocker _(mutex);
+
+        message = slots[size_t(sequenceNumber - firstSequenceNumber)].message;
+    }
+
+    bool discarded = false;
+
+    const bool succeeded = endpoint->decodeMessage(*message, discarded);
+
+    const MutexLocker _(mutex);
+
+    Slot& slot = slots[size_t(sequenceNumber - firstSequenceNumber)];
+
+    slot.decoded   = true;
+    slot.succeeded = succeeded;
+    slot.discarded = discarded;
+
+    --numDecoding;
+
+    decoded.broadcast();
+}
+
+inline void
+Wire::ReceivePipeline::deliver ()
+{
+    while (true)
+    {
+        Slot slot;
+
+        {
+            const MutexLocker _(mutex);
+
+            while (!stopping && (slots.empty() || !slots.front().decoded))
+                decoded.waitLocked(&mutex);
+
+            if (stopping)
+                return;
+
+            slot = slots.front();
+
+            slots.pop_front();
+
+            ++firstSequenceNumber;
+        }
+
+        bool succeeded = slot.succeeded;
+
+        if (succeeded && !slot.discarded)
+            succeeded = endpoint->deliverDecodedMessage(*slot.message);
+
+        if (!succeeded)
+            uplink_log_error("cannot receive network message");
+
+        delete slot.message;
+
+        {
+            const MutexLocker _(mutex);
+
+            failed = failed || !succeeded;
+
+            delivered.broadcast();
+
+            if (!failed)
+                continue;
+        }
+
+        // The receiver would otherwise only notice on pushing the next message, which may never arrive.
+        wire->interruptReceiver();
+
+        return;
     }
 }
 
@@ -152,14 +367,33 @@ Wire::Sender::loop ()
             }
             else
             {
-                sleep(.001f); // Avoid active loops.
+                waitForWake(.001f); // Avoid active loops, while staying responsive to the queues that do not notify.
             }
         }
-
-        // FIXME: Rework sender thread notifications.
     }
 }
 
+inline void
+Wire::Sender::wake ()
+{
+    const MutexLocker _(wakeMutex);
+
+    woken = true;
+
+    wakeCondition.signal();
+}
+
+inline void
+Wire::Sender::waitForWake (float seconds)
+{
+    const MutexLocker _(wakeMutex);
+
+    if (!woken)
+        wakeCondition.waitLockedFor(&wakeMutex, seconds);
+
+    woken = false;
+}
+
 //------------------------------------------------------------------------------
 
 }
@@ -0,0 +1,73 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./image.h"
+# include "./sessions-settings.h"
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Depth filters work in place on ImageFormat_Shifts and ImageFormat_DepthMillimeters images, zero values meaning no depth.
+// Both process row strips on the context task pool.
+
+//------------------------------------------------------------------------------
+
+// Running median or exponential moving average over consecutive depth frames.
+// History restarts whenever the mode, the length, the image size or the image format change. Not thread-safe.
+
+class DepthTemporalFilter
+{
+public:
+    enum
+    {
+        MaxLength   = 9,
+        StripHeight = 32, // Rows per parallel filtering task.
+    };
+
+public:
+    DepthTemporalFilter ();
+
+public:
+    bool filter (Image& depthImage, DepthTemporalFilterMode mode, int length, float weight);
+
+    void reset ();
+
+private:
+    void filterMedian  (uint16* depths, size_t bytesPerRow);
+    void filterAverage (uint16* depths, size_t bytesPerRow, float weight);
+
+private:
+    DepthTemporalFilterMode mode;
+    int                     length;
+    size_t                  width;
+    size_t                  height;
+    ImageFormat             format;
+
+    // Median history, as a ring of the last frames.
+    std::vector<uint16>     history;
+    int                     numFrames;
+    int                     nextFrame;
+
+    // Moving average, with zero meaning no history.
+    std::vector<float>      average;
+};
+
+//------------------------------------------------------------------------------
+
+// Edge-preserving bilateral filter, applied separably along rows and columns.
+// Range weights are relative to the center value: sigma = .02 weighs neighbors 2% away by exp(-1/2).
+
+enum { DepthBilateralFilterMaxRadius = 8 };
+
+bool filter_depth_bilateral (Image& depthImage, int radius, float sigma);
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./depth-filters.hpp"
@@ -0,0 +1,331 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./depth-filters.h"
+# include "./context.h"
+# include <algorithm>
+# include <cmath>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+inline bool
+depth_filter_plane (const Image& depthImage, uint16*& depths, size_t& bytesPerRow)
+{
+    report_false_unless("Depth filters require uncompressed depth images.",
+           ImageFormat_Shifts           == depthImage.format
+        || ImageFormat_DepthMillimeters == depthImage.format
+    );
+
+    const Image::Plane& plane = depthImage.planes[0];
+
+    depths      = (uint16*) plane.buffer;
+    bytesPerRow = 0 != plane.bytesPerRow ? plane.bytesPerRow : depthImage.width * sizeof(uint16);
+
+    report_false_unless("Invalid depth image plane.",
+           0 != depths
+        && 0 < depthImage.width * depthImage.height
+        && (depthImage.height - 1) * bytesPerRow + depthImage.width * sizeof(uint16) <= plane.sizeInBytes
+    );
+
+    return true;
+}
+
+inline uint16*
+depth_filter_row (uint16* depths, size_t bytesPerRow, size_t row)
+{
+    return (uint16*) ((uint8*) depths + row * bytesPerRow);
+}
+
+template < typename Body >
+inline void
+depth_filter_strips (size_t height, size_t stripHeight, const Body& body)
+{
+    const int numStrips = int((height + stripHeight - 1) / stripHeight);
+
+    context.tasks().parallelFor(numStrips, [&] (int n)
+    {
+        const size_t firstRow = size_t(n) * stripHeight;
+
+        body(firstRow, std::min(firstRow + stripHeight, height));
+    });
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+inline
+DepthTemporalFilter::DepthTemporalFilter ()
+{
+    reset();
+}
+
+inline void
+DepthTemporalFilter::reset ()
+{
+    mode      = DepthTemporalFilterMode_None;
+    length    = 0;
+    width     = 0;
+    height    = 0;
+    format    = ImageFormat_Empty;
+    numFrames = 0;
+    nextFrame = 0;
+
+    history.clear();
+    average.clear();
+}
+
+inline bool
+DepthTemporalFilter::filter (Image& depthImage, DepthTemporalFilterMode mode, int length, float weight)
+{
+    if (DepthTemporalFilterMode_None == mode)
+        return true;
+
+    uint16* depths      = 0;
+    size_t  bytesPerRow = 0;
+
+    return_false_unless(depth_filter_plane(depthImage, depths, bytesPerRow));
+
+    length = std::max(1, std::min(length, int(MaxLength)));
+
+    if (mode != this->mode || length != this->length || depthImage.width != width || depthImage.height != height || depthImage.format != format)
+    {
+        reset();
+
+        this->mode   = mode;
+        this->length = length;
+        width        = depthImage.width;
+        height       = depthImage.height;
+        format       = depthImage.format;
+    }
+
+    switch (mode)
+    {
+        case DepthTemporalFilterMode_Median:
+        {
+            filterMedian(depths, bytesPerRow);
+
+            return true;
+        }
+
+        case DepthTemporalFilterMode_ExponentialMovingAverage:
+        {
+            filterAverage(depths, bytesPerRow, std::max(0.f, std::min(weight, 1.f)));
+
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+inline void
+DepthTemporalFilter::filterMedian (uint16* depths, size_t bytesPerRow)
+{
+    const size_t frameSize = width * height;
+
+    history.resize(length * frameSize);
+
+    uint16* const newest = &history[nextFrame * frameSize];
+
+    nextFrame = (nextFrame + 1) % length;
+    numFrames = std::min(numFrames + 1, length);
+
+    const int numFrames = this->numFrames;
+
+    depth_filter_strips(height, StripHeight, [&] (size_t firstRow, size_t lastRow)
+    {
+        for (size_t v = firstRow; v < lastRow; ++v)
+            std::copy(depth_filter_row(depths, bytesPerRow, v), depth_filter_row(depths, bytesPerRow, v) + width, newest + v * width);
+
+        for (size_t v = firstRow; v < lastRow; ++v)
+        {
+            uint16* row = depth_filter_row(depths, bytesPerRow, v);
+
+            for (size_t u = 0; u < width; ++u)
+            {
+                // Insertion sort of the valid samples, which are few.
+                uint16 samples [MaxLength];
+                int    numSamples = 0;
+
+                for (int f = 0; f < numFrames; ++f)
+                {
+                    const uint16 sample = history[f * frameSize + v * width + u];
+
+                    if (0 == sample)
+                        continue;
+
+                    int n = numSamples++;
+
+                    for (; 0 < n && sample < samples[n - 1]; --n)
+                        samples[n] = samples[n - 1];
+
+                    samples[n] = sample;
+                }
+
+                // Pixels need depth in at least half of the frames, so that flickering depth neither appears nor vanishes.
+                row[u] = 2 * numSamples < numFrames ? uint16(0) : samples[numSamples / 2];
+            }
+        }
+    });
+}
+
+inline void
+DepthTemporalFilter::filterAverage (uint16* depths, size_t bytesPerRow, float weight)
+{
+    average.resize(width * height, 0.f);
+
+    depth_filter_strips(height, StripHeight, [&] (size_t firstRow, size_t lastRow)
+    {
+        for (size_t v = firstRow; v < lastRow; ++v)
+        {
+            uint16* row  = depth_filter_row(depths, bytesPerRow, v);
+            float*  mean = &average[v * width];
+
+            for (size_t u = 0; u < width; ++u)
+            {
+                const float depth = float(row[u]);
+
+                // Averages restart on missing depth, and on changes larger than an eighth, which are motion, not noise.
+                const bool restart = 0.f == depth || 0.f == mean[u] || 8.f * std::fabs(depth - mean[u]) > mean[u];
+
+                mean[u] = restart ? depth : mean[u] + weight * (depth - mean[u]);
+
+                row[u] = uint16(mean[u] + .5f);
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+
+enum
+{
+    DepthBilateralRangeTableScale = 16, // Entries per unit of squared normalized difference.
+    DepthBilateralRangeTableSize  = 8 * DepthBilateralRangeTableScale, // Weights beyond exp(-8) are dropped.
+};
+
+struct DepthBilateralWeights
+{
+    DepthBilateralWeights (int radius)
+    {
+        // Spatial weights fall to exp(-2) at the radius.
+        const float spatialSigma = std::max(.5f, float(radius) / 2.f);
+
+        for (int k = -radius; k <= radius; ++k)
+            spatial[k + radius] = std::exp(-float(k * k) / (2.f * spatialSigma * spatialSigma));
+
+        for (int n = 0; n < DepthBilateralRangeTableSize; ++n)
+            range[n] = std::exp(-float(n) / float(DepthBilateralRangeTableScale));
+    }
+
+    float spatial [2 * DepthBilateralFilterMaxRadius + 1];
+    float range   [DepthBilateralRangeTableSize];
+};
+
+inline uint16
+depth_bilateral_sample (const uint16* samples, ptrdiff_t stride, int radius, float inverseTwoSigmaSquared, const DepthBilateralWeights& weights)
+{
+    const uint16 center = samples[0];
+
+    if (0 == center)
+        return 0;
+
+    const float normalization = inverseTwoSigmaSquared / (float(center) * float(center));
+
+    float sum         = 0.f;
+    float sumOfWeights = 0.f;
+
+    for (int k = -radius; k <= radius; ++k)
+    {
+        const uint16 sample = samples[k * stride];
+
+        if (0 == sample)
+            continue;
+
+        const float difference = float(sample) - float(center);
+        const float scaled     = difference * difference * normalization * DepthBilateralRangeTableScale;
+
+        // Compared before conversion, as distant depths overflow integers.
+        if (!(scaled < DepthBilateralRangeTableSize))
+            continue;
+
+        const float weight = weights.spatial[k + radius] * weights.range[int(scaled)];
+
+        sum          += weight * float(sample);
+        sumOfWeights += weight;
+    }
+
+    return uint16(sum / sumOfWeights + .5f); // The center always contributes.
+}
+
+inline bool
+filter_depth_bilateral (Image& depthImage, int radius, float sigma)
+{
+    radius = std::min(radius, int(DepthBilateralFilterMaxRadius));
+
+    return_true_unless(0 < radius && 0.f < sigma);
+
+    uint16* depths      = 0;
+    size_t  bytesPerRow = 0;
+
+    return_false_unless(depth_filter_plane(depthImage, depths, bytesPerRow));
+
+    const size_t width  = depthImage.width;
+    const size_t height = depthImage.height;
+
+    const DepthBilateralWeights weights(radius);
+
+    const float inverseTwoSigmaSquared = 1.f / (2.f * sigma * sigma);
+
+    // Rows and columns are padded with no depth, so that the kernels need no bounds checks.
+    const size_t paddedWidth  = width  + 2 * radius;
+    const size_t paddedHeight = height + 2 * radius;
+
+    std::vector<uint16> rows    (paddedWidth * height, 0);
+    std::vector<uint16> columns (width * paddedHeight, 0);
+
+    enum { StripHeight = 32 };
+
+    depth_filter_strips(height, StripHeight, [&] (size_t firstRow, size_t lastRow)
+    {
+        for (size_t v = firstRow; v < lastRow; ++v)
+        {
+            const uint16* source = depth_filter_row(depths, bytesPerRow, v);
+
+            std::copy(source, source + width, &rows[v * paddedWidth + radius]);
+
+            const uint16* samples = &rows[v * paddedWidth + radius];
+            uint16*       target  = &columns[(v + radius) * width];
+
+            for (size_t u = 0; u < width; ++u)
+                target[u] = depth_bilateral_sample(samples + u, 1, radius, inverseTwoSigmaSquared, weights);
+        }
+    });
+
+    depth_filter_strips(height, StripHeight, [&] (size_t firstRow, size_t lastRow)
+    {
+        for (size_t v = firstRow; v < lastRow; ++v)
+        {
+            const uint16* samples = &columns[(v + radius) * width];
+            uint16*       target  = depth_filter_row(depths, bytesPerRow, v);
+
+            for (size_t u = 0; u < width; ++u)
+                target[u] = depth_bilateral_sample(samples + u, ptrdiff_t(width), radius, inverseTwoSigmaSquared, weights);
+        }
+    });
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,69 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./image.h"
+# include "./point-clouds.h"
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Receiver-side depth to color registration, warping unregistered depth frames into the color camera frame.
+// Calibration extrinsics map each camera frame to a shared reference frame, in meters.
+// Color calibrations without extrinsics make the reference frame the color camera one.
+
+class DepthToColorRegistration
+{
+public:
+    enum { StripHeight = 32 }; // Depth rows per parallel projection task.
+
+public:
+    DepthToColorRegistration ();
+
+public:
+    // Remap tables are only regenerated when a calibration or an image size change.
+    bool update (
+        const CameraCalibration& depthCalibration,
+        size_t                   depthWidth,
+        size_t                   depthHeight,
+        const CameraCalibration& colorCalibration,
+        size_t                   colorWidth,
+        size_t                   colorHeight
+    );
+
+    // Produces an ImageFormat_DepthMillimeters image of the color image size, in the color camera frame.
+    // Depth images must be uncompressed Shifts or DepthMillimeters. Color images may be compressed.
+    // Projection runs in row strips on the context task pool. Not thread-safe.
+    bool registerDepth (const Image& depthImage, const Image& colorImage, Image& registeredDepthImage);
+
+private:
+    void project (const uint16* depths, size_t depthBytesPerRow, const ShiftToDepthTable* table, size_t firstRow, size_t numRows);
+
+private:
+    DepthRayTable      depthRays;
+    CameraCalibration  colorCalibration;
+    size_t             colorWidth;
+    size_t             colorHeight;
+    ShiftToDepthTable  shiftToDepth;
+
+    // Depth rays, rotated into the color camera frame.
+    std::vector<float> raysX;
+    std::vector<float> raysY;
+    std::vector<float> raysZ;
+    float              translation [3]; // Millimeters.
+    int                footprint;       // Color pixels covered by each depth pixel, along each axis.
+
+    // Per depth pixel projections, reused across frames.
+    std::vector<int32>  targetIndices; // -1 when the pixel has no depth, or falls outside of the color image.
+    std::vector<uint16> targetDepths;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./depth-registration.hpp"
@@ -0,0 +1,269 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./depth-registration.h"
+# include "./context.h"
+# include <algorithm>
+# include <cmath>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline
+DepthToColorRegistration::DepthToColorRegistration ()
+    : depthRays()
+    , colorCalibration()
+    , colorWidth(0)
+    , colorHeight(0)
+    , footprint(1)
+{
+    std::fill(translation, translation + 3, 0.f);
+}
+
+inline bool
+DepthToColorRegistration::update (
+    const CameraCalibration& depthCalibration,
+    size_t                   depthWidth,
+    size_t                   depthHeight,
+    const CameraCalibration& colorCalibration,
+    size_t                   colorWidth,
+    size_t                   colorHeight
+)
+{
+    const bool depthChanged = !depthRays.matches(depthCalibration, depthWidth, depthHeight);
+
+    if (!depthChanged
+        && colorCalibration == this->colorCalibration
+        && colorWidth       == this->colorWidth
+        && colorHeight      == this->colorHeight)
+        return true;
+
+    // Invalidated until successfully regenerated.
+    this->colorWidth  = 0;
+    this->colorHeight = 0;
+
+    report_false_unless("Invalid color camera calibration.", colorCalibration.isValid() && 0 < colorCalibration.fy);
+    report_false_unless("Invalid color image size.", 0 < colorWidth * colorHeight);
+
+    if (depthChanged)
+        return_false_unless(depthRays.update(depthCalibration, depthWidth, depthHeight));
+
+    // Depth to color transform, through the reference frame: R = Rc^T * Rd, t = Rc^T * (td - tc).
+    float depthRotation [9], depthTranslation [3];
+    float colorRotation [9], colorTranslation [3];
+
+    depthCalibration.extrinsics(depthRotation, depthTranslation);
+    colorCalibration.extrinsics(colorRotation, colorTranslation);
+
+    float rotation [9];
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            rotation[i * 3 + j] = 0.f;
+
+            for (int k = 0; k < 3; ++k)
+                rotation[i * 3 + j] += colorRotation[k * 3 + i] * depthRotation[k * 3 + j];
+        }
+
+        translation[i] = 0.f;
+
+        for (int k = 0; k < 3; ++k)
+            translation[i] += colorRotation[k * 3 + i] * (depthTranslation[k] - colorTranslation[k]) * 1000.f;
+    }
+
+    const size_t numDepthPixels = depthWidth * depthHeight;
+
+    raysX.resize(numDepthPixels);
+    raysY.resize(numDepthPixels);
+    raysZ.resize(numDepthPixels);
+
+    for (size_t v = 0; v < depthHeight; ++v)
+    {
+        const float* rowX = depthRays.rowX(v);
+        const float* rowY = depthRays.rowY(v);
+
+        for (size_t u = 0; u < depthWidth; ++u)
+        {
+            const size_t n = v * depthWidth + u;
+
+            raysX[n] = rotation[0] * rowX[u] + rotation[1] * rowY[u] + rotation[2];
+            raysY[n] = rotation[3] * rowX[u] + rotation[4] * rowY[u] + rotation[5];
+            raysZ[n] = rotation[6] * rowX[u] + rotation[7] * rowY[u] + rotation[8];
+        }
+    }
+
+    // Lower resolution depth covers several color pixels, which would otherwise be left as holes.
+    // The margin absorbs rounding and lens distortion, which spread neighboring projections a little further apart.
+    footprint = std::max(1, std::min(4, int(std::ceil(1.1f * colorCalibration.fx / depthCalibration.fx))));
+
+    targetIndices.resize(numDepthPixels);
+    targetDepths .resize(numDepthPixels);
+
+    this->colorCalibration = colorCalibration;
+    this->colorWidth       = colorWidth;
+    this->colorHeight      = colorHeight;
+
+    return true;
+}
+
+inline void
+DepthToColorRegistration::project (const uint16* depths, size_t depthBytesPerRow, const ShiftToDepthTable* table, size_t firstRow, size_t numRows)
+{
+    const size_t depthWidth = depthRays.getWidth();
+
+    const bool distorted = colorCalibration.hasDistortion();
+
+    const float fx = colorCalibration.fx;
+    const float fy = colorCalibration.fy;
+    const float cx = colorCalibration.cx;
+    const float cy = colorCalibration.cy;
+
+    for (size_t v = firstRow; v < firstRow + numRows; ++v)
+    {
+        const uint16* row = (const uint16*) ((const uint8*) depths + v * depthBytesPerRow);
+
+        for (size_t u = 0; u < depthWidth; ++u)
+        {
+            const size_t n = v * depthWidth + u;
+
+            targetIndices[n] = -1;
+
+            const uint16 depth = 0 != row[u] && 0 != table ? (*table)[row[u]] : row[u];
+
+            if (0 == depth)
+                continue;
+
+            const float z = float(depth);
+
+            const float X = raysX[n] * z + translation[0];
+            const float Y = raysY[n] * z + translation[1];
+            const float Z = raysZ[n] * z + translation[2];
+
+            if (!(1.f <= Z && Z < 65535.5f))
+                continue;
+
+            float x = X / Z;
+            float y = Y / Z;
+
+            if (distorted)
+                colorCalibration.distort(x, y, x, y);
+
+            const float cu = fx * x + cx + .5f;
+            const float cv = fy * y + cy + .5f;
+
+            if (!(0.f <= cu && cu < float(colorWidth) && 0.f <= cv && cv < float(colorHeight)))
+                continue;
+
+            targetIndices[n] = int32(size_t(cv) * colorWidth + size_t(cu));
+            targetDepths [n] = uint16(Z + .5f);
+        }
+    }
+}
+
+inline bool
+DepthToColorRegistration::registerDepth (const Image& depthImage, const Image& colorImage, Image& registeredDepthImage)
+{
+    report_false_unless("Depth registration requires uncompressed depth images.",
+           ImageFormat_Shifts           == depthImage.format
+        || ImageFormat_DepthMillimeters == depthImage.format
+    );
+
+    return_false_unless(update(
+        depthImage.cameraInfo.calibration,
+        depthImage.width,
+        depthImage.height,
+        colorImage.cameraInfo.calibration,
+        colorImage.width,
+        colorImage.height
+    ));
+
+    const Image::Plane& depthPlane = depthImage.planes[0];
+
+    const size_t depthBytesPerRow = 0 != depthPlane.bytesPerRow ? depthPlane.bytesPerRow : depthImage.width * sizeof(uint16);
+
+    report_false_unless("Invalid depth image plane.",
+           0 != depthPlane.buffer
+        && (depthImage.height - 1) * depthBytesPerRow + depthImage.width * sizeof(uint16) <= depthPlane.sizeInBytes
+    );
+
+    const ShiftToDepthTable* table = 0;
+
+    if (ImageFormat_Shifts == depthImage.format)
+    {
+        shiftToDepth.update(depthImage.cameraInfo);
+
+        table = &shiftToDepth;
+    }
+
+    const int numStrips = int((depthImage.height + StripHeight - 1) / StripHeight);
+
+    context.tasks().parallelFor(numStrips, [&] (int n)
+    {
+        const size_t firstRow = size_t(n) * StripHeight;
+        const size_t numRows  = std::min(size_t(StripHeight), depthImage.height - firstRow);
+
+        project((const uint16*) depthPlane.buffer, depthBytesPerRow, table, firstRow, numRows);
+    });
+
+    // Splatting is serial, so that the nearest depth wins wherever footprints overlap.
+    const size_t numTargetElements = colorWidth * colorHeight;
+
+    uint16* targetBuffer = new uint16[numTargetElements];
+
+    std::fill(targetBuffer, targetBuffer + numTargetElements, uint16(0));
+
+    const int offset = (footprint - 1) / 2;
+
+    for (size_t n = 0; n < targetIndices.size(); ++n)
+    {
+        if (targetIndices[n] < 0)
+            continue;
+
+        const uint16 depth = targetDepths[n];
+
+        const int cu = int(size_t(targetIndices[n]) % colorWidth);
+        const int cv = int(size_t(targetIndices[n]) / colorWidth);
+
+        const int firstU = std::max(0, cu - offset);
+        const int firstV = std::max(0, cv - offset);
+        const int lastU  = std::min(int(colorWidth ), cu - offset + footprint);
+        const int lastV  = std::min(int(colorHeight), cv - offset + footprint);
+
+        for (int tv = firstV; tv < lastV; ++tv)
+        {
+            uint16* target = targetBuffer + size_t(tv) * colorWidth;
+
+            for (int tu = firstU; tu < lastU; ++tu)
+                if (0 == target[tu] || depth < target[tu])
+                    target[tu] = depth;
+        }
+    }
+
+    registeredDepthImage.clear();
+
+    registeredDepthImage.width  = colorWidth;
+    registeredDepthImage.height = colorHeight;
+    registeredDepthImage.format = ImageFormat_DepthMillimeters;
+    registeredDepthImage.planes[0].buffer      = targetBuffer;
+    registeredDepthImage.planes[0].sizeInBytes = numTargetElements * 2;
+    registeredDepthImage.planes[0].bytesPerRow = colorWidth * 2;
+
+    registeredDepthImage.cameraInfo = depthImage.cameraInfo;
+    registeredDepthImage.cameraInfo.calibration         = colorCalibration;
+    registeredDepthImage.cameraInfo.isRegisteredToColor = true;
+
+    registeredDepthImage.release = [targetBuffer] () { delete [] targetBuffer; };
+    registeredDepthImage.retain  = std::function<void ()>();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -8,6 +8,8 @@
 
 namespace uplink {
 
+struct Image;
+
 struct DesktopServerUI
 {
     DesktopServerUI();
@@ -16,6 +18,7 @@ struct DesktopServerUI
     void run ();
 
     void setColorImage(const uint8*  buffer, int width, int height);
+    void setColorImage(const Image& image); // RGB images, uploaded at the smallest preview size covering the window.
     void setDepthImage(const uint16* buffer, int width, int height);
 
     struct Impl;
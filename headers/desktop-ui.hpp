@@ -5,6 +5,8 @@
 # include "desktop-server.h"
 # include "desktop-ui.h"
 # include "../dependencies/headers/glfw3.h"
+# include <algorithm>
+# include <cstring>
 
 namespace uplink {
 
@@ -23,6 +25,50 @@ keepInRange (T value, T minValue, T maxValue)
     return value;
 }
 
+inline void
+depthToInverseDepthRgba (
+    uint16 depth,
+    float scaleToMeters,
+    uint8* rgba,
+    uint8 noDepthAlpha = 0,
+    uint8 depthAlpha = 255
+)
+{
+    int r = 0, g = 0, b = 0;
+
+    uint8 alpha = noDepthAlpha;
+
+    if (0 < depth && depth < shift2depth(0xffff))
+    {
+        const float idepth = 1.f / (float(depth) * scaleToMeters);
+
+        // rainbow between 0 and 4
+        r = int((0.f - idepth) * 255.f / 1.f);
+        g = int((1.f - idepth) * 255.f / 1.f);
+        b = int((2.f - idepth) * 255.f / 1.f);
+
+        if (r < 0)
+            r = -r;
+        
+        if (g < 0)
+            g = -g;
+        
+        if (b < 0)
+            b = -b;
+
+        alpha = depthAlpha;
+    }
+
+    uint8_t rc = keepInRange (r, 0, 255);
+    uint8_t gc = keepInRange (g, 0, 255);
+    uint8_t bc = keepInRange (b, 0, 255);
+
+    rgba[0] = 255 - rc;
+    rgba[1] = 255 - gc;
+    rgba[2] = 255 - bc;
+    rgba[3] = alpha;
+}
+
 inline void
 convertDepthToInverseDepthRgba (
     const uint16* depthValues,
@@ -34,44 +80,77 @@ convertDepthToInverseDepthRgba (
 )
 {
     for (int i = 0; i < numPixels; ++i)
+        depthToInverseDepthRgba(depthValues[i], scaleToMeters, rgbaBuffer + 4 * i, noDepthAlpha, depthAlpha);
+}
+
+//------------------------------------------------------------------------------
+
+// Inverse depth colors, precomputed for all depths up to the maximum one, past which pixels have no depth.
+// Frames then colorize with one table lookup per pixel.
+
+struct InverseDepthRgbaPalette
+{
+    InverseDepthRgbaPalette ()
+    : scaleToMeters(0.f)
+    , noDepthAlpha(0)
+    , depthAlpha(0)
     {
-        int r = 0, g = 0, b = 0;
+    }
+
+    void update (float newScaleToMeters, uint8 newNoDepthAlpha, uint8 newDepthAlpha)
+    {
+        if (!colors.empty() && newScaleToMeters == scaleToMeters && newNoDepthAlpha == noDepthAlpha && newDepthAlpha == depthAlpha)
+            return;
 
-        uint8 alpha = noDepthAlpha;
+        scaleToMeters = newScaleToMeters;
+        noDepthAlpha  = newNoDepthAlpha;
+        depthAlpha    = newDepthAlpha;
 
-        uint16 depth = depthValues[i];
+        // The last entry is the no-depth color, which all farther depths map to.
+        colors.resize(size_t(shift2depth(0xffff)) + 1);
 
-        if (0 < depth && depth < shift2depth(0xffff))
+        for (size_t depth = 0; depth < colors.size(); ++depth)
         {
-            const float idepth = 1.f / (float(depth) * scaleToMeters);
-
-            // rainbow between 0 and 4
-            r = int((0.f - idepth) * 255.f / 1.f);
-            g = int((1.f - idepth) * 255.f / 1.f);
-            b = int((2.f - idepth) * 255.f / 1.f);
-
-            if (r < 0)
-                r = -r;
-            
-            if (g < 0)
-                g = -g;
-            
-            if (b < 0)
-                b = -b;
-
-            alpha = depthAlpha;
+            uint8 rgba [4];
+
+            depthToInverseDepthRgba(uint16(depth), scaleToMeters, rgba, noDepthAlpha, depthAlpha);
+
+            std::memcpy(&colors[depth], rgba, 4);
         }
+    }
 
-        uint8_t rc = keepInRange (r, 0, 255);
-        uint8_t gc = keepInRange (g, 0, 255);
-        uint8_t bc = keepInRange (b, 0, 255);
+    void convert (const uint16* depthValues, int numPixels, uint8* rgbaBuffer) const
+    {
+        assert(!colors.empty());
+
+        const uint16 maxDepth = uint16(colors.size() - 1);
+        const uint32* palette = colors.data();
 
-        rgbaBuffer[4 * i    ] = 255 - rc;
-        rgbaBuffer[4 * i + 1] = 255 - gc;
-        rgbaBuffer[4 * i + 2] = 255 - bc;
-        rgbaBuffer[4 * i + 3] = alpha;
+        int i = 0;
+
+        // Unrolled so that the lookups of neighboring pixels overlap.
+        for (; i + 4 <= numPixels; i += 4)
+        {
+            const uint32 rgba [4] =
+            {
+                palette[std::min(depthValues[i    ], maxDepth)],
+                palette[std::min(depthValues[i + 1], maxDepth)],
+                palette[std::min(depthValues[i + 2], maxDepth)],
+                palette[std::min(depthValues[i + 3], maxDepth)],
+            };
+
+            std::memcpy(rgbaBuffer + 4 * i, rgba, sizeof(rgba));
+        }
+
+        for (; i < numPixels; ++i)
+            std::memcpy(rgbaBuffer + 4 * i, &palette[std::min(depthValues[i], maxDepth)], 4);
     }
-}
+
+    std::vector<uint32> colors; // RGBA bytes, in memory order.
+    float               scaleToMeters;
+    uint8               noDepthAlpha;
+    uint8               depthAlpha;
+};
 
 //------------------------------------------------------------------------------
 
@@ -90,6 +169,9 @@ struct DesktopServerUI::Impl
 
     static void resize_callback(GLFWwindow* window, int width, int height)
     {
+        impl(window)->_width  = width;
+        impl(window)->_height = height;
+
         glfwMakeContextCurrent(window);
 
         glViewport(0, 0, width, height);
@@ -117,7 +199,9 @@ struct DesktopServerUI::Impl
     }
 
     Impl(That* that)
-    : that(that)
+    : _width(initialWindowWidth)
+    , _height(initialWindowHeight)
+    , that(that)
     , mainWindow(0)
     , sharingWindow(0)
     {
@@ -253,6 +337,9 @@ struct DesktopServerUI::Impl
     GLuint colorTextureId;
 
     std::vector<uint8> renderedDepth;
+    InverseDepthRgbaPalette depthPalette;
+
+    ImagePyramid colorPyramid;
 
     Mutex sharingMutex;
 };
@@ -311,6 +398,26 @@ DesktopServerUI::setColorImage (const uint8* buffer, int width, int height)
     glfwMakeContextCurrent(0);
 }
 
+inline void
+DesktopServerUI::setColorImage (const Image& image)
+{
+    if (ImageFormat_RGB != image.format)
+    {
+        uplink_log_error("Color previews require RGB images.");
+        return;
+    }
+
+    // Larger images are downscaled first, which is cheaper than uploading them whole.
+    if (!impl->colorPyramid.build(image))
+        return;
+
+    const Image& preview = impl->colorPyramid.levelCovering(size_t(impl->_width), size_t(impl->_height));
+
+    setColorImage((const uint8*) preview.planes[0].buffer, int(preview.width), int(preview.height));
+
+    impl->colorPyramid.clear();
+}
+
 inline void
 DesktopServerUI::setDepthImage (const uint16* buffer, int width, int height)
 {
@@ -324,7 +431,8 @@ DesktopServerUI::setDepthImage (const uint16* buffer, int width, int height)
 
     impl->renderedDepth.resize(width * height * 4);
 
-    convertDepthToInverseDepthRgba(buffer, width * height, 1e-3f, impl->renderedDepth.data(), 0, 127);
+    impl->depthPalette.update(1e-3f, 0, 127);
+    impl->depthPalette.convert(buffer, width * height, impl->renderedDepth.data());
 
     {
         const MutexLocker _(impl->sharingMutex);
@@ -8,6 +8,9 @@
 # include "./discovery.h"
 # include "./sessions-setup.h"
 # include "./image-codecs.h"
+# include "./depth-filters.h"
+# include "./image-pyramids.h"
+# include "./clock-sync.h"
 # include "./core/macros.h"
 # include "./core/streams.h"
 # include "./core/queues.h"
@@ -30,22 +33,43 @@ public:
 public:
     void disconnect ();
 
+public:
+    // Received messages, keep-alives and clock exchanges aside, are handed to the tap before decoding. Zero removes it.
+    // Once this returns, the previous tap is no longer called.
+    void setMessageTap (MessageTap* tap);
+
 public:
     virtual void disconnected () = 0;
     virtual void registerMessages (MessageSerializer& messageSerializer);
     virtual bool sendMessages (MessageOutput& output, bool& sent);
     virtual bool receiveMessage (Message* message);
+
+public:
+    // Receiving splits into decoding, which may run concurrently for distinct messages, and in-order delivery.
+    // Discarded messages are successfully decoded, but must not be delivered.
+    bool decodeMessage (Message& message, bool& discarded);
+    bool deliverDecodedMessage (Message& message);
     virtual void reset ()
     {
         sessionSetupQueue.reset();\
         sessionSetupReplyQueue.reset();
 
         customCommandQueue.reset();
+        clockSyncQueue.reset();
 
 # define UPLINK_MESSAGE(Name, name) \
         name##Queue.reset()  ;
          UPLINK_USER_MESSAGES_EXCEPT_VERSION_INFO_AND_CUSTOM_COMMAND()
 # undef  UPLINK_MESSAGE
+
+        colorCameraCodecSelector.reset();
+        depthCameraCodecSelector.reset();
+
+        cameraFrameCompression.reset();
+
+        depthTemporalFilter.reset();
+
+        remoteClock.reset();
     }
 
 public:
@@ -64,6 +88,11 @@ private:
         uplink_log_debug("%s pushed.", message.name());
 
         channelStats[message.kind()].pushing.add(message);
+
+        double captured;
+
+        if (captureTime(message, captured))
+            channelStats[message.kind()].pushing.addAge(getTime() - captured);
     }
 
     void messageSent (const Message& message)
@@ -71,6 +100,11 @@ private:
         uplink_log_debug("%s sent.", message.name());
 
         channelStats[message.kind()].sending.add(message);
+
+        double captured;
+
+        if (captureTime(message, captured))
+            channelStats[message.kind()].sending.addAge(getTime() - captured);
     }
     
     void messageReceived (const Message& message)
@@ -78,6 +112,11 @@ private:
         uplink_log_debug("%s received.", message.name());
 
         channelStats[message.kind()].receiving.add(message);
+
+        double captured;
+
+        if (remoteCaptureTime(message, captured))
+            channelStats[message.kind()].receiving.addAge(getTime() - captured);
     }
     
     void messageDelivered (const Message& message)
@@ -85,6 +124,65 @@ private:
         uplink_log_debug("%s delivered.", message.name());
 
         channelStats[message.kind()].delivering.add(message);
+
+        double captured;
+
+        if (remoteCaptureTime(message, captured))
+            channelStats[message.kind()].delivering.addAge(getTime() - captured);
+    }
+
+    static bool isTimestamped (MessageKind kind)
+    {
+        switch (kind)
+        {
+            case MessageKind_CameraFrame:
+            case MessageKind_Image:
+            case MessageKind_CameraPose:
+            case MessageKind_GyroscopeEvent:
+            case MessageKind_AccelerometerEvent:
+            case MessageKind_DeviceMotionEvent:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+public:
+    // Capture timestamps are on the sender clock, which is the getTime() one on iOS devices.
+    static bool captureTime (const Message& message, double& time)
+    {
+        switch (message.kind())
+        {
+            case MessageKind_CameraFrame:
+            {
+                const CameraFrame& cameraFrame = message.as<CameraFrame>();
+
+                time = (cameraFrame.depthImage.isEmpty() ? cameraFrame.colorImage : cameraFrame.depthImage).cameraInfo.timestamp;
+
+                break;
+            }
+
+            case MessageKind_Image:              time = message.as<Image>().cameraInfo.timestamp; break;
+            case MessageKind_CameraPose:         time = message.as<CameraPose>().timestamp; break;
+            case MessageKind_GyroscopeEvent:     time = message.as<GyroscopeEvent>().timestamp; break;
+            case MessageKind_AccelerometerEvent: time = message.as<AccelerometerEvent>().timestamp; break;
+            case MessageKind_DeviceMotionEvent:  time = message.as<DeviceMotionEvent>().timestamp; break;
+
+            default:
+                return false;
+        }
+
+        return 0. < time; // Unknown capture times are negative.
+    }
+
+private:
+    // Received messages need a clock estimate to tell their age.
+    bool remoteCaptureTime (const Message& message, double& time) const
+    {
+        double remoteTime;
+
+        return captureTime(message, remoteTime) && remoteClock.localTime(remoteTime, time);
     }
 
     template < class Message >
@@ -95,6 +193,8 @@ private:
         
         const_cast<Message&>(message).sessionId = sessionId;
 
+        message.forgetSerializedSize(); // Resent messages may have changed.
+
         queue.pushByCopy(message);
 
         uplink_log_debug("%s queued for sending: %s (session: %d)", message.name(), message.toString().c_str(), message.sessionId);
@@ -114,6 +214,8 @@ private:
         
         message.sessionId = sessionId;
 
+        message.forgetSerializedSize(); // Resent messages may have changed.
+
         uplink_log_debug("%s queued for sending: %s (session: %d)", message.name(), message.toString().c_str(), message.sessionId);
         messagePushed(message);
 
@@ -145,6 +247,17 @@ private:
 private:
     bool sendMessage (MessageOutput& output, const Message& message);
 
+    // Clock synchronization messages skip the queues and the session checks, so that their times stay accurate.
+    bool sendClockSync    (MessageOutput& output, bool& sent);
+    void receiveClockSync (const ClockSync& clockSync, double receptionTime);
+
+    StopWatch clockSyncStopWatch; // Since the last request. Sender thread only.
+
+public:
+    // Remote clock estimate, from the periodic exchanges enabled by SessionSettings::clockSyncInterval.
+    // Frame ages, on delivery, are: getTime() - local time of their capture timestamp.
+    ClockOffsetEstimator remoteClock;
+
 public:
     bool sendVersionInfo        (const  VersionInfo      & versionInfo       ) { return sendMessageByCopy(versionInfo       , SystemSessionId,         versionInfoQueue); }
     bool sendSessionSetup       (const  SessionSetup     & sessionSetup      )
@@ -188,26 +301,57 @@ public:
     {
         struct Stage
         {
+            Stage ()
+            : traffic(0.)
+            , messages(0)
+            , bytes(0)
+            , ages(0)
+            {
+            }
+
             void add (const Message& message)
             {
-                traffic += message.serializedSize();
+                const size_t size = message.cachedSerializedSize();
+
+                traffic += size;
 
                 rate.tick();
+
+                if (0 == messages)
+                    return;
+
+                messages->add();
+                bytes->add(size);
+            }
+
+            void addAge (double seconds)
+            {
+                latency.add(seconds);
+
+                if (0 != ages)
+                    ages->add(seconds);
             }
             
             String toString () const
             {
-                return formatted_copy("Traffic: %s Rate: %s", prettyByteSize(traffic).c_str(), rate.toString().c_str());
+                return formatted_copy("Traffic: %s Rate: %s %s", prettyByteSize(traffic).c_str(), rate.toString().c_str(), latency.toString().c_str());
             }
 
             void reset ()
             {
                 traffic = 0.;
                 rate.reset();
+                latency.reset();
             }
         
-            double        traffic;
-            RateEstimator rate;
+            double           traffic;
+            RateEstimator    rate;
+            LatencyHistogram latency; // Since capture, for timestamped messages. Remote ones need clock synchronization.
+
+            // Thread-safe mirrors, exposed by the context metrics. See: Endpoint::registerMetrics.
+            MetricCounter*   messages;
+            MetricCounter*   bytes;
+            MetricHistogram* ages; // Timestamped channels only.
         };
 
         void logInfo (CString channelName)
@@ -237,6 +381,64 @@ public:
 public: // FIXME: This should be private.
     std::vector<ChannelStat> channelStats;
 
+private:
+    // Channel, queue and codec metrics, in the context registry, labelled by endpoint.
+    void registerMetrics ();
+    void unregisterMetrics ();
+
+    template < class Message >
+    void collectQueueMetrics (MetricsRegistry& metrics, MessageKind kind, const Queue<Message>& queue) const;
+
+    struct CodecMetrics
+    {
+        MetricHistogram* seconds;
+        MetricCounter*   inputBytes;
+        MetricCounter*   outputBytes;
+        MetricGauge*     ratio;
+    };
+
+    enum { Compressing, Decompressing, NumCodecOperations };
+
+    static size_t imageSizeInBytes (const Image& image)
+    {
+        size_t size = 0;
+
+        for (int n = 0; n < Image::MaxNumPlanes; ++n)
+            size += image.planes[n].sizeInBytes;
+
+        return size;
+    }
+
+    // Codec calls are timed, and their input and output sizes counted.
+    template < typename Call >
+    bool measureCodecCall (ImageCodecId codec, int operation, const Image& source, const Image& target, const Call& call) const
+    {
+        const size_t sourceSize = imageSizeInBytes(source);
+        const double start      = getTime();
+
+        return_false_unless(call());
+
+        const CodecMetrics& metrics = codecMetrics[codec][operation];
+
+        const size_t targetSize = imageSizeInBytes(target);
+
+        metrics.seconds->add(getTime() - start);
+        metrics.inputBytes->add(sourceSize);
+        metrics.outputBytes->add(targetSize);
+
+        const size_t compressedSize   = Compressing == operation ? targetSize : sourceSize;
+        const size_t uncompressedSize = Compressing == operation ? sourceSize : targetSize;
+
+        if (0 < compressedSize)
+            metrics.ratio->set(double(uncompressedSize) / double(compressedSize));
+
+        return true;
+    }
+
+    String       metricsLabel;
+    int          metricsCollector;
+    CodecMetrics codecMetrics [ImageCodecId_HowMany][NumCodecOperations];
+
 protected:
     template < typename Type>
     void setChannelSettings (const ChannelSettings& settings, Queue<Type>& queue);
@@ -275,6 +477,10 @@ private:
 protected:
     friend class Wire;
     Wire* wire;
+
+private:
+    Mutex       messageTapMutex; // Held while the tap runs.
+    MessageTap* messageTap;
     
 private:
     template < class Message > bool sendSimpleMessage (Queue<Message>& messageQueue, MessageOutput& output, bool& sent);
@@ -283,9 +489,22 @@ private:
 public:
     ImageCodecs imageCodecs;
 
+    // Delivers camera frames with compressed images, that decompress upon first access through Image::decompressed.
+    // Applications recording or forwarding frames then skip decompression, and forwarded images skip recompression.
+    bool lazyCameraImageDecompression;
+
+    // Maximum number of received messages being decoded concurrently, while the wire keeps reading the following ones.
+    // Zero: messages are decoded and delivered on the wire receiving thread, one at a time.
+    int receivePipelineDepth;
+
 private:
     bool canCompressFeedbackImage (const Image& image) const
     {
+        if (image.isCompressed()) // Passed through, as long as the receiver can decompress it.
+            return currentSessionSettings.feedbackImageCodec != ImageCodecId_Invalid
+                && imageCodecs.decompressorOf(image.format) == currentSessionSettings.feedbackImageCodec
+                ;
+
         return currentSessionSettings.feedbackImageCodec != ImageCodecId_Invalid
             && imageCodecs.byId[currentSessionSettings.feedbackImageCodec].canCompress(image.format)
             ;
@@ -298,13 +517,41 @@ private:
             ;
     }
 
-    bool compressFeedbackImage (const Image& source, Image& target) const
+    bool compressFeedbackImage (Image& source, Image& target) const
     {
-        ScopedProfiledTask _(ProfilerTask_CompressImage);
-    
         assert(canCompressFeedbackImage(source));
 
-        return imageCodecs.byId[currentSessionSettings.feedbackImageCodec].compress(source, target);
+        if (source.isCompressed())
+            return passImage(source, target);
+
+        ScopedProfiledTask _(ProfilerTask_CompressImage);
+
+        const ImageCodecId codec = currentSessionSettings.feedbackImageCodec;
+
+        return measureCodecCall(codec, Compressing, source, target, [&] () { return imageCodecs.byId[codec].compress(source, target); });
+    }
+
+    // Feedback images are downscaled before compression, as configured by the session settings.
+    // Compressed images, which would otherwise pass through, are decompressed first when they can be.
+    bool downscaleFeedbackImage (Image& image) const
+    {
+        const int factor = currentSessionSettings.feedbackImageDownscale;
+
+        return_true_if(factor < 2 || image.isEmpty());
+
+        const Image& source = image.decompressed();
+
+        return_false_unless(canDownscaleImage(source));
+
+        Image downscaled;
+
+        return_false_unless(downscale_image(source, downscaled, factor));
+
+        downscaled.sessionId = image.sessionId;
+
+        image.swapWith(downscaled);
+
+        return true;
     }
 
     bool decompressFeedbackImage (const Image& source, Image& target) const
@@ -312,74 +559,255 @@ private:
         ScopedProfiledTask _(ProfilerTask_DecompressImage);
 
         assert(canDecompressFeedbackImage(source));
-    
-        return imageCodecs.byId[currentSessionSettings.feedbackImageCodec].decompress(source, target);
+
+        const ImageCodecId codec = currentSessionSettings.feedbackImageCodec;
+
+        return measureCodecCall(codec, Decompressing, source, target, [&] () { return imageCodecs.byId[codec].decompress(source, target); });
     }
 
-    bool canCompressColorCameraImage (const Image& image) const
-    {    
-        return currentSessionSettings.colorCameraCodec != ImageCodecId_Invalid
-            && imageCodecs.byId[currentSessionSettings.colorCameraCodec].canCompress(image.format)
-            ;
+    // Camera images are compressed with per-image codecs, picked among the session codec and the other
+    // codecs advertised in the session settings. ImageCodecId_Invalid stands for uncompressed images.
+
+    ImageCodecId selectColorCameraCodec (const Image& image)
+    {
+        return colorCameraCodecSelector.select(imageCodecs, currentSessionSettings.colorCameraCodec, currentSessionSettings.colorCameraCodecs, image);
     }
 
-    bool canDecompressColorCameraImage (const Image& image) const
+    ImageCodecId selectDepthCameraCodec (const Image& image)
+    {
+        return depthCameraCodecSelector.select(imageCodecs, currentSessionSettings.depthCameraCodec, currentSessionSettings.depthCameraCodecs, image);
+    }
+
+    bool canCompressCameraImage (const Image& image, ImageCodecId codec, ImageCodecId sessionCodec, uint32 codecs) const
+    {
+        if (image.isCompressed()) // Passed through, as long as the receiver can decompress it.
+            return canDecompressCameraImage(image, sessionCodec, codecs);
+
+        if (ImageCodecId_Invalid == codec)
+            return 0 != (codecs & UncompressedImageCodecBit) && !image.isCompressed();
+
+        return imageCodecs.byId[codec].canCompress(image.format);
+    }
+
+    // Images are tagged with their format, so that receivers decompress each of them with the matching codec.
+    bool canDecompressCameraImage (const Image& image, ImageCodecId sessionCodec, uint32 codecs) const
     {
-        return currentSessionSettings.colorCameraCodec != ImageCodecId_Invalid
-            && imageCodecs.byId[currentSessionSettings.colorCameraCodec].canDecompress(image.format)
+        if (!image.isCompressed())
+            return 0 != (codecs & UncompressedImageCodecBit);
+
+        const ImageCodecId codec = imageCodecs.decompressorOf(image.format);
+
+        return codec != ImageCodecId_Invalid
+            && (codec == sessionCodec || 0 != (codecs & imageCodecBit(codec)))
             ;
     }
 
-    bool compressColorCameraImage (const Image& source, Image& target) const
+    // Moves an image that needs no (de)compression, leaving the source session identifier in place.
+    static bool passImage (Image& source, Image& target)
     {
+        const SessionId sessionId = source.sessionId;
+
+        source.swapWith(target);
+
+        source.sessionId = sessionId;
+
+        return true;
+    }
+
+    // Near-lossless shifts compress within the given error bound, rather than that of the current session.
+    bool compressCameraImage (Image& source, Image& target, ImageCodecId codec, int maxShiftError) const
+    {
+        if (ImageCodecId_Invalid == codec || source.isCompressed())
+            return passImage(source, target); // Sent as is.
+
         ScopedProfiledTask _(ProfilerTask_CompressImage);
-    
-        assert(canCompressColorCameraImage(source));
 
-        return imageCodecs.byId[currentSessionSettings.colorCameraCodec].compress(source, target);
+        if (ImageCodecId_NearLosslessShifts == codec)
+            return measureCodecCall(codec, Compressing, source, target, [&] () { return compress_image_Shifts_NearLosslessShifts(source, target, maxShiftError); });
+
+        return measureCodecCall(codec, Compressing, source, target, [&] () { return imageCodecs.byId[codec].compress(source, target); });
     }
 
-    bool decompressColorCameraImage (const Image& source, Image& target) const
+    bool decompressCameraImage (Image& source, Image& target) const
     {
+        if (!source.isCompressed())
+            return passImage(source, target); // Received as is.
+
+        const ImageCodecId codec = imageCodecs.decompressorOf(source.format);
+
+        report_false_if("Camera image not decompressed (no codec).", ImageCodecId_Invalid == codec);
+
+        if (lazyCameraImageDecompression)
+        {
+            passImage(source, target);
+
+            target.decompressor = imageCodecs.byId[codec].decompress;
+
+            return true;
+        }
+
         ScopedProfiledTask _(ProfilerTask_DecompressImage);
 
+        return measureCodecCall(codec, Decompressing, source, target, [&] () { return imageCodecs.byId[codec].decompress(source, target); });
+    }
+
+    bool canCompressColorCameraImage (const Image& image, ImageCodecId codec) const
+    {
+        return canCompressCameraImage(image, codec, currentSessionSettings.colorCameraCodec, currentSessionSettings.colorCameraCodecs);
+    }
+
+    bool canDecompressColorCameraImage (const Image& image) const
+    {
+        return canDecompressCameraImage(image, currentSessionSettings.colorCameraCodec, currentSessionSettings.colorCameraCodecs);
+    }
+
+    // Compressions run concurrently with session setups, and only see the session settings they started with.
+    bool compressColorCameraImage (Image& source, Image& target, ImageCodecId codec, const SessionSettings& sessionSettings) const
+    {
+        assert(canCompressCameraImage(source, codec, sessionSettings.colorCameraCodec, sessionSettings.colorCameraCodecs));
+
+        return compressCameraImage(source, target, codec, 0);
+    }
+
+    bool decompressColorCameraImage (Image& source, Image& target) const
+    {
         assert(canDecompressColorCameraImage(source));
-    
-        return imageCodecs.byId[currentSessionSettings.colorCameraCodec].decompress(source, target);
+
+        return decompressCameraImage(source, target);
     }
 
-    bool canCompressDepthCameraImage (const Image& image) const
+    bool canCompressDepthCameraImage (const Image& image, ImageCodecId codec) const
     {
-        return currentSessionSettings.depthCameraCodec != ImageCodecId_Invalid
-            && imageCodecs.byId[currentSessionSettings.depthCameraCodec].canCompress(image.format)
-            ;
+        return canCompressCameraImage(image, codec, currentSessionSettings.depthCameraCodec, currentSessionSettings.depthCameraCodecs);
     }
-    
+
     bool canDecompressDepthCameraImage (const Image& image) const
     {
-        return currentSessionSettings.depthCameraCodec != ImageCodecId_Invalid
-            && imageCodecs.byId[currentSessionSettings.depthCameraCodec].canDecompress(image.format)
-            ;
+        return canDecompressCameraImage(image, currentSessionSettings.depthCameraCodec, currentSessionSettings.depthCameraCodecs);
     }
-    
-    bool compressDepthCameraImage (const Image& source, Image& target) const
+
+    bool compressDepthCameraImage (Image& source, Image& target, ImageCodecId codec, const SessionSettings& sessionSettings, int maxShiftError) const
     {
-        ScopedProfiledTask _(ProfilerTask_CompressImage);
+        assert(canCompressCameraImage(source, codec, sessionSettings.depthCameraCodec, sessionSettings.depthCameraCodecs));
 
-        assert(canCompressDepthCameraImage(source));
-    
-        return imageCodecs.byId[currentSessionSettings.depthCameraCodec].compress(source, target);
+        return compressCameraImage(source, target, codec, maxShiftError);
     }
 
-    bool decompressDepthCameraImage (const Image& source, Image& target) const
+    bool decompressDepthCameraImage (Image& source, Image& target) const
     {
-        ScopedProfiledTask _(ProfilerTask_DecompressImage);
-    
         assert(canDecompressDepthCameraImage(source));
 
-        return imageCodecs.byId[currentSessionSettings.depthCameraCodec].decompress(source, target);
+        if (!currentSessionSettings.deliverDepthInMillimeters)
+            return decompressCameraImage(source, target);
+
+        const uplink_ref<const ShiftToDepthTable> table = shiftToDepthTable(source.cameraInfo);
+
+        if (!source.isCompressed())
+        {
+            passImage(source, target); // Received as is.
+
+            return convert_image_Shifts_DepthMillimeters(target, *table);
+        }
+
+        const ImageCodecId codecId = imageCodecs.decompressorOf(source.format);
+        const ImageCodec&  codec   = imageCodecs.byId[codecId];
+
+        if (lazyCameraImageDecompression)
+        {
+            passImage(source, target);
+
+            target.decompressor = [codec, table] (const Image& source, Image& target)
+            {
+                return decompress_image_to_depth(codec, source, target, *table);
+            };
+
+            return true;
+        }
+
+        ScopedProfiledTask _(ProfilerTask_DecompressImage);
+
+        return measureCodecCall(codecId, Decompressing, source, target, [&] () { return decompress_image_to_depth(codec, source, target, *table); });
     }
 
+    // Depth tables are shared by concurrent decodings, and only regenerated when the calibration changes.
+    uplink_ref<const ShiftToDepthTable> shiftToDepthTable (const CameraInfo& cameraInfo) const
+    {
+        const MutexLocker _(shiftToDepthTableMutex);
+
+        if (!shiftToDepthTableCache || !shiftToDepthTableCache->matches(cameraInfo))
+        {
+            uplink_ref<ShiftToDepthTable> table(new ShiftToDepthTable());
+
+            table->update(cameraInfo);
+
+            shiftToDepthTableCache = table;
+        }
+
+        return shiftToDepthTableCache;
+    }
+
+private:
+    ImageCodecSelector colorCameraCodecSelector;
+    ImageCodecSelector depthCameraCodecSelector;
+
+    mutable Mutex                               shiftToDepthTableMutex;
+    mutable uplink_ref<const ShiftToDepthTable> shiftToDepthTableCache;
+
+private:
+    // Camera frames are compressed on the context task pool, one at a time, while the previous one is being sent.
+    // Color and depth images compress concurrently.
+    struct CameraFrameCompression
+    {
+        enum State { Idle, Compressing, Compressed };
+
+        CameraFrameCompression () : maxShiftError(0), state(Idle), succeeded(false) {}
+
+        State getState () const { const MutexLocker _(mutex); return state; }
+
+        void wait ()
+        {
+            const MutexLocker _(mutex);
+
+            while (Compressing == state)
+                completed.waitLocked(&mutex);
+        }
+
+        // Waits for the compression in flight, and drops its frame, which belongs to the previous session.
+        void reset ()
+        {
+            const MutexLocker _(mutex);
+
+            while (Compressing == state)
+                completed.waitLocked(&mutex);
+
+            compressedCameraFrame = CameraFrame();
+            state = Idle;
+        }
+
+        CameraFrame     cameraFrame;
+        CameraFrame     compressedCameraFrame;
+        ImageCodecId    colorCodec;
+        ImageCodecId    depthCodec;
+        SessionSettings sessionSettings; // Snapshots, as the receiver thread sets up sessions while compressing.
+        int             maxShiftError;
+        mutable Mutex   mutex;
+        Condition       completed;
+        State           state;
+        bool            succeeded;
+    };
+
+    void startCameraFrameCompression (CameraFrame& cameraFrame, ImageCodecId colorCodec, ImageCodecId depthCodec);
+
+    CameraFrameCompression cameraFrameCompression;
+
+private:
+    // Decompressed depth camera images are filtered spatially while decoding, and temporally upon in-order delivery,
+    // as configured by the session settings. Lazily decompressed images are delivered unfiltered.
+    bool filterDepthCameraImageSpatially  (Image& depthImage) const;
+    bool filterDepthCameraImageTemporally (Image& depthImage);
+
+    DepthTemporalFilter depthTemporalFilter;
+
 public:
     SessionSetup    lastSessionSetup;
     SessionSettings currentSessionSettings;
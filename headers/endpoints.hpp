@@ -14,6 +14,9 @@ inline
 Endpoint::Endpoint ()
     : currentSessionId(InvalidSessionId)
     , wire(0)
+    , messageTap(0)
+    , lazyCameraImageDecompression(false)
+    , receivePipelineDepth(0)
 {
     // Color implementations will be supplied elsewhere.
 
@@ -25,6 +28,7 @@ Endpoint::Endpoint ()
 
     ++numChannels; // VersionInfo
     ++numChannels; // CustomCommand
+    ++numChannels; // ClockSync
 
 # define UPLINK_MESSAGE(Name, name) \
     name##Queue.setMaximumSize(1);  \
@@ -35,6 +39,8 @@ Endpoint::Endpoint ()
     assert(MessageKind_HowMany == numChannels);
     
     channelStats.resize(numChannels);
+
+    registerMetrics();
         
     // The command queue is kind of a special case. We almost never want to drop them.
     customCommandQueue.setMaximumSize(0); // This should be the default, but making sure.
@@ -56,9 +62,108 @@ Endpoint::~Endpoint()
 {
     uplink_log_debug("~Endpoint");
 
+    // No compression starts once the wire is stopped, and compression tasks refer to the endpoint and its wire.
+    if (0 != wire)
+        wire->stop();
+
+    cameraFrameCompression.wait();
+
     zero_delete(wire);
+
+    unregisterMetrics();
+}
+
+inline void
+Endpoint::registerMetrics ()
+{
+    static std::atomic<int> nextEndpoint(0);
+
+    metricsLabel = metric_label("endpoint", toString(nextEndpoint++));
+
+    MetricsRegistry& metrics = context.metrics();
+
+    static CString const stageNames [] = { "pushing", "sending", "receiving", "delivering" };
+
+    for (int kind = 0; kind < MessageKind_HowMany; ++kind)
+    {
+        ChannelStat& channelStat = channelStats[kind];
+
+        ChannelStat::Stage* const stages [] = { &channelStat.pushing, &channelStat.sending, &channelStat.receiving, &channelStat.delivering };
+
+        for (int n = 0; n < int(sizeof_array(stages)); ++n)
+        {
+            const String labels = metricsLabel
+                + "," + metric_label("channel", message_kind_name(MessageKind_Enum(kind)))
+                + "," + metric_label("stage", stageNames[n])
+                ;
+
+            stages[n]->messages = &metrics.counter("uplink_messages_total"     , "Messages, per channel and stage."                 , labels);
+            stages[n]->bytes    = &metrics.counter("uplink_message_bytes_total", "Serialized message bytes, per channel and stage.", labels);
+
+            if (isTimestamped(MessageKind_Enum(kind)))
+                stages[n]->ages = &metrics.histogram("uplink_message_age_seconds", "Message ages since capture, per channel and stage. Received ones need clock synchronization.", labels);
+        }
+    }
+
+    // Codecs are shared by all endpoints.
+    static CString const operationNames [] = { "compress", "decompress" };
+
+    for (int codec = 0; codec < ImageCodecId_HowMany; ++codec)
+    {
+        for (int operation = 0; operation < NumCodecOperations; ++operation)
+        {
+            const String labels = metric_label("codec", imageCodecName(ImageCodecId_Enum(codec))) + "," + metric_label("operation", operationNames[operation]);
+
+            CodecMetrics& codecMetrics = this->codecMetrics[codec][operation];
+
+            codecMetrics.seconds     = &metrics.histogram("uplink_codec_seconds"           , "Image codec times."                                          , labels);
+            codecMetrics.inputBytes  = &metrics.counter  ("uplink_codec_input_bytes_total" , "Image codec input bytes."                                    , labels);
+            codecMetrics.outputBytes = &metrics.counter  ("uplink_codec_output_bytes_total", "Image codec output bytes."                                   , labels);
+            codecMetrics.ratio       = &metrics.gauge    ("uplink_codec_compression_ratio" , "Uncompressed over compressed image sizes, of the last image.", labels);
+        }
+    }
+
+    // Queues keep their own counts, which are read on collection.
+    metricsCollector = metrics.addCollector([this] ()
+    {
+        MetricsRegistry& metrics = context.metrics();
+
+# define UPLINK_MESSAGE(Name, name) \
+        collectQueueMetrics(metrics, MessageKind_##Name, name##Queue);
+         UPLINK_MESSAGES()
+# undef  UPLINK_MESSAGE
+    });
 }
 
+inline void
+Endpoint::unregisterMetrics ()
+{
+    context.metrics().removeCollector(metricsCollector);
+    context.metrics().removeSeries(metricsLabel);
+}
+
+template < class Message >
+inline void
+Endpoint::collectQueueMetrics (MetricsRegistry& metrics, MessageKind kind, const Queue<Message>& queue) const
+{
+    const String labels = metricsLabel + "," + metric_label("channel", message_kind_name(kind));
+
+    metrics.gauge("uplink_queue_length", "Queued messages, per channel.", labels).set(queue.getSize());
+
+    metrics.gauge("uplink_queue_usage_ratio", "Queued messages over the queue capacity, per channel. Zero for unbounded queues.", labels).set(queue.getUsageRatio());
+
+    static CString const strategyNames [] = { "oldest_one", "random_one", "random_five_percent", "one_every_ten" };
+
+    for (int strategy = 0; strategy < Queue<Message>::NumDroppingStrategies; ++strategy)
+        metrics.counter(
+            "uplink_queue_dropped_total",
+            "Messages dropped by full queues, since their creation, per channel and dropping strategy.",
+            labels + "," + metric_label("strategy", strategyNames[strategy])
+        ).set(queue.getNumDropped(typename Queue<Message>::DroppingStrategy(strategy)));
+}
+
+//------------------------------------------------------------------------------
+
 inline bool
 Endpoint::isConnected () const
 {
@@ -74,6 +179,14 @@ Endpoint::disconnect ()
     wire = 0;
 }
 
+inline void
+Endpoint::setMessageTap (MessageTap* tap)
+{
+    const MutexLocker _(messageTapMutex);
+
+    messageTap = tap;
+}
+
 inline void
 Endpoint::registerMessages (MessageSerializer& messageSerializer)
 {
@@ -90,6 +203,8 @@ Endpoint::sendMessages (MessageOutput& output, bool& sent)
 {
     // FIXME: Rework message scheduling.
 
+    return_false_unless(sendClockSync(output, sent));
+
     VersionInfo versionInfo;
     if (versionInfoQueue.popBySwap(versionInfo))
     {
@@ -148,6 +263,9 @@ Endpoint::sendMessages (MessageOutput& output, bool& sent)
         Image image;
         if (imageQueue.popBySwap(image))
         {
+            if (!downscaleFeedbackImage(image))
+                uplink_log_warning("%s sent at full resolution (cannot downscale).", image.name());
+
             if ((image.isEmpty() || canCompressFeedbackImage(image)))
             {
                 if (isActiveSession(image.sessionId))
@@ -187,45 +305,38 @@ Endpoint::sendMessages (MessageOutput& output, bool& sent)
     }
 
     {
-        CameraFrame cameraFrame;
-        if (cameraFrameQueue.popBySwap(cameraFrame))
-        {
-            if ((cameraFrame.colorImage.isEmpty() || canCompressColorCameraImage(cameraFrame.colorImage))
-             && (cameraFrame.depthImage.isEmpty() || canCompressDepthCameraImage(cameraFrame.depthImage)))
-            {
-                if (isActiveSession(cameraFrame.sessionId))
-                {
-                    CameraFrame compressedCameraFrame;
+        // The previous camera frame is sent while the next one compresses.
 
-                    if (cameraFrame.colorImage.isEmpty())
-                    {
-                        cameraFrame.colorImage.swapWith(compressedCameraFrame.colorImage);
-                    }
-                    else
-                    {
-                        if (!compressColorCameraImage(cameraFrame.colorImage, compressedCameraFrame.colorImage))
-                            return false;
+        CameraFrame compressedCameraFrame;
+        bool        compressed = false;
+        bool        compressionSucceeded = false;
 
-                        compressedCameraFrame.colorImage.sessionId = cameraFrame.colorImage.sessionId;
-                    }
-                    
-                    if (cameraFrame.depthImage.isEmpty())
-                    {
-                        cameraFrame.depthImage.swapWith(compressedCameraFrame.depthImage);
-                    }
-                    else
-                    {
-                        if (!compressDepthCameraImage(cameraFrame.depthImage, compressedCameraFrame.depthImage))
-                            return false;
-                        
-                        compressedCameraFrame.depthImage.sessionId = cameraFrame.depthImage.sessionId;
-                    }
+        {
+            const MutexLocker _(cameraFrameCompression.mutex); // Resetting the endpoint may drop the compressed frame.
 
-                    return_false_unless(sendMessage(output, compressedCameraFrame));
+            if (CameraFrameCompression::Compressed == cameraFrameCompression.state)
+            {
+                compressedCameraFrame.swapWith(cameraFrameCompression.compressedCameraFrame);
+                compressionSucceeded = cameraFrameCompression.succeeded;
+                compressed = true;
 
-                    compressedCameraFrame.sessionId = cameraFrame.sessionId;
+                cameraFrameCompression.state = CameraFrameCompression::Idle;
+            }
+        }
 
-                    sent = true;
+        CameraFrame cameraFrame;
+        if (CameraFrameCompression::Idle == cameraFrameCompression.getState() && cameraFrameQueue.popBySwap(cameraFrame))
+        {
+            // Already compressed images are passed through.
+            const ImageCodecId colorCodec = cameraFrame.colorImage.isCompressedOrEmpty() ? ImageCodecId(ImageCodecId_Invalid) : selectColorCameraCodec(cameraFrame.colorImage);
+            const ImageCodecId depthCodec = cameraFrame.depthImage.isCompressedOrEmpty() ? ImageCodecId(ImageCodecId_Invalid) : selectDepthCameraCodec(cameraFrame.depthImage);
+
+            if ((cameraFrame.colorImage.isEmpty() || canCompressColorCameraImage(cameraFrame.colorImage, colorCodec))
+             && (cameraFrame.depthImage.isEmpty() || canCompressDepthCameraImage(cameraFrame.depthImage, depthCodec)))
+            {
+                if (isActiveSession(cameraFrame.sessionId))
+                {
+                    startCameraFrameCompression(cameraFrame, colorCodec, depthCodec);
                 }
                 else
                 {
@@ -238,13 +349,91 @@ Endpoint::sendMessages (MessageOutput& output, bool& sent)
             
                 uplink_log_warning("%s not sent (cannot compress).", cameraFrame.name());
             }
+        }
+
+        if (compressed)
+        {
+            return_false_unless(compressionSucceeded);
+
+            if (isActiveSession(compressedCameraFrame.sessionId))
+            {
+                return_false_unless(sendMessage(output, compressedCameraFrame));
 
+                sent = true;
+            }
+            else
+            {
+                uplink_log_warning("%s not sent (stale session: %d).", compressedCameraFrame.name(), compressedCameraFrame.sessionId);
+            }
         }
     }
 
     return true;
 }
 
+inline void
+Endpoint::startCameraFrameCompression (CameraFrame& cameraFrame, ImageCodecId colorCodec, ImageCodecId depthCodec)
+{
+    {
+        const MutexLocker _(cameraFrameCompression.mutex);
+
+        assert(CameraFrameCompression::Idle == cameraFrameCompression.state);
+
+        cameraFrameCompression.cameraFrame.swapWith(cameraFrame);
+        cameraFrameCompression.compressedCameraFrame = CameraFrame();
+        cameraFrameCompression.colorCodec = colorCodec;
+        cameraFrameCompression.depthCodec = depthCodec;
+        cameraFrameCompression.sessionSettings = currentSessionSettings;
+        cameraFrameCompression.maxShiftError = imageCodecs.maxShiftError;
+        cameraFrameCompression.state = CameraFrameCompression::Compressing;
+    }
+
+    context.tasks().post([this] ()
+    {
+        // Only this task accesses the frames and the snapshots while compressing.
+        CameraFrame& source = cameraFrameCompression.cameraFrame;
+        CameraFrame& target = cameraFrameCompression.compressedCameraFrame;
+
+        const SessionSettings& sessionSettings = cameraFrameCompression.sessionSettings;
+
+        bool succeeded [2] = { true, true };
+
+        context.tasks().parallelFor(2, [&] (int n)
+        {
+            Image& sourceImage = 0 == n ? source.colorImage : source.depthImage;
+            Image& targetImage = 0 == n ? target.colorImage : target.depthImage;
+
+            if (sourceImage.isEmpty())
+            {
+                sourceImage.swapWith(targetImage);
+
+                return;
+            }
+
+            succeeded[n] = 0 == n
+                ? compressColorCameraImage(sourceImage, targetImage, cameraFrameCompression.colorCodec, sessionSettings)
+                : compressDepthCameraImage(sourceImage, targetImage, cameraFrameCompression.depthCodec, sessionSettings, cameraFrameCompression.maxShiftError)
+                ;
+
+            targetImage.sessionId = sourceImage.sessionId;
+        });
+
+        target.sessionId = source.sessionId;
+
+        source = CameraFrame(); // Release the uncompressed images early.
+
+        const MutexLocker _(cameraFrameCompression.mutex);
+
+        cameraFrameCompression.succeeded = succeeded[0] && succeeded[1];
+        cameraFrameCompression.state = CameraFrameCompression::Compressed;
+        cameraFrameCompression.completed.broadcast();
+
+        // Under the lock, as the endpoint waits for compressions to complete before deleting its wire.
+        if (0 != wire)
+            wire->notifySender();
+    });
+}
+
 inline bool
 Endpoint::sendMessage (MessageOutput& output, const Message& message)
 {
@@ -255,6 +444,61 @@ Endpoint::sendMessage (MessageOutput& output, const Message& message)
     return true;
 }
 
+inline bool
+Endpoint::sendClockSync (MessageOutput& output, bool& sent)
+{
+    ClockSync reply;
+    if (clockSyncQueue.popBySwap(reply))
+    {
+        reply.replySent = getTime();
+
+        return_false_unless(sendMessage(output, reply));
+
+        sent = true;
+    }
+
+    const double interval = currentSessionSettings.clockSyncInterval;
+
+    if (0. < interval && interval <= clockSyncStopWatch.elapsed())
+    {
+        ClockSync request;
+        request.sessionId   = SystemSessionId;
+        request.requestSent = getTime();
+
+        return_false_unless(sendMessage(output, request));
+
+        clockSyncStopWatch.start();
+
+        sent = true;
+    }
+
+    return true;
+}
+
+inline void
+Endpoint::receiveClockSync (const ClockSync& clockSync, double receptionTime)
+{
+    if (clockSync.isReply)
+    {
+        remoteClock.addSample(clockSync.requestSent, clockSync.requestReceived, clockSync.replySent, receptionTime);
+
+        uplink_log_debug("Remote clock offset: %f s, drift: %g, round trip: %f s.", remoteClock.offset(receptionTime), remoteClock.drift(), remoteClock.roundTrip());
+
+        return;
+    }
+
+    ClockSync reply;
+    reply.sessionId       = SystemSessionId;
+    reply.isReply         = true;
+    reply.requestSent     = clockSync.requestSent;
+    reply.requestReceived = receptionTime;
+
+    clockSyncQueue.pushBySwap(reply);
+
+    if (0 != wire)
+        wire->notifySender();
+}
+
 inline bool
 Endpoint::receiveMessage (Message* message)
 {
@@ -264,17 +508,122 @@ Endpoint::receiveMessage (Message* message)
 
     messageReceived(*message);
 
-    switch (message->kind())
+    bool discarded = false;
+
+    return_false_unless(decodeMessage(*message, discarded));
+
+    return_true_if(discarded);
+
+    return deliverDecodedMessage(*message);
+}
+
+inline bool
+Endpoint::decodeMessage (Message& message, bool& discarded)
+{
+    discarded = false;
+
+    switch (message.kind())
+    {
+        case MessageKind_Image:
+        {
+            Image& image = message.as<Image>();
+            
+            if (!canDecompressFeedbackImage(image))
+            {
+                uplink_log_warning("%s discarded (cannot decompress: %d).", message.name(), message.sessionId);
+                discarded = true;
+                return true;
+            }
+            
+            if (!isActiveSession(message.sessionId))
+            {
+                uplink_log_warning("%s discarded (stale session: %d).", message.name(), message.sessionId);
+                discarded = true;
+                return true;
+            }
+
+            Image decompressedImage;
+
+            if (!decompressFeedbackImage(image, decompressedImage))
+                return false;
+
+            decompressedImage.sessionId = image.sessionId;
+
+            image.swapWith(decompressedImage);
+
+            return true;
+        }
+        
+        case MessageKind_CameraFrame:
+        {
+            CameraFrame& cameraFrame = message.as<CameraFrame>();
+
+            if ((!cameraFrame.colorImage.isEmpty() && !canDecompressColorCameraImage(cameraFrame.colorImage))
+             || (!cameraFrame.depthImage.isEmpty() && !canDecompressDepthCameraImage(cameraFrame.depthImage)))
+            {
+                uplink_log_warning("%s discarded (cannot decompress: %d).", message.name(), message.sessionId);
+                discarded = true;
+                return true;
+            }
+
+            if (!isActiveSession(message.sessionId))
+            {
+                uplink_log_warning("%s discarded (stale session: %d).", message.name(), message.sessionId);
+                discarded = true;
+                return true;
+            }
+
+            if (!cameraFrame.depthImage.isEmpty())
+            {
+                Image decompressedImage;
+
+                if (!decompressDepthCameraImage(cameraFrame.depthImage, decompressedImage))
+                    return false;
+                
+                decompressedImage.sessionId = cameraFrame.depthImage.sessionId;
+
+                cameraFrame.depthImage.swapWith(decompressedImage);
+
+                if (!filterDepthCameraImageSpatially(cameraFrame.depthImage))
+                    uplink_log_warning("Depth camera image delivered unfiltered.");
+            }
+
+            if (!cameraFrame.colorImage.isEmpty())
+            {
+                Image decompressedImage;
+
+                if (!decompressColorCameraImage(cameraFrame.colorImage, decompressedImage))
+                    return false;
+
+                decompressedImage.sessionId = cameraFrame.colorImage.sessionId;
+
+                cameraFrame.colorImage.swapWith(decompressedImage);
+            }
+
+            cameraFrame.forgetSerializedSize(); // Delivered frames are counted decoded.
+
+            return true;
+        }
+
+        default:
+            return true; // Nothing to decode.
+    }
+}
+
+inline bool
+Endpoint::deliverDecodedMessage (Message& message)
+{
+    switch (message.kind())
     {
         case MessageKind_CustomCommand:
         {
-            if (!isActiveSession(message->sessionId))
+            if (!isActiveSession(message.sessionId))
             {
                 uplink_log_warning("Custom command discarded (stale session).");
                 return true; // Skipping this stale command.
             }
             
-            const CustomCommand& customCommand = *downcast<CustomCommand>(message);
+            const CustomCommand& customCommand = message.as<CustomCommand>();
 
             uplink_log_debug("Custom command received: %s", customCommand.toString().c_str());
 
@@ -296,122 +645,59 @@ Endpoint::receiveMessage (Message* message)
 
         case MessageKind_SessionSetup:
         {
-            assert(SystemSessionId == message->sessionId);
+            assert(SystemSessionId == message.sessionId);
             uplink_log_debug("SessionSetup received.");
-            onSessionSetup(*downcast<SessionSetup>(message));
+            onSessionSetup(message.as<SessionSetup>());
             return true;
         }
 
         case MessageKind_SessionSetupReply:
         {
-            assert(SystemSessionId == message->sessionId);
+            assert(SystemSessionId == message.sessionId);
             uplink_log_debug("SessionSetupReply received.");
-            onSessionSetupReply(*downcast<SessionSetupReply>(message));
+            onSessionSetupReply(message.as<SessionSetupReply>());
             return true;
         }
 
         case MessageKind_VersionInfo:
         {
-            assert(SystemSessionId == message->sessionId);
+            assert(SystemSessionId == message.sessionId);
             uplink_log_debug("VersionInfo received.");
-            onVersionInfo(*downcast<VersionInfo>(message));
+            onVersionInfo(message.as<VersionInfo>());
             return true;
         }
 
+        case MessageKind_ClockSync:
+        {
+            return true; // Wires answer these as soon as they read them. See: Wire::Receiver.
+        }
+
         case MessageKind_GyroscopeEvent:
         case MessageKind_AccelerometerEvent:
         case MessageKind_DeviceMotionEvent:
         case MessageKind_CameraPose:
         {
-            return receiveSimpleMessage(message);
+            return receiveSimpleMessage(&message);
         }
 
         case MessageKind_Image:
-        {
-            assert(0 != message);
-
-            const Image& image = message->as<Image>();
-            
-            if (!canDecompressFeedbackImage(image))
-            {
-                uplink_log_warning("%s discarded (cannot decompress: %d).", message->name(), message->sessionId);
-                return true;
-            }
-            
-            if (!isActiveSession(message->sessionId))
-            {
-                uplink_log_warning("%s discarded (stale session: %d).", message->name(), message->sessionId);
-                return true;
-            }
-
-            Image decompressedImage;
-
-            if (!decompressFeedbackImage(image, decompressedImage))
-                return false;
-
-            decompressedImage.sessionId = image.sessionId;
-
-            uplink_log_debug("%s received.", message->name());
-
-            return deliverMessage(decompressedImage);
-        }
-        
         case MessageKind_CameraFrame:
         {
-            assert(0 != message);
+            // Decoding already discarded undecodable and stale images.
 
-            CameraFrame& cameraFrame = message->as<CameraFrame>();
+            uplink_log_debug("%s received.", message.name());
 
-            if ((!cameraFrame.colorImage.isEmpty() && !canDecompressColorCameraImage(cameraFrame.colorImage))
-             || (!cameraFrame.depthImage.isEmpty() && !canDecompressDepthCameraImage(cameraFrame.depthImage)))
-            {
-                uplink_log_warning("%s discarded (cannot decompress: %d).", message->name(), message->sessionId);
-                return true;
-            }
-
-            if (!isActiveSession(message->sessionId))
-            {
-                uplink_log_warning("%s discarded (stale session: %d).", message->name(), message->sessionId);
-                return true;
-            }
-
-            CameraFrame decompressedCameraFrame;
-
-            if (cameraFrame.depthImage.isEmpty())
-            {
-                cameraFrame.depthImage.swapWith(decompressedCameraFrame.depthImage);
-            }
-            else
-            {
-                if (!decompressDepthCameraImage(cameraFrame.depthImage, decompressedCameraFrame.depthImage))
-                    return false;
-                
-                decompressedCameraFrame.depthImage.sessionId = cameraFrame.depthImage.sessionId;
-            }
-
-            if (cameraFrame.colorImage.isEmpty())
-            {
-                cameraFrame.colorImage.swapWith(decompressedCameraFrame.colorImage);
-            }
-            else
-            {
-                if (!decompressColorCameraImage(cameraFrame.colorImage, decompressedCameraFrame.colorImage))
-                    return false;
-
-                decompressedCameraFrame.colorImage.sessionId = cameraFrame.colorImage.sessionId;
-            }
-
-            decompressedCameraFrame.sessionId = cameraFrame.sessionId;
-
-            uplink_log_debug("%s received.", message->name());
+            if (MessageKind_CameraFrame == message.kind()
+                && !filterDepthCameraImageTemporally(message.as<CameraFrame>().depthImage))
+                uplink_log_warning("Depth camera image delivered unfiltered.");
             
-            return deliverMessage(decompressedCameraFrame);
+            return deliverMessage(message);
         }
 
         case MessageKind_CameraFixedParams:
         case MessageKind_Blob:
         {
-            return receiveSimpleMessage(message);
+            return receiveSimpleMessage(&message);
         }
 
         default:
@@ -419,6 +705,33 @@ Endpoint::receiveMessage (Message* message)
     }
 }
 
+inline bool
+Endpoint::filterDepthCameraImageSpatially (Image& depthImage) const
+{
+    return_true_if(depthImage.isCompressedOrEmpty() || 0 == currentSessionSettings.depthBilateralFilterRadius);
+
+    return filter_depth_bilateral(
+        depthImage,
+        currentSessionSettings.depthBilateralFilterRadius,
+        currentSessionSettings.depthBilateralFilterSigma
+    );
+}
+
+inline bool
+Endpoint::filterDepthCameraImageTemporally (Image& depthImage)
+{
+    return_true_if(depthImage.isCompressedOrEmpty() || DepthTemporalFilterMode_None == currentSessionSettings.depthTemporalFilterMode);
+
+    return depthTemporalFilter.filter(
+        depthImage,
+        currentSessionSettings.depthTemporalFilterMode,
+        currentSessionSettings.depthTemporalFilterLength,
+        currentSessionSettings.depthTemporalFilterWeight
+    );
+}
+
+//------------------------------------------------------------------------------
+
 template < typename Message >
 inline void
 Endpoint::setChannelSettings (const ChannelSettings& channelSettings, Queue<Message>& queue)
@@ -5,9 +5,12 @@
 # pragma once
 
 #include "./core/bitstream.h"
+#include "./core/color-coding.h"
+#include "./core/shift-coding.h"
 #include "./image.h"
 #include "./core/memory.h"
 #include "./core/shift2depth.h"
+#include "./shift-depth-converter.h"
 #include <functional>
 
 namespace uplink {
@@ -32,7 +35,24 @@ namespace uplink {
 // 01101 - Next value is last value + 2.
 // 01100 - Next value is last value - 2.
 
-inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_length_bytes, int numelements, uint16* output)
+// Decoded shifts are passed through a mapping before being stored, so that conversions cost no extra pass.
+
+struct IdentityShiftMap
+{
+    uint16 operator () (uint16 shift) const { return shift; }
+};
+
+struct DepthShiftMap
+{
+    DepthShiftMap (const ShiftToDepthTable& table) : table(table) {}
+
+    uint16 operator () (uint16 shift) const { return table[shift]; }
+
+    const ShiftToDepthTable& table;
+};
+
+template < typename ShiftMap >
+inline uint16 * decode_mapped (const uint8 * bitstream_data, unsigned int bitstream_length_bytes, int numelements, uint16* output, const ShiftMap& map)
 {
 
     uint16_t lastVal = 0;
@@ -58,7 +78,7 @@ inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_len
         {
             curVal = lastVal;
 
-            *(depth_ptr++) = curVal; lastVal = curVal;
+            *(depth_ptr++) = map(curVal); lastVal = curVal;
 
             numelements-=1;
         }
@@ -72,7 +92,7 @@ inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_len
                 curVal = lastVal + 1;
             }
 
-            *(depth_ptr++) = curVal; lastVal = curVal;
+            *(depth_ptr++) = map(curVal); lastVal = curVal;
 
             numelements-=1;
 
@@ -87,8 +107,10 @@ inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_len
 
                 numZeros += 5; // We never encode less than 5.
 
+                const uint16_t mappedVal = map(curVal);
+
                 for(int i = 0; i < numZeros; i++) {
-                    *(depth_ptr++) = curVal;
+                    *(depth_ptr++) = mappedVal;
                 }
 
                 numelements-=numZeros;
@@ -108,7 +130,7 @@ inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_len
                         curVal = lastVal + 2;
                     }
 
-                    *(depth_ptr++) = curVal; lastVal = curVal;
+                    *(depth_ptr++) = map(curVal); lastVal = curVal;
 
                     numelements-=1;
 
@@ -119,7 +141,7 @@ inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_len
 
                     curVal = value;
 
-                    *(depth_ptr++) = curVal; lastVal = curVal;
+                    *(depth_ptr++) = map(curVal); lastVal = curVal;
                     numelements-=1;
                 }
 
@@ -133,6 +155,11 @@ inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_len
 
 }
 
+inline uint16 * decode (const uint8 * bitstream_data, unsigned int bitstream_length_bytes, int numelements, uint16* output)
+{
+    return decode_mapped(bitstream_data, bitstream_length_bytes, numelements, output, IdentityShiftMap());
+}
+
 //------------------------------------------------------------------------------
 
 inline uint32_t encode(const uint16_t * data_in, int numelements,
@@ -322,11 +349,84 @@ decompress_image_CompressedShifts_Shifts (const Image& source, Image& target)
     return true;
 }
 
+inline bool
+decompress_image_CompressedShifts_DepthMillimeters (const Image& source, Image& target, const ShiftToDepthTable& table)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+    assert(ImageFormat_CompressedShifts == source.format);
+ 
+    const uint8* sourceBuffer = (uint8*) source.planes[0].buffer;
+    const size_t sourceSizeInBytes = source.planes[0].sizeInBytes;
+    const size_t numTargetElements = source.width * source.height;
+
+    // Depth values are looked up as shifts are decoded.
+    uint16_t* targetBuffer = decode_mapped(sourceBuffer, unsigned(sourceSizeInBytes), int(numTargetElements), 0, DepthShiftMap(table));
+
+    if (0 == targetBuffer)
+        return false;
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = ImageFormat_DepthMillimeters;
+    target.planes[0].buffer      = targetBuffer;
+    target.planes[0].sizeInBytes = numTargetElements * 2;
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { free(targetBuffer); };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// Lossless color images, coded as independent strips of rows that are encoded and decoded in parallel.
+// RGB, YCbCr and gray images are accepted, and their format is restored upon decompression.
+
+bool   compress_image_Color_LosslessColor (const Image& source, Image& target);
+bool decompress_image_LosslessColor_Color (const Image& source, Image& target);
+
+bool        lossless_color_can_compress        (ImageFormat format);
+ImageFormat lossless_color_decompressed_format (const Image& image); // As recorded in the compressed stream, or ImageFormat_Invalid.
+
+//------------------------------------------------------------------------------
+
+// Near-lossless shifts, reconstructed within a maximum error that is stored along the compressed bitstream.
+
+bool   compress_image_Shifts_NearLosslessShifts (const Image& source, Image& target, int maxError);
+bool decompress_image_NearLosslessShifts_Shifts (const Image& source, Image& target);
+
+//------------------------------------------------------------------------------
+
+// Lossless shifts, with OCC-style modelling and rANS entropy coding.
+
+bool   compress_image_Shifts_RANSShifts (const Image& source, Image& target);
+bool decompress_image_RANSShifts_Shifts (const Image& source, Image& target);
+
+//------------------------------------------------------------------------------
+
+// Converts shift images to depth images, in place.
+
+bool convert_image_Shifts_DepthMillimeters (Image& image, const ShiftToDepthTable& table);
+
+//------------------------------------------------------------------------------
+
 struct ImageCodec
 {
     std::function<bool (const Image&, Image&)> compress;
     std::function<bool (const Image&, Image&)> decompress;
 
+    // Optional, for shift codecs producing depth images directly. See decompress_image_to_depth.
+    std::function<bool (const Image&, Image&, const ShiftToDepthTable&)> decompressToDepth;
+
+    // Optional, for codecs taking several input formats, in place of compressInputFormat.
+    std::function<bool (ImageFormat)> canCompressFormat;
+
+    // Optional, for codecs restoring the format of the compressed image, in place of decompressOutputFormat.
+    std::function<ImageFormat (const Image&)> decompressedFormat;
+
     ImageFormat compressInputFormat;
     ImageFormat compressOutputFormat;
 
@@ -341,9 +441,18 @@ struct ImageCodec
             uplink::toString(imageFormat).c_str()
         );
 
+        if (canCompressFormat)
+            return compress && canCompressFormat(imageFormat);
+
         return compress && compressInputFormat == imageFormat;
     }
 
+    // Format of the decompressed image.
+    ImageFormat decompressOutputFormatOf (const Image& compressedImage) const
+    {
+        return decompressedFormat ? decompressedFormat(compressedImage) : decompressOutputFormat;
+    }
+
     bool canDecompress (ImageFormat imageFormat) const
     {
         uplink_log_debug("ImageCodec::canDecompress: decompress: %d decompressInputFormat: %s imageFormat: %s",
@@ -359,6 +468,7 @@ struct ImageCodec
 struct ImageCodecs
 {
     ImageCodecs ()
+    : maxShiftError(0)
     {
         compressedShifts.compress               =   compress_image_Shifts_CompressedShifts;
         compressedShifts.decompress             = decompress_image_CompressedShifts_Shifts;
@@ -366,6 +476,30 @@ struct ImageCodecs
         compressedShifts.compressOutputFormat   = ImageFormat_CompressedShifts;
         compressedShifts.decompressInputFormat  = ImageFormat_CompressedShifts;
         compressedShifts.decompressOutputFormat = ImageFormat_Shifts;
+        compressedShifts.decompressToDepth      = decompress_image_CompressedShifts_DepthMillimeters;
+
+        losslessColor.compress               =   compress_image_Color_LosslessColor;
+        losslessColor.decompress             = decompress_image_LosslessColor_Color;
+        losslessColor.canCompressFormat      = lossless_color_can_compress;        // RGB, YCbCr and gray.
+        losslessColor.decompressedFormat     = lossless_color_decompressed_format; // That of the compressed image.
+        losslessColor.compressInputFormat    = ImageFormat_Invalid;
+        losslessColor.compressOutputFormat   = ImageFormat_LosslessColor;
+        losslessColor.decompressInputFormat  = ImageFormat_LosslessColor;
+        losslessColor.decompressOutputFormat = ImageFormat_Invalid;
+
+        nearLosslessShifts.compress               = [this] (const Image& source, Image& target) { return compress_image_Shifts_NearLosslessShifts(source, target, maxShiftError); };
+        nearLosslessShifts.decompress             = decompress_image_NearLosslessShifts_Shifts;
+        nearLosslessShifts.compressInputFormat    = ImageFormat_Shifts;
+        nearLosslessShifts.compressOutputFormat   = ImageFormat_NearLosslessShifts;
+        nearLosslessShifts.decompressInputFormat  = ImageFormat_NearLosslessShifts;
+        nearLosslessShifts.decompressOutputFormat = ImageFormat_Shifts;
+
+        ransShifts.compress               =   compress_image_Shifts_RANSShifts;
+        ransShifts.decompress             = decompress_image_RANSShifts_Shifts;
+        ransShifts.compressInputFormat    = ImageFormat_Shifts;
+        ransShifts.compressOutputFormat   = ImageFormat_RANSShifts;
+        ransShifts.decompressInputFormat  = ImageFormat_RANSShifts;
+        ransShifts.decompressOutputFormat = ImageFormat_Shifts;
 
         h264.compressOutputFormat  = ImageFormat_H264;
         h264.decompressInputFormat = ImageFormat_H264;
@@ -381,6 +515,12 @@ struct ImageCodecs
     ImageCodec&  compressedShifts = byId[ImageCodecId_CompressedShifts];
     ImageCodec&  jpeg             = byId[ImageCodecId_JPEG];
     ImageCodec&  h264             = byId[ImageCodecId_H264];
+    ImageCodec&  losslessColor      = byId[ImageCodecId_LosslessColor];
+    ImageCodec&  nearLosslessShifts = byId[ImageCodecId_NearLosslessShifts];
+    ImageCodec&  ransShifts         = byId[ImageCodecId_RANSShifts];
+
+    // Maximum shift reconstruction error of the near-lossless shifts compression, set up with the session.
+    int maxShiftError;
 
     bool canCompress (ImageFormat imageFormat) const
     {
@@ -399,6 +539,72 @@ struct ImageCodecs
 
         return false;
     }
+
+    // Whether images come out of the codec as they went in. ImageCodecId_Invalid stands for uncompressed images.
+    bool isLossless (ImageCodecId codec) const
+    {
+        switch (codec)
+        {
+            case ImageCodecId_JPEG:
+            case ImageCodecId_H264:
+                return false;
+
+            case ImageCodecId_NearLosslessShifts:
+                return 0 == maxShiftError;
+
+            default:
+                return true;
+        }
+    }
+
+    // Returns the codec decompressing images of the given format, or ImageCodecId_Invalid.
+    ImageCodecId decompressorOf (ImageFormat imageFormat) const
+    {
+        for (int n = 0; n < ImageCodecId_HowMany; ++n)
+            if (byId[n].canDecompress(imageFormat))
+                return ImageCodecId_Enum(n);
+
+        return ImageCodecId_Invalid;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Decompresses shift images into depth images, fusing the conversion into decompression when the codec supports it.
+
+bool decompress_image_to_depth (const ImageCodec& codec, const Image& source, Image& target, const ShiftToDepthTable& table);
+
+//------------------------------------------------------------------------------
+
+// Per-image codec selection among the codecs advertised by the receiving endpoint.
+// Candidates are periodically ranked by trial-compressing a band of rows from the middle of the image,
+// and the outcome is reused for the following images, since scene content changes slowly.
+// Only the candidates as lossless as the preferred codec compete, so that selection never changes image fidelity.
+// Multi-planar images, such as YCbCr ones, cannot be sampled as a band of rows, and are not ranked:
+// the preferred codec is kept for them, when it is a candidate.
+
+class ImageCodecSelector
+{
+public:
+    ImageCodecSelector ();
+
+public:
+    // Returns the codec to compress the image with, or ImageCodecId_Invalid to send it uncompressed.
+    // With no candidate codecs, the preferred codec is always returned.
+    ImageCodecId select (const ImageCodecs& codecs, ImageCodecId preferredCodec, uint32 candidateCodecs, const Image& image);
+
+    void reset ();
+
+public:
+    int    evaluationPeriod;   // In images.
+    int    sampleDivisor;      // The sampled band spans 1 / sampleDivisor of the image rows.
+    double switchingThreshold; // Minimum relative size gain required to switch codecs.
+
+private:
+    ImageCodecId selectedCodec;
+    uint32       selectedCandidates;
+    ImageFormat  selectedFormat;
+    int          numImagesUntilEvaluation;
 };
 
 //------------------------------------------------------------------------------
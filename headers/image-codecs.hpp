@@ -5,11 +5,738 @@
 # pragma once
 
 # include "./image-codecs.h"
+# include "./context.h"
+# include <cstring>
+# include <vector>
 
 namespace uplink {
 
 //------------------------------------------------------------------------------
 
+// Lossless color stream layout, all integers being little-endian:
+//
+//     uint8  version
+//     uint8  image format
+//     uint8  number of planes
+//     uint8  strip height
+//     for each plane:
+//         uint16 width
+//         uint16 height
+//         uint8  number of channels
+//     for each strip of each plane:
+//         uint32 strip size in bytes
+//     for each strip of each plane:
+//         strip bytes
+
+enum
+{
+    LosslessColorVersion     = 1,
+    LosslessColorStripHeight = 32,
+    LosslessColorHeaderSize  = 4,
+    LosslessColorPlaneSize   = 5,
+};
+
+struct LosslessColorPlane
+{
+    size_t width;
+    size_t height;
+    int    numChannels;
+
+    size_t numStrips   () const { return (height + LosslessColorStripHeight - 1) / LosslessColorStripHeight; }
+    size_t bytesPerRow () const { return width * numChannels; }
+};
+
+struct LosslessColorStrip
+{
+    int    plane;
+    size_t firstRow;
+    size_t numRows;
+    size_t offset;
+    size_t size;
+};
+
+inline int
+lossless_color_planes (ImageFormat format, size_t width, size_t height, LosslessColorPlane planes [Image::MaxNumPlanes])
+{
+    switch (format)
+    {
+        case ImageFormat_RGB:
+        {
+            planes[0].width = width; planes[0].height = height; planes[0].numChannels = 3;
+
+            return 1;
+        }
+
+        case ImageFormat_Gray:
+        {
+            planes[0].width = width; planes[0].height = height; planes[0].numChannels = 1;
+
+            return 1;
+        }
+
+        case ImageFormat_YCbCr: // Bi-planar 4:2:0, with interleaved chroma.
+        {
+            planes[0].width = width; planes[0].height = height; planes[0].numChannels = 1;
+
+            planes[1].width = (width + 1) / 2; planes[1].height = (height + 1) / 2; planes[1].numChannels = 2;
+
+            return 2;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+inline void
+lossless_color_split (const LosslessColorPlane* planes, int numPlanes, std::vector<LosslessColorStrip>& strips)
+{
+    strips.clear();
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        for (size_t row = 0; row < planes[p].height; row += LosslessColorStripHeight)
+        {
+            LosslessColorStrip strip;
+            strip.plane    = p;
+            strip.firstRow = row;
+            strip.numRows  = std::min(size_t(LosslessColorStripHeight), planes[p].height - row);
+            strip.offset   = 0;
+            strip.size     = 0;
+
+            strips.push_back(strip);
+        }
+    }
+}
+
+inline void lossless_color_put16 (uint8*& bytes, size_t value) { bytes[0] = uint8(value); bytes[1] = uint8(value >> 8); bytes += 2; }
+inline void lossless_color_put32 (uint8*& bytes, size_t value) { lossless_color_put16(bytes, value & 0xffff); lossless_color_put16(bytes, value >> 16); }
+
+inline size_t lossless_color_get16 (const uint8*& bytes) { const size_t value = bytes[0] | (size_t(bytes[1]) << 8); bytes += 2; return value; }
+inline size_t lossless_color_get32 (const uint8*& bytes) { const size_t low = lossless_color_get16(bytes); return low | (lossless_color_get16(bytes) << 16); }
+
+//------------------------------------------------------------------------------
+
+inline bool
+compress_image_Color_LosslessColor (const Image& source, Image& target)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+
+    LosslessColorPlane planes [Image::MaxNumPlanes];
+
+    const int numPlanes = lossless_color_planes(source.format, source.width, source.height, planes);
+
+    report_false_unless("Unsupported lossless color image format.", 0 < numPlanes);
+
+    const uint8* sourceRows        [Image::MaxNumPlanes];
+    size_t       sourceBytesPerRow [Image::MaxNumPlanes];
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        const Image::Plane& plane = source.planes[p];
+
+        sourceRows[p]        = (const uint8*) plane.buffer;
+        sourceBytesPerRow[p] = 0 != plane.bytesPerRow ? plane.bytesPerRow : planes[p].bytesPerRow();
+
+        report_false_unless("Invalid lossless color image plane.",
+               0 != sourceRows[p]
+            && planes[p].bytesPerRow() <= sourceBytesPerRow[p]
+            && (planes[p].height - 1) * sourceBytesPerRow[p] + planes[p].bytesPerRow() <= plane.sizeInBytes
+        );
+    }
+
+    std::vector<LosslessColorStrip> strips;
+    lossless_color_split(planes, numPlanes, strips);
+
+    const size_t headerSize = LosslessColorHeaderSize + numPlanes * LosslessColorPlaneSize + strips.size() * 4;
+
+    // Strips are first encoded in worst-case sized slots, and compacted afterwards.
+    size_t maxEncodedSize = 0;
+    for (size_t n = 0; n < strips.size(); ++n)
+    {
+        LosslessColorStrip& strip = strips[n];
+
+        strip.offset = headerSize + maxEncodedSize;
+
+        maxEncodedSize += color_strip_max_encoded_size(planes[strip.plane].width, strip.numRows, planes[strip.plane].numChannels);
+    }
+
+    uint8* targetBuffer = new uint8[headerSize + maxEncodedSize];
+
+    context.tasks().parallelFor(int(strips.size()), [&] (int n)
+    {
+        LosslessColorStrip& strip = strips[n];
+
+        const LosslessColorPlane& plane = planes[strip.plane];
+
+        strip.size = color_strip_encode(
+            sourceRows[strip.plane] + strip.firstRow * sourceBytesPerRow[strip.plane],
+            sourceBytesPerRow[strip.plane],
+            plane.width,
+            strip.numRows,
+            plane.numChannels,
+            targetBuffer + strip.offset
+        );
+    });
+
+    uint8* header = targetBuffer;
+
+    *header++ = uint8(LosslessColorVersion);
+    *header++ = uint8(source.format);
+    *header++ = uint8(numPlanes);
+    *header++ = uint8(LosslessColorStripHeight);
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        lossless_color_put16(header, planes[p].width);
+        lossless_color_put16(header, planes[p].height);
+        *header++ = uint8(planes[p].numChannels);
+    }
+
+    size_t compressedSize = headerSize;
+
+    for (size_t n = 0; n < strips.size(); ++n)
+    {
+        const LosslessColorStrip& strip = strips[n];
+
+        lossless_color_put32(header, strip.size);
+
+        std::memmove(targetBuffer + compressedSize, targetBuffer + strip.offset, strip.size);
+
+        compressedSize += strip.size;
+    }
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = ImageFormat_LosslessColor;
+    target.planes[0].buffer      = targetBuffer;
+    target.planes[0].sizeInBytes = compressedSize;
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+inline bool
+decompress_image_LosslessColor_Color (const Image& source, Image& target)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+    assert(ImageFormat_LosslessColor == source.format);
+
+    const uint8*       input = (const uint8*) source.planes[0].buffer;
+    const uint8* const end   = input + source.planes[0].sizeInBytes;
+
+    report_false_unless("Truncated lossless color image.", 0 != input && LosslessColorHeaderSize <= end - input);
+
+    const int         version     = input[0];
+    const ImageFormat format      = ImageFormat_Enum(input[1]);
+    const int         numPlanes   = input[2];
+    const size_t      stripHeight = input[3];
+    input += LosslessColorHeaderSize;
+
+    report_false_unless("Unsupported lossless color image version.", LosslessColorVersion == version);
+
+    LosslessColorPlane planes [Image::MaxNumPlanes];
+
+    report_false_unless("Invalid lossless color image format.",
+           LosslessColorStripHeight == stripHeight
+        && numPlanes == lossless_color_planes(format, source.width, source.height, planes)
+        && ptrdiff_t(numPlanes * LosslessColorPlaneSize) <= end - input
+    );
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        const size_t width       = lossless_color_get16(input);
+        const size_t height      = lossless_color_get16(input);
+        const int    numChannels = *input++;
+
+        report_false_unless("Invalid lossless color image plane.",
+               width       == planes[p].width
+            && height      == planes[p].height
+            && numChannels == planes[p].numChannels
+        );
+    }
+
+    std::vector<LosslessColorStrip> strips;
+    lossless_color_split(planes, numPlanes, strips);
+
+    report_false_unless("Truncated lossless color image.", ptrdiff_t(strips.size() * 4) <= end - input);
+
+    size_t offset = (input - (const uint8*) source.planes[0].buffer) + strips.size() * 4;
+
+    for (size_t n = 0; n < strips.size(); ++n)
+    {
+        strips[n].offset = offset;
+        strips[n].size   = lossless_color_get32(input);
+
+        offset += strips[n].size;
+    }
+
+    report_false_unless("Truncated lossless color image.", offset <= source.planes[0].sizeInBytes);
+
+    size_t planeOffsets [Image::MaxNumPlanes];
+    size_t targetSize = 0;
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        planeOffsets[p] = targetSize;
+
+        targetSize += planes[p].bytesPerRow() * planes[p].height;
+    }
+
+    uint8* targetBuffer = new uint8[targetSize];
+
+    std::vector<char> decoded(strips.size(), 0);
+
+    context.tasks().parallelFor(int(strips.size()), [&] (int n)
+    {
+        const LosslessColorStrip& strip = strips[n];
+
+        const LosslessColorPlane& plane = planes[strip.plane];
+
+        decoded[n] = color_strip_decode(
+            (const uint8*) source.planes[0].buffer + strip.offset,
+            strip.size,
+            targetBuffer + planeOffsets[strip.plane] + strip.firstRow * plane.bytesPerRow(),
+            plane.bytesPerRow(),
+            plane.width,
+            strip.numRows,
+            plane.numChannels
+        );
+    });
+
+    if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end())
+    {
+        delete [] targetBuffer;
+
+        uplink_log_error("Could not decompress lossless color image.");
+
+        return false;
+    }
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = format;
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        target.planes[p].buffer      = targetBuffer + planeOffsets[p];
+        target.planes[p].bytesPerRow = planes[p].bytesPerRow();
+        target.planes[p].sizeInBytes = planes[p].bytesPerRow() * planes[p].height;
+    }
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+inline bool
+lossless_color_can_compress (ImageFormat format)
+{
+    LosslessColorPlane planes [Image::MaxNumPlanes];
+
+    return 0 < lossless_color_planes(format, 1, 1, planes);
+}
+
+inline ImageFormat
+lossless_color_decompressed_format (const Image& image)
+{
+    const uint8* const input = (const uint8*) image.planes[0].buffer;
+
+    if (ImageFormat_LosslessColor != image.format || 0 == input || image.planes[0].sizeInBytes < LosslessColorHeaderSize)
+        return ImageFormat_Invalid;
+
+    const ImageFormat format = ImageFormat_Enum(input[1]);
+
+    return lossless_color_can_compress(format) ? format : ImageFormat(ImageFormat_Invalid);
+}
+
+//------------------------------------------------------------------------------
+
+inline bool
+compress_image_Shifts_NearLosslessShifts (const Image& source, Image& target, int maxError)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+    assert(ImageFormat_Shifts == source.format);
+
+    maxError = std::max(0, std::min(maxError, 0xff));
+
+    const uint16* sourceBuffer      = (const uint16*) source.planes[0].buffer;
+    const size_t  sourceSizeInBytes = source.planes[0].sizeInBytes;
+
+    // The bitstream never exceeds the uncompressed size, plus one flushed byte.
+    const size_t targetCapacity = 1 + sourceSizeInBytes + 1;
+
+    uint8* targetBuffer = new uint8[targetCapacity];
+
+    targetBuffer[0] = uint8(maxError);
+
+    const size_t compressedSize = 1 + encode_near_lossless(
+        sourceBuffer,
+        int(sourceSizeInBytes / 2),
+        targetBuffer + 1,
+        uint32(targetCapacity - 1),
+        maxError
+    );
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = ImageFormat_NearLosslessShifts;
+    target.planes[0].buffer      = targetBuffer;
+    target.planes[0].sizeInBytes = compressedSize;
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+inline bool
+decompress_image_NearLosslessShifts_Shifts (const Image& source, Image& target)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+    assert(ImageFormat_NearLosslessShifts == source.format);
+
+    const uint8* sourceBuffer      = (const uint8*) source.planes[0].buffer;
+    const size_t sourceSizeInBytes = source.planes[0].sizeInBytes;
+    const size_t numTargetElements = source.width * source.height;
+
+    report_false_unless("Truncated near-lossless shifts image.", 0 != sourceBuffer && 1 < sourceSizeInBytes);
+
+    const int maxError = sourceBuffer[0];
+
+    uint16* targetBuffer = new uint16[numTargetElements];
+
+    if (!decode_near_lossless(sourceBuffer + 1, uint32(sourceSizeInBytes - 1), int(numTargetElements), targetBuffer, maxError))
+    {
+        delete [] targetBuffer;
+
+        uplink_log_error("Could not decompress near-lossless shifts image.");
+
+        return false;
+    }
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = ImageFormat_Shifts;
+    target.planes[0].buffer      = targetBuffer;
+    target.planes[0].sizeInBytes = numTargetElements * 2;
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool
+compress_image_Shifts_RANSShifts (const Image& source, Image& target)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+    assert(ImageFormat_Shifts == source.format);
+
+    const uint16* sourceBuffer      = (const uint16*) source.planes[0].buffer;
+    const int     numSourceElements = int(source.planes[0].sizeInBytes / 2);
+
+    const size_t targetCapacity = rans_max_encoded_size(numSourceElements);
+
+    uint8* targetBuffer = new uint8[targetCapacity];
+
+    const size_t compressedSize = encode_rans(sourceBuffer, numSourceElements, targetBuffer, uint32(targetCapacity));
+
+    if (0 == compressedSize)
+    {
+        delete [] targetBuffer;
+
+        uplink_log_error("rANS compression failed.");
+
+        return false;
+    }
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = ImageFormat_RANSShifts;
+    target.planes[0].buffer      = targetBuffer;
+    target.planes[0].sizeInBytes = compressedSize;
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+inline bool
+decompress_image_RANSShifts_Shifts (const Image& source, Image& target)
+{
+    assert(target.isEmpty());
+    assert(!source.isEmpty());
+    assert(ImageFormat_RANSShifts == source.format);
+
+    const uint8* sourceBuffer      = (const uint8*) source.planes[0].buffer;
+    const size_t sourceSizeInBytes = source.planes[0].sizeInBytes;
+    const size_t numTargetElements = source.width * source.height;
+
+    uint16* targetBuffer = new uint16[numTargetElements];
+
+    if (!decode_rans(sourceBuffer, uint32(sourceSizeInBytes), int(numTargetElements), targetBuffer))
+    {
+        delete [] targetBuffer;
+
+        uplink_log_error("Could not decompress rANS shifts image.");
+
+        return false;
+    }
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = ImageFormat_Shifts;
+    target.planes[0].buffer      = targetBuffer;
+    target.planes[0].sizeInBytes = numTargetElements * 2;
+
+    target.cameraInfo = source.cameraInfo;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool
+convert_image_Shifts_DepthMillimeters (Image& image, const ShiftToDepthTable& table)
+{
+    report_false_unless("Cannot convert non-shift images to depth.", ImageFormat_Shifts == image.format);
+
+    const size_t numElements = image.width * image.height;
+
+    report_false_unless("Invalid shift image.", 0 != image.planes[0].buffer && numElements * 2 <= image.planes[0].sizeInBytes);
+
+    uint16* buffer = (uint16*) image.planes[0].buffer;
+
+    table.convert(buffer, buffer, numElements);
+
+    image.format = ImageFormat_DepthMillimeters;
+
+    return true;
+}
+
+inline bool
+decompress_image_to_depth (const ImageCodec& codec, const Image& source, Image& target, const ShiftToDepthTable& table)
+{
+    if (codec.decompressToDepth)
+        return codec.decompressToDepth(source, target, table);
+
+    return_false_unless(codec.decompress(source, target));
+
+    return convert_image_Shifts_DepthMillimeters(target, table);
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+inline size_t
+image_codec_selector_bytes_per_pixel (ImageFormat format)
+{
+    switch (format)
+    {
+        case ImageFormat_Shifts: return 2;
+        case ImageFormat_RGB:    return 3;
+        case ImageFormat_Gray:   return 1;
+        default:                 return 0; // Multi-planar or compressed.
+    }
+}
+
+// Uncompressed images are serialized as their first plane, which must then hold tightly packed rows.
+inline bool
+image_codec_selector_is_packed (const Image& image)
+{
+    const size_t bytesPerPixel = image_codec_selector_bytes_per_pixel(image.format);
+
+    return_false_if(0 == bytesPerPixel);
+
+    const size_t bytesPerRow = image.width * bytesPerPixel;
+
+    return (0 == image.planes[0].bytesPerRow || bytesPerRow == image.planes[0].bytesPerRow)
+        && bytesPerRow * image.height == image.planes[0].sizeInBytes
+        ;
+}
+
+// Makes a non-owning view over a band of rows, from the middle of a single-plane image.
+inline bool
+image_codec_selector_sample (const Image& image, int sampleDivisor, Image& sample)
+{
+    const size_t bytesPerPixel = image_codec_selector_bytes_per_pixel(image.format);
+
+    return_false_if(0 == bytesPerPixel || 0 == image.planes[0].buffer);
+
+    const size_t bytesPerRow = 0 != image.planes[0].bytesPerRow ? image.planes[0].bytesPerRow : image.width * bytesPerPixel;
+
+    return_false_unless(image.width * bytesPerPixel == bytesPerRow); // Codecs expect packed rows.
+    return_false_unless(bytesPerRow * image.height <= image.planes[0].sizeInBytes);
+
+    const size_t numRows  = std::max(size_t(1), image.height / size_t(std::max(1, sampleDivisor)));
+    const size_t firstRow = (image.height - numRows) / 2;
+
+    sample.format = image.format;
+    sample.width  = image.width;
+    sample.height = numRows;
+    sample.planes[0].buffer      = (uint8*) image.planes[0].buffer + firstRow * bytesPerRow;
+    sample.planes[0].sizeInBytes = numRows * bytesPerRow;
+    sample.planes[0].bytesPerRow = bytesPerRow;
+    sample.cameraInfo = image.cameraInfo;
+
+    return true;
+}
+
+}
+
+inline
+ImageCodecSelector::ImageCodecSelector ()
+    : evaluationPeriod(30)
+    , sampleDivisor(8)
+    , switchingThreshold(.05)
+{
+    reset();
+}
+
+inline void
+ImageCodecSelector::reset ()
+{
+    selectedCodec            = ImageCodecId_Invalid;
+    selectedCandidates       = 0;
+    selectedFormat           = ImageFormat_Invalid;
+    numImagesUntilEvaluation = 0;
+}
+
+inline ImageCodecId
+ImageCodecSelector::select (const ImageCodecs& codecs, ImageCodecId preferredCodec, uint32 candidateCodecs, const Image& image)
+{
+    if (0 == candidateCodecs)
+        return preferredCodec;
+
+    // Gather the candidates able to handle this image, with the fidelity of the preferred codec.
+    // Smaller lossy images would always win the ranking otherwise. Invalid stands for uncompressed images.
+
+    const bool lossless = codecs.isLossless(preferredCodec);
+
+    ImageCodecId_Enum candidates [ImageCodecId_HowMany + 1];
+    int               numCandidates = 0;
+
+    for (int n = 0; n < ImageCodecId_HowMany; ++n)
+    {
+        const ImageCodecId_Enum codec = ImageCodecId_Enum(n);
+
+        if ((codec == preferredCodec || 0 != (candidateCodecs & imageCodecBit(codec)))
+         && codecs.byId[n].canCompress(image.format)
+         && lossless == codecs.isLossless(codec))
+            candidates[numCandidates++] = codec;
+    }
+
+    if (lossless && 0 != (candidateCodecs & UncompressedImageCodecBit) && image_codec_selector_is_packed(image))
+        candidates[numCandidates++] = ImageCodecId_Invalid;
+
+    if (0 == numCandidates)
+        return preferredCodec; // Let the caller report the failure.
+
+    if (1 == numCandidates)
+        return candidates[0];
+
+    bool selectedIsCandidate = false;
+
+    for (int n = 0; n < numCandidates; ++n)
+        if (candidates[n] == selectedCodec)
+            selectedIsCandidate = true;
+
+    // Reuse the last ranking, unless it is outdated.
+
+    if (selectedIsCandidate
+     && candidateCodecs == selectedCandidates
+     && image.format    == selectedFormat
+     && 0 < numImagesUntilEvaluation--)
+        return selectedCodec;
+
+    numImagesUntilEvaluation = evaluationPeriod;
+    selectedCandidates       = candidateCodecs;
+    selectedFormat           = image.format;
+
+    Image sample;
+
+    if (!image_codec_selector_sample(image, sampleDivisor, sample))
+    {
+        // Multi-planar images are not ranked: stick to the preferred codec, when possible.
+        selectedCodec = candidates[0];
+
+        for (int n = 0; n < numCandidates; ++n)
+            if (candidates[n] == preferredCodec)
+                selectedCodec = preferredCodec;
+
+        return selectedCodec;
+    }
+
+    ImageCodecId_Enum bestCodec    = ImageCodecId_Invalid;
+    size_t            bestSize     = 0;
+    size_t            selectedSize = 0;
+    bool              ranked       = false;
+
+    for (int n = 0; n < numCandidates; ++n)
+    {
+        size_t size = sample.planes[0].sizeInBytes;
+
+        if (ImageCodecId_Invalid != candidates[n])
+        {
+            Image compressed;
+
+            if (!codecs.byId[candidates[n]].compress(sample, compressed))
+                continue;
+
+            size = compressed.planes[0].sizeInBytes;
+        }
+
+        if (candidates[n] == selectedCodec)
+            selectedSize = size;
+
+        if (!ranked || size < bestSize)
+        {
+            bestCodec = candidates[n];
+            bestSize  = size;
+            ranked    = true;
+        }
+    }
+
+    if (!ranked)
+        return preferredCodec;
+
+    // Hysteresis: only switch codecs on significant gains.
+    if (selectedIsCandidate && 0 < selectedSize && double(selectedSize) * (1. - switchingThreshold) <= double(bestSize))
+        return selectedCodec;
+
+    uplink_log_debug("Image codec selected: %d (sample: %d bytes)", int(bestCodec), int(bestSize));
+
+    selectedCodec = bestCodec;
+
+    return selectedCodec;
+}
+
 //------------------------------------------------------------------------------
 
 }
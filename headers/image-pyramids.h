@@ -0,0 +1,60 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./image.h"
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Box-filtered 2x downscaling of ImageFormat_RGB, ImageFormat_YCbCr, ImageFormat_Shifts and ImageFormat_DepthMillimeters images.
+// At this exact ratio, box filtering is also what bilinear sampling gives. Depth averages ignore missing values.
+// Downscaled images own their buffers, and can be shallow-copied.
+
+bool canDownscaleImage (const Image& image);
+
+bool downscale_image_2x (const Image& source, Image& target);
+
+// Repeated 2x downscaling, by a power of two factor.
+bool downscale_image (const Image& source, Image& target, int factor);
+
+//------------------------------------------------------------------------------
+
+// Preview pyramid, generated once per frame. Level zero is the source image itself, which must outlive the pyramid.
+
+class ImagePyramid
+{
+public:
+    enum { MaxNumLevels = 4 };
+
+public:
+    ImagePyramid ();
+
+public:
+    // Each level halves the previous one, down to the given number of levels, or to single pixels.
+    bool build (const Image& source, int numLevels = MaxNumLevels);
+
+    void clear ();
+
+public:
+    int numLevels () const { return count; }
+
+    const Image& level (int n) const;
+
+    // Smallest level still covering the given size, or level zero when none does.
+    const Image& levelCovering (size_t width, size_t height) const;
+
+private:
+    const Image* source;
+    Image        levels [MaxNumLevels]; // Level zero is left empty.
+    int          count;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./image-pyramids.hpp"
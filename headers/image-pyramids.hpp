@@ -0,0 +1,326 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./image-pyramids.h"
+# include <algorithm>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+struct DownscaledPlane
+{
+    size_t sourceWidth;
+    size_t sourceHeight;
+    size_t targetWidth;
+    size_t targetHeight;
+    int    numChannels;
+};
+
+inline int
+downscaled_planes (const Image& source, DownscaledPlane planes [Image::MaxNumPlanes], size_t& bytesPerChannel)
+{
+    const size_t width  = source.width;
+    const size_t height = source.height;
+
+    const size_t targetWidth  = std::max(size_t(1), width  / 2);
+    const size_t targetHeight = std::max(size_t(1), height / 2);
+
+    switch (source.format)
+    {
+        case ImageFormat_RGB:
+        {
+            bytesPerChannel = 1;
+
+            planes[0].sourceWidth = width; planes[0].sourceHeight = height;
+            planes[0].targetWidth = targetWidth; planes[0].targetHeight = targetHeight;
+            planes[0].numChannels = 3;
+
+            return 1;
+        }
+
+        case ImageFormat_YCbCr: // Bi-planar 4:2:0, with interleaved chroma.
+        {
+            bytesPerChannel = 1;
+
+            planes[0].sourceWidth = width; planes[0].sourceHeight = height;
+            planes[0].targetWidth = targetWidth; planes[0].targetHeight = targetHeight;
+            planes[0].numChannels = 1;
+
+            planes[1].sourceWidth = (width + 1) / 2; planes[1].sourceHeight = (height + 1) / 2;
+            planes[1].targetWidth = (targetWidth + 1) / 2; planes[1].targetHeight = (targetHeight + 1) / 2;
+            planes[1].numChannels = 2;
+
+            return 2;
+        }
+
+        case ImageFormat_Shifts:
+        case ImageFormat_DepthMillimeters:
+        {
+            bytesPerChannel = 2;
+
+            planes[0].sourceWidth = width; planes[0].sourceHeight = height;
+            planes[0].targetWidth = targetWidth; planes[0].targetHeight = targetHeight;
+            planes[0].numChannels = 1;
+
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+// Target sizes round down, so that the last row and column of odd sizes are dropped.
+// Reads are clamped to the edges, for the planes whose target sizes round up: single pixel ones, and subsampled chroma.
+
+template < int NumChannels >
+inline void
+downscale_plane_2x (const uint8* source, size_t sourceBytesPerRow, const DownscaledPlane& plane, uint8* target)
+{
+    for (size_t y = 0; y < plane.targetHeight; ++y)
+    {
+        const uint8* top    = source + std::min(2 * y    , plane.sourceHeight - 1) * sourceBytesPerRow;
+        const uint8* bottom = source + std::min(2 * y + 1, plane.sourceHeight - 1) * sourceBytesPerRow;
+
+        uint8* row = target + y * plane.targetWidth * NumChannels;
+
+        for (size_t x = 0; x < plane.targetWidth; ++x)
+        {
+            const size_t left  = 2 * x * NumChannels;
+            const size_t right = std::min(2 * x + 1, plane.sourceWidth - 1) * NumChannels;
+
+            for (int c = 0; c < NumChannels; ++c)
+                row[x * NumChannels + c] = uint8((top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) >> 2);
+        }
+    }
+}
+
+inline void
+downscale_depth_plane_2x (const uint8* source, size_t sourceBytesPerRow, const DownscaledPlane& plane, uint16* target)
+{
+    for (size_t y = 0; y < plane.targetHeight; ++y)
+    {
+        const uint16* top    = (const uint16*) (source + std::min(2 * y    , plane.sourceHeight - 1) * sourceBytesPerRow);
+        const uint16* bottom = (const uint16*) (source + std::min(2 * y + 1, plane.sourceHeight - 1) * sourceBytesPerRow);
+
+        uint16* row = target + y * plane.targetWidth;
+
+        for (size_t x = 0; x < plane.targetWidth; ++x)
+        {
+            const size_t left  = 2 * x;
+            const size_t right = std::min(2 * x + 1, plane.sourceWidth - 1);
+
+            const uint32 samples [4] = { top[left], top[right], bottom[left], bottom[right] };
+
+            uint32 sum   = 0;
+            uint32 count = 0;
+
+            for (int n = 0; n < 4; ++n)
+            {
+                sum   += samples[n];
+                count += 0 != samples[n];
+            }
+
+            row[x] = 0 == count ? uint16(0) : uint16((sum + count / 2) / count);
+        }
+    }
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+inline bool
+canDownscaleImage (const Image& image)
+{
+    DownscaledPlane planes [Image::MaxNumPlanes];
+    size_t          bytesPerChannel;
+
+    return !image.isEmpty() && 0 < downscaled_planes(image, planes, bytesPerChannel);
+}
+
+inline bool
+downscale_image_2x (const Image& source, Image& target)
+{
+    DownscaledPlane planes [Image::MaxNumPlanes];
+    size_t          bytesPerChannel = 0;
+
+    const int numPlanes = source.isEmpty() ? 0 : downscaled_planes(source, planes, bytesPerChannel);
+
+    report_false_unless("Unsupported image downscaling format.", 0 < numPlanes);
+
+    const uint8* sourceRows        [Image::MaxNumPlanes];
+    size_t       sourceBytesPerRow [Image::MaxNumPlanes];
+    size_t       targetOffsets     [Image::MaxNumPlanes];
+    size_t       targetSize = 0;
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        const Image::Plane& plane = source.planes[p];
+
+        const size_t bytesPerRow = planes[p].sourceWidth * planes[p].numChannels * bytesPerChannel;
+
+        sourceRows[p]        = (const uint8*) plane.buffer;
+        sourceBytesPerRow[p] = 0 != plane.bytesPerRow ? plane.bytesPerRow : bytesPerRow;
+
+        report_false_unless("Invalid downscaled image plane.",
+               0 != sourceRows[p]
+            && bytesPerRow <= sourceBytesPerRow[p]
+            && (planes[p].sourceHeight - 1) * sourceBytesPerRow[p] + bytesPerRow <= plane.sizeInBytes
+        );
+
+        targetOffsets[p] = targetSize;
+        targetSize      += planes[p].targetWidth * planes[p].targetHeight * planes[p].numChannels * bytesPerChannel;
+    }
+
+    // One allocation for all the planes, freed along with the last image referring to it.
+    const uplink_ref<uint8> buffer(new uint8[targetSize], [] (uint8* buffer) { delete [] buffer; });
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        uint8* targetPlane = buffer.get() + targetOffsets[p];
+
+        if (2 == bytesPerChannel)
+        {
+            downscale_depth_plane_2x(sourceRows[p], sourceBytesPerRow[p], planes[p], (uint16*) targetPlane);
+
+            continue;
+        }
+
+        switch (planes[p].numChannels)
+        {
+            case 1: downscale_plane_2x<1>(sourceRows[p], sourceBytesPerRow[p], planes[p], targetPlane); break;
+            case 2: downscale_plane_2x<2>(sourceRows[p], sourceBytesPerRow[p], planes[p], targetPlane); break;
+            case 3: downscale_plane_2x<3>(sourceRows[p], sourceBytesPerRow[p], planes[p], targetPlane); break;
+        }
+    }
+
+    target.clear();
+
+    target.width  = planes[0].targetWidth;
+    target.height = planes[0].targetHeight;
+    target.format = source.format;
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        target.planes[p].buffer      = buffer.get() + targetOffsets[p];
+        target.planes[p].bytesPerRow = planes[p].targetWidth * planes[p].numChannels * bytesPerChannel;
+        target.planes[p].sizeInBytes = planes[p].targetHeight * target.planes[p].bytesPerRow;
+    }
+
+    // Intrinsics follow the pixel centers.
+    target.cameraInfo = source.cameraInfo;
+
+    CameraCalibration& calibration = target.cameraInfo.calibration;
+
+    if (calibration.isValid())
+    {
+        const float scaleX = float(target.width ) / float(source.width );
+        const float scaleY = float(target.height) / float(source.height);
+
+        calibration.fx = calibration.fx * scaleX;
+        calibration.fy = calibration.fy * scaleY;
+        calibration.cx = (calibration.cx + .5f) * scaleX - .5f;
+        calibration.cy = (calibration.cy + .5f) * scaleY - .5f;
+    }
+
+    target.release = [buffer] () {};
+    target.retain  = [buffer] () {};
+
+    return true;
+}
+
+inline bool
+downscale_image (const Image& source, Image& target, int factor)
+{
+    report_false_unless("Image downscaling factors are powers of two.", 1 < factor && 0 == (factor & (factor - 1)));
+
+    return_false_unless(downscale_image_2x(source, target));
+
+    for (factor /= 2; 1 < factor; factor /= 2)
+    {
+        Image downscaled;
+
+        return_false_unless(downscale_image_2x(target, downscaled));
+
+        target.swapWith(downscaled);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline
+ImagePyramid::ImagePyramid ()
+    : source(0)
+    , count(0)
+{
+}
+
+inline void
+ImagePyramid::clear ()
+{
+    for (int n = 1; n < count; ++n)
+        levels[n].clear();
+
+    source = 0;
+    count  = 0;
+}
+
+inline bool
+ImagePyramid::build (const Image& source, int numLevels)
+{
+    clear();
+
+    return_false_unless(canDownscaleImage(source));
+
+    this->source = &source;
+    count = 1;
+
+    numLevels = std::min(numLevels, int(MaxNumLevels));
+
+    for (int n = 1; n < numLevels; ++n)
+    {
+        const Image& previous = level(n - 1);
+
+        if (previous.width < 2 && previous.height < 2)
+            break;
+
+        return_false_unless(downscale_image_2x(previous, levels[n]));
+
+        count = n + 1;
+    }
+
+    return true;
+}
+
+inline const Image&
+ImagePyramid::level (int n) const
+{
+    assert(0 <= n && n < count);
+
+    return 0 == n ? *source : levels[n];
+}
+
+inline const Image&
+ImagePyramid::levelCovering (size_t width, size_t height) const
+{
+    assert(0 < count);
+
+    for (int n = count - 1; 0 < n; --n)
+        if (width <= level(n).width && height <= level(n).height)
+            return level(n);
+
+    return level(0);
+}
+
+//------------------------------------------------------------------------------
+
+}
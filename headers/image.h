@@ -31,6 +31,11 @@ UPLINK_ENUM_BEGIN(ImageFormat)
     ImageFormat_JPEG,
     ImageFormat_H264,
 
+    ImageFormat_LosslessColor,
+    ImageFormat_NearLosslessShifts,
+    ImageFormat_RANSShifts,
+    ImageFormat_DepthMillimeters, // Uncompressed uint16 depth values, with zero meaning no depth.
+
 UPLINK_ENUM_END(ImageFormat)
 
 inline bool
@@ -83,6 +88,9 @@ public:
                ImageFormat_CompressedShifts == format
             || ImageFormat_JPEG             == format
             || ImageFormat_H264             == format
+            || ImageFormat_LosslessColor    == format
+            || ImageFormat_NearLosslessShifts == format
+            || ImageFormat_RANSShifts       == format
             ;
     }
 
@@ -91,6 +99,11 @@ public:
         return isEmpty() || isCompressed();
     }
 
+public:
+    // Compressed images delivered lazily carry their decompressor, and decompress upon first access.
+    // Uncompressed images are returned as is. Not thread-safe.
+    const Image& decompressed () const;
+
 # if __APPLE__
 public:
     Image (CMSampleBufferRef sampleBuffer, const CameraInfo& cameraInfo_, size_t width = 0, size_t height = 0);
@@ -152,6 +165,10 @@ public: // For now.
     std::function<void ()> retain;
     Storage                storage;
     Blobs                  attachments;
+    std::function<bool (const Image&, Image&)> decompressor;
+
+private:
+    mutable uplink_ref<Image> decompressedImage;
 };
 
 //------------------------------------------------------------------------------
@@ -113,6 +113,8 @@ Image::Image (const Image& copy)
 , retain(copy.retain)
 , storage(copy.storage)
 , attachments(copy.attachments)
+, decompressor(copy.decompressor)
+, decompressedImage(copy.decompressedImage)
 {
     // NOTE: Image copies are shallow.
 
@@ -312,6 +314,8 @@ Image::clear ()
     release =  std::function<void ()>();
     retain =  std::function<void ()>();
     storage = Storage();
+    decompressor = std::function<bool (const Image&, Image&)>();
+    decompressedImage.reset();
 
 //        compress = 0;
 //        decompress = 0;
@@ -341,6 +345,32 @@ Image::swapWith (Image& other)
     std::swap(storage    , other.storage );
 
     attachments.swapWith(other.attachments);
+
+    std::swap(decompressor, other.decompressor);
+    uplink_swap(decompressedImage, other.decompressedImage);
+}
+
+inline const Image&
+Image::decompressed () const
+{
+    if (!isCompressed())
+        return *this;
+
+    if (!decompressedImage)
+    {
+        decompressedImage.reset(new Image());
+
+        if (!decompressor || !decompressor(*this, *decompressedImage))
+        {
+            uplink_log_error("Could not decompress image.");
+
+            decompressedImage->clear(); // Failures are cached, too.
+        }
+
+        decompressedImage->sessionId = sessionId;
+    }
+
+    return *decompressedImage;
 }
 
 inline bool
@@ -378,17 +408,33 @@ Image::serializeWith (Serializer& s)
         report_false_unless("cannot read image buffer size", r.read(bufferSize));
         assert(bufferSize < maxBufferSize);
 
+        uplink_ref<void> owner;
+
+        // Images read from mapped recordings view their bytes in place.
+        if (const Byte* const lent = r.lendBytes(bufferSize, owner))
+        {
+            planes[0].buffer      = const_cast<Byte*>(lent);
+            planes[0].sizeInBytes = bufferSize;
+            release = [owner] () {};
+            retain  = [owner] () {};
+
+            return true;
+        }
+
         typedef std::unique_ptr<uint8, void(*)(uint8*)> BufferPtr;
 
         // Make sure we don't leak buffer memory on read failures.
         BufferPtr bufferPtr(new uint8 [bufferSize], [](uint8* buffer){ delete [] buffer; });
 
-        report_false_unless("cannot read image buffer data", r.readBytes(bufferPtr.get(), bufferSize));
+        report_false_unless("cannot read image buffer data", 0 == bufferSize || r.readBytes(bufferPtr.get(), bufferSize));
+
+        // The buffer is owned by the callbacks, so that both swaps and shallow copies are safe.
+        uplink_ref<uint8> buffer(bufferPtr.release(), [](uint8* buffer){ delete [] buffer; });
 
-        planes[0].buffer      = bufferPtr.release();
+        planes[0].buffer      = buffer.get();
         planes[0].sizeInBytes = bufferSize;
-        release = [this] () { delete [] (uint8*)planes[0].buffer; };
-        retain = std::function<void ()>();
+        release = [buffer] () {};
+        retain  = [buffer] () {};
     }
     else
     {
@@ -20,6 +20,10 @@ namespace uplink {
     UPLINK_MESSAGE(SessionSetupReply, sessionSetupReply) \
     UPLINK_MESSAGE(KeepAlive        , keepAlive)
 
+// Later system messages come last, so that the earlier message kinds keep their values on the wire.
+# define UPLINK_LATE_SYSTEM_MESSAGES() \
+    UPLINK_MESSAGE(ClockSync        , clockSync)
+
 # define UPLINK_USER_MESSAGES_EXCEPT_VERSION_INFO_AND_CUSTOM_COMMAND() \
     UPLINK_MESSAGE(GyroscopeEvent    , gyroscopeEvent) \
     UPLINK_MESSAGE(AccelerometerEvent, accelerometerEvent) \
@@ -37,7 +41,8 @@ namespace uplink {
 # define UPLINK_MESSAGES() \
     UPLINK_SYSTEM_MESSAGES() \
     UPLINK_MESSAGE(CustomCommand, customCommand) \
-    UPLINK_USER_MESSAGES_EXCEPT_CUSTOM_COMMAND()
+    UPLINK_USER_MESSAGES_EXCEPT_CUSTOM_COMMAND() \
+    UPLINK_LATE_SYSTEM_MESSAGES()
 
 //------------------------------------------------------------------------------
 
@@ -74,10 +79,30 @@ private:
 
 //------------------------------------------------------------------------------
 
+inline CString
+message_kind_name (MessageKind kind)
+{
+    switch (kind)
+    {
+# define UPLINK_MESSAGE(Name, name) \
+        case MessageKind_##Name: \
+            return #Name;
+            UPLINK_MESSAGES()
+# undef  UPLINK_MESSAGE
+        default:
+            assert(false);
+            return "Unknown";
+    }
+}
+
+//------------------------------------------------------------------------------
+
 struct Message : Serializable
 {
     static const Size MaxSize = 0x4000000; // 64 MB
 
+    Message () : knownSerializedSize(0) {}
+
     virtual ~Message () {}
 
     virtual Message* clone () const = 0;
@@ -86,17 +111,7 @@ struct Message : Serializable
     
     CString name () const
     {
-        switch (kind())
-        {
-# define UPLINK_MESSAGE(Name, name) \
-            case MessageKind_##Name: \
-                return #Name;
-                UPLINK_MESSAGES()
-# undef  UPLINK_MESSAGE
-            default:
-                assert(false);
-                return "Unknown";
-        }
+        return message_kind_name(kind());
     }
     
     virtual String toString () const
@@ -110,8 +125,21 @@ struct Message : Serializable
     void swapWith (Message& other)
     {
         uplink_swap(sessionId, other.sessionId);
+        uplink_swap(knownSerializedSize, other.knownSerializedSize);
+    }
+
+    // Known from the last write or read by a message serializer, or computed once. Statistics rely on it.
+    size_t cachedSerializedSize () const
+    {
+        if (0 == knownSerializedSize)
+            knownSerializedSize = serializedSize();
+
+        return knownSerializedSize;
     }
 
+    // Changing the contents of a message requires forgetting its size.
+    void forgetSerializedSize () const { knownSerializedSize = 0; }
+
 #define UPLINK_MESSAGE_CLASS(Name) \
     virtual Name* clone () const   \
     { \
@@ -127,6 +155,11 @@ struct Message : Serializable
     template < typename Class > const Class& as () const { return *downcast<const Class>(this); }
 
     SessionId sessionId;
+
+private:
+    friend struct MessageSerializer;
+
+    mutable size_t knownSerializedSize; // Zero when unknown.
 };
 
 //------------------------------------------------------------------------------
@@ -160,6 +193,12 @@ public:
     virtual Message* readMessage (InputStream & input );
     virtual bool    writeMessage (OutputStream& output, const Message& message);
 
+public:
+    // The last read message, as framed on the stream: header and payload, with images still compressed.
+    // Valid until the next read.
+    const Byte* lastReadBytes () const { return bufferBytes(incoming.buffer); }
+    Size        lastReadSize  () const { return incoming.buffer.size(); }
+
 private:
     typedef std::vector<Message*> Messages;
 
@@ -110,6 +110,9 @@ MessageSerializer::readMessage (InputStream& input)
     // Set message session id.
     message->sessionId = incoming.header.session;
 
+    // Spare statistics the size computation.
+    message->knownSerializedSize = messageSize;
+
     return message;
 }
 
@@ -137,6 +140,9 @@ MessageSerializer::writeMessage (OutputStream& output, const Message& message)
     // Store packet message length.
     outgoing.header.length = (MessageLength)messageOutput.count;
 
+    // Spare statistics the size computation.
+    message.knownSerializedSize = messageOutput.count;
+
     // Store header at the beginning of the packet.
     Byte* headerBytes = mutableBufferBytes(outgoing.buffer); // FIXME: Remove this.
     outgoing.header.storeChunk(headerBytes);
@@ -26,6 +26,49 @@ struct KeepAlive : Message
 
 //------------------------------------------------------------------------------
 
+// Clock offset exchange. Requests are answered as soon as received, and all times are stamped by the wire threads,
+// with getTime(), as the messages are actually written or read. See: ClockOffsetEstimator.
+
+struct ClockSync : Message
+{
+    UPLINK_MESSAGE_CLASS(ClockSync)
+
+    ClockSync ()
+    : isReply(false)
+    , requestSent(0.)
+    , requestReceived(0.)
+    , replySent(0.)
+    {
+    }
+
+    void swapWith (ClockSync& other)
+    {
+        Message::swapWith(other);
+
+        uplink_swap(isReply        , other.isReply);
+        uplink_swap(requestSent    , other.requestSent);
+        uplink_swap(requestReceived, other.requestReceived);
+        uplink_swap(replySent      , other.replySent);
+    }
+
+    virtual bool serializeWith (Serializer& s)
+    {
+        return_false_unless(s.put(isReply));
+        return_false_unless(s.put(requestSent));
+        return_false_unless(s.put(requestReceived));
+        return_false_unless(s.put(replySent));
+
+        return true;
+    }
+
+    bool   isReply;
+    double requestSent;     // Requester clock.
+    double requestReceived; // Replier clock.
+    double replySent;       // Replier clock.
+};
+
+//------------------------------------------------------------------------------
+
 // FIXME: Move this where it belongs.
 
 UPLINK_ENUM_BEGIN(SessionSetupStatus)
@@ -0,0 +1,123 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./core/platform.h"
+# include "./core/metrics.h"
+# include "./core/threads.h"
+# include <functional>
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Named metrics, exposed in the Prometheus text format. Registration locks, while metric updates do not.
+// Series are told apart by their labels, given as Prometheus label lists: channel="CameraFrame",stage="sending"
+// Registered metrics live as long as the registry, unless their series are removed.
+
+class MetricsRegistry
+{
+public:
+    typedef std::function<void ()> Collector;
+
+public:
+     MetricsRegistry ();
+    ~MetricsRegistry ();
+
+public:
+    // Returns the already registered metric, if any.
+    MetricCounter&   counter   (CString name, CString help, const String& labels = String());
+    MetricGauge&     gauge     (CString name, CString help, const String& labels = String());
+    MetricHistogram& histogram (CString name, CString help, const String& labels = String());
+
+    // Removes all the series with the given label, such as the ones of a closing endpoint.
+    void removeSeries (const String& label);
+
+public:
+    // Collectors run before each exposition, and mirror values kept elsewhere into metrics.
+    int  addCollector    (const Collector& collector);
+    void removeCollector (int identifier);
+
+public:
+    String prometheusText ();
+
+private:
+    enum Type { Counter, Gauge, Histogram };
+
+    struct Series
+    {
+        String                      labels;
+        uplink_ref<MetricCounter>   counter;
+        uplink_ref<MetricGauge>     gauge;
+        uplink_ref<MetricHistogram> histogram;
+    };
+
+    struct Family
+    {
+        String              name;
+        String              help;
+        Type                type;
+        std::vector<Series> series;
+    };
+
+    Series& series (CString name, CString help, Type type, const String& labels);
+
+private:
+    Mutex                                  mutex;
+    Mutex                                  collecting; // Held while collectors run, so that removed ones are done.
+    std::vector<Family>                    families;
+    std::vector<std::pair<int, Collector>> collectors;
+    int                                    nextCollector;
+
+    non_copyable(MetricsRegistry)
+};
+
+String metric_label (CString name, const String& value);
+
+//------------------------------------------------------------------------------
+
+// Tiny HTTP endpoint, serving the registry metrics on GET /metrics, for Prometheus scrapers.
+// Requests are served one at a time, on the server thread.
+
+class MetricsServer : public Thread
+{
+public:
+    enum { DefaultPort = 9464 };
+
+public:
+     MetricsServer (MetricsRegistry& registry);
+    ~MetricsServer ();
+
+public:
+    bool startListening (uint16 port = DefaultPort, CString ipAddress = 0);
+
+    void stopListening ();
+
+private:
+# if _WIN32
+    typedef SOCKET Descriptor;
+# else
+    typedef int    Descriptor;
+# endif
+
+private:
+    virtual void run ();
+
+    void serve (Descriptor connection);
+
+private:
+    MetricsRegistry& registry;
+    Descriptor       listener;
+    bool             listening;
+
+    non_copyable(MetricsServer)
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./metrics.hpp"
@@ -0,0 +1,425 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./metrics.h"
+# include <cstring>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline String
+metric_label (CString name, const String& value)
+{
+    String label = name;
+
+    label += "=\"";
+
+    for (size_t n = 0; n < value.size(); ++n)
+    {
+        switch (value[n])
+        {
+            case '\\': label += "\\\\"; break;
+            case '"' : label += "\\\""; break;
+            case '\n': label += "\\n" ; break;
+            default  : label += value[n];
+        }
+    }
+
+    label += "\"";
+
+    return label;
+}
+
+//------------------------------------------------------------------------------
+
+inline
+MetricsRegistry::MetricsRegistry ()
+    : nextCollector(0)
+{
+    addCollector([this] ()
+    {
+        const SocketMetrics& sockets = socket_metrics();
+
+        counter("uplink_socket_read_bytes_total"   , "Bytes read from TCP connections."                  ).set(sockets.bytesRead   .value());
+        counter("uplink_socket_written_bytes_total", "Bytes written to TCP connections."                 ).set(sockets.bytesWritten.value());
+        counter("uplink_socket_reads_total"        , "Read system calls on TCP connections."             ).set(sockets.reads       .value());
+        counter("uplink_socket_writes_total"       , "Write system calls on TCP connections."            ).set(sockets.writes      .value());
+        counter("uplink_socket_selects_total"      , "Readiness polling system calls on TCP connections.").set(sockets.selects     .value());
+    });
+}
+
+inline
+MetricsRegistry::~MetricsRegistry ()
+{
+}
+
+inline MetricsRegistry::Series&
+MetricsRegistry::series (CString name, CString help, Type type, const String& labels)
+{
+    // Assuming the mutex is already locked.
+
+    Family* family = 0;
+
+    for (size_t n = 0; n < families.size(); ++n)
+        if (families[n].name == name)
+            family = &families[n];
+
+    if (0 == family)
+    {
+        families.push_back(Family());
+
+        family = &families.back();
+
+        family->name = name;
+        family->help = help;
+        family->type = type;
+    }
+
+    assert(type == family->type); // Metric names have a single type.
+
+    for (size_t n = 0; n < family->series.size(); ++n)
+        if (family->series[n].labels == labels)
+            return family->series[n];
+
+    family->series.push_back(Series());
+
+    Series& series = family->series.back();
+
+    series.labels = labels;
+
+    switch (type)
+    {
+        case Counter  : series.counter  .reset(new MetricCounter());   break;
+        case Gauge    : series.gauge    .reset(new MetricGauge());     break;
+        case Histogram: series.histogram.reset(new MetricHistogram()); break;
+    }
+
+    return series;
+}
+
+inline MetricCounter&
+MetricsRegistry::counter (CString name, CString help, const String& labels)
+{
+    const MutexLocker _(mutex);
+
+    return *series(name, help, Counter, labels).counter;
+}
+
+inline MetricGauge&
+MetricsRegistry::gauge (CString name, CString help, const String& labels)
+{
+    const MutexLocker _(mutex);
+
+    return *series(name, help, Gauge, labels).gauge;
+}
+
+inline MetricHistogram&
+MetricsRegistry::histogram (CString name, CString help, const String& labels)
+{
+    const MutexLocker _(mutex);
+
+    return *series(name, help, Histogram, labels).histogram;
+}
+
+inline void
+MetricsRegistry::removeSeries (const String& label)
+{
+    const MutexLocker _(mutex);
+
+    for (size_t f = 0; f < families.size();)
+    {
+        std::vector<Series>& series = families[f].series;
+
+        for (size_t s = 0; s < series.size();)
+        {
+            if (String::npos == series[s].labels.find(label))
+                ++s;
+            else
+                series.erase(series.begin() + s);
+        }
+
+        if (series.empty())
+            families.erase(families.begin() + f);
+        else
+            ++f;
+    }
+}
+
+inline int
+MetricsRegistry::addCollector (const Collector& collector)
+{
+    const MutexLocker _(mutex);
+
+    collectors.push_back(std::make_pair(nextCollector, collector));
+
+    return nextCollector++;
+}
+
+inline void
+MetricsRegistry::removeCollector (int identifier)
+{
+    const MutexLocker collection(collecting);
+
+    const MutexLocker _(mutex);
+
+    for (size_t n = 0; n < collectors.size(); ++n)
+    {
+        if (identifier != collectors[n].first)
+            continue;
+
+        collectors.erase(collectors.begin() + n);
+
+        return;
+    }
+}
+
+inline String
+MetricsRegistry::prometheusText ()
+{
+    {
+        // Collectors register their metrics, hence the copy.
+        const MutexLocker collection(collecting);
+
+        std::vector<std::pair<int, Collector>> collectors;
+
+        {
+            const MutexLocker _(mutex);
+
+            collectors = this->collectors;
+        }
+
+        for (size_t n = 0; n < collectors.size(); ++n)
+            collectors[n].second();
+    }
+
+    const MutexLocker _(mutex);
+
+    String text;
+
+    for (size_t f = 0; f < families.size(); ++f)
+    {
+        const Family& family = families[f];
+
+        static CString const typeNames [] = { "counter", "gauge", "histogram" };
+
+        text += formatted_copy("# HELP %s %s\n", family.name.c_str(), family.help.c_str());
+        text += formatted_copy("# TYPE %s %s\n", family.name.c_str(), typeNames[family.type]);
+
+        for (size_t s = 0; s < family.series.size(); ++s)
+        {
+            const Series& series = family.series[s];
+
+            const String labels = series.labels.empty() ? String() : "{" + series.labels + "}";
+
+            switch (family.type)
+            {
+                case Counter:
+                {
+                    text += formatted_copy("%s%s %llu\n", family.name.c_str(), labels.c_str(), (unsigned long long) series.counter->value());
+
+                    break;
+                }
+
+                case Gauge:
+                {
+                    text += formatted_copy("%s%s %.9g\n", family.name.c_str(), labels.c_str(), series.gauge->value());
+
+                    break;
+                }
+
+                case Histogram:
+                {
+                    const MetricHistogram& histogram = *series.histogram;
+
+                    const String separator = series.labels.empty() ? String() : series.labels + ",";
+
+                    // Cumulative counts, exposed at powers of two only.
+                    uint64 cumulated = histogram.bucket(0);
+                    uint64 count     = 0;
+
+                    text += formatted_copy("%s_bucket{%sle=\"%.9g\"} %llu\n", family.name.c_str(), separator.c_str(), MetricHistogram::upperBound(0), (unsigned long long) cumulated);
+
+                    for (int octave = 0; octave < MetricHistogram::NumOctaves; ++octave)
+                    {
+                        const int first = 1 + octave * MetricHistogram::NumSubBucketsPerOctave;
+                        const int last  = first + MetricHistogram::NumSubBucketsPerOctave - 1;
+
+                        for (int n = first; n <= last; ++n)
+                            cumulated += histogram.bucket(n);
+
+                        text += formatted_copy("%s_bucket{%sle=\"%.9g\"} %llu\n", family.name.c_str(), separator.c_str(), MetricHistogram::upperBound(last), (unsigned long long) cumulated);
+                    }
+
+                    count = cumulated + histogram.bucket(MetricHistogram::NumBuckets - 1);
+
+                    text += formatted_copy("%s_bucket{%sle=\"+Inf\"} %llu\n", family.name.c_str(), separator.c_str(), (unsigned long long) count);
+                    text += formatted_copy("%s_sum%s %.9g\n", family.name.c_str(), labels.c_str(), histogram.sum());
+                    text += formatted_copy("%s_count%s %llu\n", family.name.c_str(), labels.c_str(), (unsigned long long) count);
+
+                    break;
+                }
+            }
+        }
+    }
+
+    return text;
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+# if _WIN32
+inline void metrics_close_socket (SOCKET descriptor) { closesocket(descriptor); }
+# else
+inline void metrics_close_socket (int    descriptor) { close(descriptor); }
+# endif
+
+}
+
+inline
+MetricsServer::MetricsServer (MetricsRegistry& registry)
+    : Thread("uplink::MetricsServer")
+    , registry(registry)
+    , listening(false)
+{
+}
+
+inline
+MetricsServer::~MetricsServer ()
+{
+    stopListening();
+}
+
+inline bool
+MetricsServer::startListening (uint16 port, CString ipAddress)
+{
+    report_false_if("Metrics server already listening.", listening);
+
+    listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+# if _WIN32
+    report_false_if("Cannot create the metrics server socket.", INVALID_SOCKET == listener);
+# else
+    report_false_if("Cannot create the metrics server socket.", -1 == listener);
+# endif
+
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*) &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = 0 != ipAddress ? inet_addr(ipAddress) : htonl(INADDR_ANY);
+    address.sin_port        = htons(port);
+
+    if (0 != ::bind(listener, (sockaddr*) &address, sizeof(address)) || 0 != ::listen(listener, 4))
+    {
+        metrics_close_socket(listener);
+
+        uplink_log_error("Metrics server cannot listen on port %d.", int(port));
+
+        return false;
+    }
+
+    listening = true;
+
+    start();
+
+    uplink_log_info("Metrics server listening on port %d.", int(port));
+
+    return true;
+}
+
+inline void
+MetricsServer::stopListening ()
+{
+    return_if(!listening);
+
+    join();
+
+    metrics_close_socket(listener);
+
+    listening = false;
+}
+
+inline void
+MetricsServer::run ()
+{
+    while (isRunning())
+    {
+        // Polling, so that stopping never waits for a scraper.
+        if (select_single_read(listener, 100) <= 0)
+            continue;
+
+        const Descriptor connection = ::accept(listener, 0, 0);
+
+# if _WIN32
+        if (INVALID_SOCKET == connection)
+# else
+        if (-1 == connection)
+# endif
+            continue;
+
+        serve(connection);
+
+        metrics_close_socket(connection);
+    }
+}
+
+inline void
+MetricsServer::serve (Descriptor connection)
+{
+    static const size_t maxRequestSize = 4096;
+    static const int    timeoutInMilliseconds = 1000;
+
+    String request;
+
+    // Only the request line matters, but reading the whole header spares scrapers a connection reset.
+    while (String::npos == request.find("\r\n\r\n") && request.size() < maxRequestSize)
+    {
+        return_if(select_single_read(connection, timeoutInMilliseconds) <= 0);
+
+        char buffer [512];
+
+        const int count = int(::recv(connection, buffer, sizeof(buffer), 0));
+
+        return_if(count <= 0);
+
+        request.append(buffer, size_t(count));
+    }
+
+    const bool found = 0 == request.compare(0, 13, "GET /metrics ") || 0 == request.compare(0, 13, "GET /metrics?");
+
+    const String body = found ? registry.prometheusText() : String("Not found.\n");
+
+    const String response = formatted_copy(
+        "HTTP/1.0 %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %d\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        found ? "200 OK" : "404 Not Found",
+        found ? "text/plain; version=0.0.4" : "text/plain",
+        int(body.size())
+    ) + body;
+
+    for (size_t sent = 0; sent < response.size();)
+    {
+        return_if(select_single_write(connection, timeoutInMilliseconds) <= 0);
+
+        const int count = int(::send(connection, response.data() + sent, int(response.size() - sent), 0));
+
+        return_if(count <= 0);
+
+        sent += size_t(count);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,105 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./image.h"
+# include "./camera-calibration.h"
+# include "./shift-depth-converter.h"
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Caller-provided structure-of-arrays point buffers, holding one entry per depth pixel, in row-major order.
+
+struct PointCloudBuffers
+{
+    PointCloudBuffers ();
+
+    float* x; // Meters, in the depth camera frame. Pixels without depth give NAN coordinates.
+    float* y;
+    float* z;
+
+    uint8* r; // Optional, sampled from the registered color image.
+    uint8* g;
+    uint8* b;
+};
+
+//------------------------------------------------------------------------------
+
+// Undistorted per-pixel rays of a depth camera, as (x/z, y/z) pairs.
+// Tables are only regenerated when the calibration or the image size change, so updating them with each frame is cheap.
+
+class DepthRayTable
+{
+public:
+    DepthRayTable ();
+
+public:
+    bool update (const CameraCalibration& calibration, size_t width, size_t height);
+
+    bool matches (const CameraCalibration& calibration, size_t width, size_t height) const;
+
+public:
+    bool isValid () const { return !raysX.empty(); }
+
+    size_t getWidth  () const { return width; }
+    size_t getHeight () const { return height; }
+
+    const float* rowX (size_t row) const { return &raysX[row * width]; }
+    const float* rowY (size_t row) const { return &raysY[row * width]; }
+
+private:
+    CameraCalibration  calibration;
+    size_t             width;
+    size_t             height;
+    std::vector<float> raysX;
+    std::vector<float> raysY;
+};
+
+//------------------------------------------------------------------------------
+
+// Depth frame to point cloud conversion, from ImageFormat_Shifts or ImageFormat_DepthMillimeters images.
+// Compressed images must be decompressed first.
+
+class DepthToPointCloud
+{
+public:
+    enum { StripHeight = 32 }; // Rows per parallel conversion task.
+
+public:
+    // Updates the ray and shift tables from the depth image camera info.
+    bool update (const Image& depthImage);
+
+    // Converts rows [firstRow, firstRow + numRows) of an image the converter was updated with.
+    // Disjoint row ranges can be converted concurrently, from any thread pool.
+    bool convertRows (
+        const Image&             depthImage,
+        size_t                   firstRow,
+        size_t                   numRows,
+        const PointCloudBuffers& points,
+        const Image*             colorImage = 0
+    ) const;
+
+    // Whole frames, with color when a registered ImageFormat_RGB image is given.
+    bool convert (const Image& depthImage, const PointCloudBuffers& points, const Image* colorImage = 0);
+
+    // Same, in row strips on the context task pool.
+    bool convertInParallel (const Image& depthImage, const PointCloudBuffers& points, const Image* colorImage = 0);
+
+public:
+    const DepthRayTable& rayTable () const { return rays; }
+
+private:
+    DepthRayTable     rays;
+    ShiftToDepthTable shiftToDepth;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./point-clouds.hpp"
@@ -0,0 +1,263 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./point-clouds.h"
+# include "./image-codecs.h"
+# include "./context.h"
+# include <algorithm>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline
+PointCloudBuffers::PointCloudBuffers ()
+    : x(0)
+    , y(0)
+    , z(0)
+    , r(0)
+    , g(0)
+    , b(0)
+{}
+
+//------------------------------------------------------------------------------
+
+inline
+DepthRayTable::DepthRayTable ()
+    : calibration()
+    , width(0)
+    , height(0)
+{}
+
+inline bool
+DepthRayTable::matches (const CameraCalibration& calibration, size_t width, size_t height) const
+{
+    return isValid()
+        && width  == this->width
+        && height == this->height
+        && calibration == this->calibration
+        ;
+}
+
+inline bool
+DepthRayTable::update (const CameraCalibration& calibration, size_t width, size_t height)
+{
+    if (matches(calibration, width, height))
+        return true;
+
+    raysX.clear();
+    raysY.clear();
+
+    report_false_unless("Invalid depth camera calibration.", calibration.isValid() && 0 < calibration.fy);
+    report_false_unless("Invalid depth image size.", 0 < width * height);
+
+    this->calibration = calibration;
+    this->width       = width;
+    this->height      = height;
+
+    raysX.resize(width * height);
+    raysY.resize(width * height);
+
+    const bool distorted = calibration.hasDistortion();
+
+    for (size_t v = 0; v < height; ++v)
+    for (size_t u = 0; u < width ; ++u)
+    {
+        const float distortedX = (float(u) - calibration.cx) / calibration.fx;
+        const float distortedY = (float(v) - calibration.cy) / calibration.fy;
+
+        float& x = raysX[v * width + u];
+        float& y = raysY[v * width + u];
+
+        if (distorted)
+        {
+            calibration.undistort(distortedX, distortedY, x, y);
+        }
+        else
+        {
+            x = distortedX;
+            y = distortedY;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+template < typename ShiftMap >
+inline void
+depth_to_point_cloud_row (
+    const uint16*   depths,
+    const float*    raysX,
+    const float*    raysY,
+    size_t          width,
+    const ShiftMap& map,
+    float*          x,
+    float*          y,
+    float*          z
+)
+{
+    for (size_t u = 0; u < width; ++u)
+    {
+        const uint16 depth = 0 != depths[u] ? map(depths[u]) : uint16(0);
+
+        z[u] = 0 != depth ? float(depth) * 1e-3f : NAN;
+    }
+
+    // Separate passes over contiguous arrays, so that compilers vectorize them. No-depth NANs propagate.
+    for (size_t u = 0; u < width; ++u)
+        x[u] = raysX[u] * z[u];
+
+    for (size_t u = 0; u < width; ++u)
+        y[u] = raysY[u] * z[u];
+}
+
+inline void
+rgb_to_point_cloud_row (
+    const uint8* rgb,
+    size_t       colorWidth,
+    size_t       width,
+    uint8*       r,
+    uint8*       g,
+    uint8*       b
+)
+{
+    for (size_t u = 0; u < width; ++u)
+    {
+        const uint8* pixel = rgb + 3 * (u * colorWidth / width);
+
+        if (0 != r) r[u] = pixel[0];
+        if (0 != g) g[u] = pixel[1];
+        if (0 != b) b[u] = pixel[2];
+    }
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+inline bool
+DepthToPointCloud::update (const Image& depthImage)
+{
+    report_false_unless("Point clouds require uncompressed depth images.",
+           ImageFormat_Shifts           == depthImage.format
+        || ImageFormat_DepthMillimeters == depthImage.format
+    );
+
+    if (ImageFormat_Shifts == depthImage.format)
+        shiftToDepth.update(depthImage.cameraInfo);
+
+    return rays.update(depthImage.cameraInfo.calibration, depthImage.width, depthImage.height);
+}
+
+inline bool
+DepthToPointCloud::convertRows (
+    const Image&             depthImage,
+    size_t                   firstRow,
+    size_t                   numRows,
+    const PointCloudBuffers& points,
+    const Image*             colorImage
+) const
+{
+    assert(0 != points.x && 0 != points.y && 0 != points.z);
+
+    return_false_unless(rays.matches(depthImage.cameraInfo.calibration, depthImage.width, depthImage.height));
+    return_false_unless(firstRow + numRows <= depthImage.height);
+
+    const Image::Plane& depthPlane = depthImage.planes[0];
+
+    const size_t depthBytesPerRow = 0 != depthPlane.bytesPerRow ? depthPlane.bytesPerRow : depthImage.width * sizeof(uint16);
+
+    report_false_unless("Invalid depth image plane.",
+           0 != depthPlane.buffer
+        && (depthImage.height - 1) * depthBytesPerRow + depthImage.width * sizeof(uint16) <= depthPlane.sizeInBytes
+    );
+
+    const bool withColor = 0 != colorImage && (0 != points.r || 0 != points.g || 0 != points.b);
+
+    size_t colorBytesPerRow = 0;
+
+    if (withColor)
+    {
+        const Image::Plane& colorPlane = colorImage->planes[0];
+
+        colorBytesPerRow = 0 != colorPlane.bytesPerRow ? colorPlane.bytesPerRow : colorImage->width * 3;
+
+        report_false_unless("Point cloud colors require a registered RGB image.",
+               ImageFormat_RGB == colorImage->format
+            && 0 != colorPlane.buffer
+            && 0 < colorImage->width * colorImage->height
+            && (colorImage->height - 1) * colorBytesPerRow + colorImage->width * 3 <= colorPlane.sizeInBytes
+        );
+    }
+
+    const ShiftToDepthTable* const table = ImageFormat_Shifts == depthImage.format ? &shiftToDepth : 0;
+
+    const size_t width = depthImage.width;
+
+    for (size_t v = firstRow; v < firstRow + numRows; ++v)
+    {
+        const uint16* depths = (const uint16*) ((const uint8*) depthPlane.buffer + v * depthBytesPerRow);
+
+        const size_t offset = v * width;
+
+        if (0 != table)
+            depth_to_point_cloud_row(depths, rays.rowX(v), rays.rowY(v), width, DepthShiftMap(*table), points.x + offset, points.y + offset, points.z + offset);
+        else
+            depth_to_point_cloud_row(depths, rays.rowX(v), rays.rowY(v), width, IdentityShiftMap()   , points.x + offset, points.y + offset, points.z + offset);
+
+        if (!withColor)
+            continue;
+
+        const size_t colorRow = v * colorImage->height / depthImage.height;
+
+        rgb_to_point_cloud_row(
+            (const uint8*) colorImage->planes[0].buffer + colorRow * colorBytesPerRow,
+            colorImage->width,
+            width,
+            0 != points.r ? points.r + offset : 0,
+            0 != points.g ? points.g + offset : 0,
+            0 != points.b ? points.b + offset : 0
+        );
+    }
+
+    return true;
+}
+
+inline bool
+DepthToPointCloud::convert (const Image& depthImage, const PointCloudBuffers& points, const Image* colorImage)
+{
+    return_false_unless(update(depthImage));
+
+    return convertRows(depthImage, 0, depthImage.height, points, colorImage);
+}
+
+inline bool
+DepthToPointCloud::convertInParallel (const Image& depthImage, const PointCloudBuffers& points, const Image* colorImage)
+{
+    return_false_unless(update(depthImage));
+
+    const int numStrips = int((depthImage.height + StripHeight - 1) / StripHeight);
+
+    std::vector<char> converted(numStrips, 0);
+
+    context.tasks().parallelFor(numStrips, [&] (int n)
+    {
+        const size_t firstRow = size_t(n) * StripHeight;
+        const size_t numRows  = std::min(size_t(StripHeight), depthImage.height - firstRow);
+
+        converted[n] = convertRows(depthImage, firstRow, numRows, points, colorImage);
+    });
+
+    return std::find(converted.begin(), converted.end(), 0) == converted.end();
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,207 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./core/platform.h"
+# include "./core/threads.h"
+# include "./endpoints.h"
+# include <cstdio>
+# include <deque>
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Recordings are plain message streams, followed by an index of their messages.
+// The index travels as a last Blob message, tagged RecordingIndexTag, which sequential readers skip like any other blob.
+// Its data ends with the entries, in recording order, then the footer, so that the index is found from the end of the file.
+// Both are stored in the native byte order, which the footer magic tells apart.
+
+enum { RecordingIndexTag = 0x1d };
+
+struct RecordingIndexEntry
+{
+    uint16 kind;          // MessageKind.
+    uint16 reserved;
+    uint32 session;
+    uint64 offset;        // Of the framed message, from the start of the file.
+    uint32 length;        // Of the framed message, header included.
+    uint32 reserved2;
+    double receptionTime; // Recorder clock, in seconds. Never decreasing.
+    double captureTime;   // Sender clock, in seconds. Negative when the message has none.
+};
+
+struct RecordingIndexFooter
+{
+    enum { Magic = 0x78696b73, Version = 1 }; // "skix", in little-endian order.
+
+    uint32 magic;
+    uint32 version;
+    uint64 numEntries;
+    uint64 messagesSize; // In bytes, up to the index message.
+};
+
+//------------------------------------------------------------------------------
+
+// Records the messages an endpoint receives, as framed on the wire, with their compressed payloads.
+// Recordings are plain message streams, which MessageSerializer reads back, and which neither encoding nor decoding went into.
+// Closing appends the index, which RecordingReader relies on. Each recorded message adds an index entry to memory until then.
+// Messages are appended to fixed-size chunks, which a writer thread stores with one large write each.
+// Memory is bounded by the chunk pool: when the disk falls behind and no chunk is free, whole messages are dropped.
+// Record each session to its own file, as session identifiers repeat across endpoints.
+//
+// Usage: recorder.open(path); endpoint.setMessageTap(&recorder); ... endpoint.setMessageTap(0); recorder.close();
+
+class SessionRecorder : public MessageTap
+{
+public:
+    enum
+    {
+        DefaultChunkSize = 4 * 1024 * 1024,
+        DefaultNumChunks = 16,
+        ChunkAlignment   = 4096
+    };
+
+public:
+    // Chunk sizes are rounded up to the alignment, so that all but the last write start and end on aligned file offsets.
+    explicit SessionRecorder (Size chunkSize = DefaultChunkSize, int numChunks = DefaultNumChunks);
+    virtual ~SessionRecorder ();
+
+public:
+    bool open  (CString path);
+    void close (); // Writes the pending chunks first.
+
+    bool isOpen () const;
+
+public:
+    virtual void tapMessage (const Message& message, const Byte* framedBytes, Size framedSize);
+
+public:
+    uint64 numRecordedMessages () const;
+    uint64 numRecordedBytes    () const;
+    uint64 numDroppedMessages  () const;
+
+private:
+    struct Writer : Thread
+    {
+        Writer (SessionRecorder* that) : Thread("uplink::SessionRecorder::Writer"), that(that) {}
+
+        virtual void run () { that->write(); }
+
+        SessionRecorder* that;
+    };
+
+    struct Chunk
+    {
+        Byte* bytes;
+        Size  size;
+    };
+
+private:
+    void write ();
+
+    bool writeIndex ();
+
+private:
+    const Size                       chunkSize;
+    Buffer                           arena;  // All the chunks, aligned.
+    mutable Mutex                    mutex;
+    Condition                        filled;
+    std::deque<Byte*>                freeChunks;
+    std::deque<Chunk>                fullChunks;
+    Chunk                            current;
+    FILE*                            file;
+    bool                             closing;
+    bool                             failed;
+    uint64                           recordedMessages;
+    uint64                           recordedBytes;
+    uint64                           droppedMessages;
+    std::vector<RecordingIndexEntry> index; // Of the recorded messages, written on close.
+    Writer                           writer;
+
+    non_copyable(SessionRecorder)
+};
+
+//------------------------------------------------------------------------------
+
+// Memory-mapped recording playback, with random access through the recording index.
+// Recordings without an index, such as interrupted ones, are indexed by scanning their messages on open.
+// Images of the read messages view their bytes in the mapping, which they keep alive, and which stays valid past close.
+
+class RecordingReader
+{
+public:
+     RecordingReader ();
+    ~RecordingReader ();
+
+public:
+    bool open  (CString path);
+    void close ();
+
+    bool isOpen () const { return 0 != mapping.get(); }
+
+public:
+    size_t                     numMessages () const { return entries.size(); }
+    const RecordingIndexEntry& entry       (size_t index) const { return entries[index]; }
+
+    double startTime () const; // Reception times of the first and last messages.
+    double endTime   () const;
+
+    // Index of the first message received at or after the given time, or the number of messages.
+    size_t seek (double receptionTime) const;
+
+    // Indices of the messages of one kind, in recording order.
+    const std::vector<size_t>& channel (MessageKind kind) const { return channels[kind]; }
+
+    // Position, in the channel, of its first message received at or after the given time, or the channel size.
+    size_t seek (MessageKind kind, double receptionTime) const;
+
+public:
+    // The returned message is reused by following reads of the same kind. Clones are shallow, and share the mapped images.
+    Message* readMessage (size_t index);
+
+    // The framed bytes of a message, for forwarding it as is.
+    const Byte* framedBytes (size_t index) const;
+
+private:
+    struct Mapping;
+
+    struct MappedInputStream : InputStream
+    {
+        MappedInputStream (const Byte* bytes, Size length, const uplink_ref<void>& owner);
+
+        virtual bool read (Byte* bytes, Size size);
+        virtual Size available () const { return length - offset; }
+
+        virtual const Byte* lend (Size size, uplink_ref<void>& owner);
+
+        const Byte*      bytes;
+        Size             length;
+        Size             offset;
+        uplink_ref<void> owner;
+    };
+
+private:
+    bool loadIndex ();
+    bool scanMessages ();
+
+private:
+    uplink_ref<Mapping>              mapping;
+    const Byte*                      bytes;
+    Size                             size;
+    Size                             headerSize;
+    std::vector<RecordingIndexEntry> entries;
+    std::vector<size_t>              channels [MessageKind_HowMany];
+    std::vector<Message*>            messages; // One per kind, reused.
+
+    non_copyable(RecordingReader)
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./recordings.hpp"
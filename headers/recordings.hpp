@@ -0,0 +1,656 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./recordings.h"
+# include <algorithm>
+# include <cstring>
+
+# if !_WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+# endif
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline
+SessionRecorder::SessionRecorder (Size chunkSize, int numChunks)
+    : chunkSize((std::max(chunkSize, Size(1)) + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment)
+    , file(0)
+    , closing(false)
+    , failed(false)
+    , recordedMessages(0)
+    , recordedBytes(0)
+    , droppedMessages(0)
+    , writer(this)
+{
+    assert(0 < numChunks);
+
+    arena.resize(Size(numChunks) * this->chunkSize + ChunkAlignment);
+
+    Byte* const aligned = mutableBufferBytes(arena) + (ChunkAlignment - uintptr_t(mutableBufferBytes(arena)) % ChunkAlignment) % ChunkAlignment;
+
+    for (int n = 0; n < numChunks; ++n)
+        freeChunks.push_back(aligned + Size(n) * this->chunkSize);
+
+    current.bytes = 0;
+    current.size  = 0;
+}
+
+inline
+SessionRecorder::~SessionRecorder ()
+{
+    close();
+}
+
+inline bool
+SessionRecorder::open (CString path)
+{
+    assert(0 != path);
+
+    const MutexLocker _(mutex);
+
+    report_false_if("Session recorder already open.", 0 != file);
+
+    file = fopen(path, "wb");
+
+    if (0 == file)
+    {
+        uplink_log_error("Cannot open the recording: %s", path);
+
+        return false;
+    }
+
+    // Chunks are written whole, and need no further buffering.
+    setvbuf(file, 0, _IONBF, 0);
+
+    closing          = false;
+    failed           = false;
+    recordedMessages = 0;
+    recordedBytes    = 0;
+    droppedMessages  = 0;
+
+    index.clear();
+
+    writer.start();
+
+    return true;
+}
+
+inline void
+SessionRecorder::close ()
+{
+    {
+        const MutexLocker _(mutex);
+
+        return_if(0 == file);
+
+        if (0 != current.bytes)
+            fullChunks.push_back(current); // Possibly shorter than the others.
+
+        current.bytes = 0;
+        current.size  = 0;
+
+        closing = true;
+
+        filled.signal();
+    }
+
+    writer.join();
+
+    // Interrupted recordings go without an index, which readers then rebuild.
+    if (!failed && !writeIndex())
+        uplink_log_error("Session recorder cannot write the recording index.");
+
+    fclose(file);
+
+    const MutexLocker _(mutex);
+
+    file = 0;
+
+    if (0 < droppedMessages)
+        uplink_log_warning("Session recorder dropped %llu messages.", (unsigned long long) droppedMessages);
+}
+
+inline bool
+SessionRecorder::isOpen () const
+{
+    const MutexLocker _(mutex);
+
+    return 0 != file;
+}
+
+inline void
+SessionRecorder::tapMessage (const Message& message, const Byte* framedBytes, Size framedSize)
+{
+    assert(0 != framedBytes);
+
+    const MutexLocker _(mutex);
+
+    return_if(0 == file || closing);
+
+    // Messages are either recorded whole, or dropped, so that recordings always read back.
+    const Size room = (0 != current.bytes ? chunkSize - current.size : 0) + freeChunks.size() * chunkSize;
+
+    if (failed || room < framedSize)
+    {
+        if (0 == droppedMessages++ && !failed)
+            uplink_log_warning("Session recorder falling behind: dropping messages.");
+
+        return;
+    }
+
+    index.push_back(RecordingIndexEntry());
+
+    RecordingIndexEntry& entry = index.back();
+
+    entry.kind          = uint16(message.kind());
+    entry.reserved      = 0;
+    entry.session       = message.sessionId;
+    entry.offset        = recordedBytes;
+    entry.length        = uint32(framedSize);
+    entry.reserved2     = 0;
+    entry.receptionTime = getTime();
+
+    if (!Endpoint::captureTime(message, entry.captureTime))
+        entry.captureTime = -1.;
+
+    recordedMessages += 1;
+    recordedBytes    += framedSize;
+
+    while (0 < framedSize)
+    {
+        if (0 == current.bytes)
+        {
+            current.bytes = freeChunks.front();
+            current.size  = 0;
+
+            freeChunks.pop_front();
+        }
+
+        const Size count = std::min(framedSize, chunkSize - current.size);
+
+        std::memcpy(current.bytes + current.size, framedBytes, count);
+
+        current.size += count;
+        framedBytes  += count;
+        framedSize   -= count;
+
+        if (chunkSize == current.size)
+        {
+            fullChunks.push_back(current);
+
+            current.bytes = 0;
+
+            filled.signal();
+        }
+    }
+}
+
+inline uint64
+SessionRecorder::numRecordedMessages () const
+{
+    const MutexLocker _(mutex);
+
+    return recordedMessages;
+}
+
+inline uint64
+SessionRecorder::numRecordedBytes () const
+{
+    const MutexLocker _(mutex);
+
+    return recordedBytes;
+}
+
+inline uint64
+SessionRecorder::numDroppedMessages () const
+{
+    const MutexLocker _(mutex);
+
+    return droppedMessages;
+}
+
+inline void
+SessionRecorder::write ()
+{
+    for (;;)
+    {
+        Chunk chunk;
+        bool  skipped;
+
+        {
+            const MutexLocker _(mutex);
+
+            while (fullChunks.empty() && !closing)
+                filled.waitLocked(&mutex);
+
+            return_if(fullChunks.empty()); // Closing, and done.
+
+            chunk   = fullChunks.front();
+            skipped = failed;
+
+            fullChunks.pop_front();
+        }
+
+        // Written without the lock, so that messages keep being appended meanwhile.
+        const bool written = !skipped && chunk.size == fwrite(chunk.bytes, 1, chunk.size, file);
+
+        const MutexLocker _(mutex);
+
+        freeChunks.push_back(chunk.bytes);
+
+        if (!written && !failed)
+        {
+            uplink_log_error("Session recorder cannot write: the recording stops here.");
+
+            failed = true;
+        }
+    }
+}
+
+inline bool
+SessionRecorder::writeIndex ()
+{
+    // The writer is done, and the messages are all written.
+
+    RecordingIndexFooter footer;
+
+    footer.magic        = RecordingIndexFooter::Magic;
+    footer.version      = RecordingIndexFooter::Version;
+    footer.numEntries   = index.size();
+    footer.messagesSize = recordedBytes;
+
+    const Size entriesSize = index.size() * sizeof(RecordingIndexEntry);
+
+    report_false_if("Recording index too large.", Message::MaxSize < entriesSize + sizeof(footer) + 0x100);
+
+    Blob blob;
+
+    blob.sessionId = SystemSessionId;
+    blob.tag       = RecordingIndexTag;
+
+    blob.data.resize(entriesSize + sizeof(footer));
+
+    if (0 < entriesSize)
+        std::memcpy(blob.data.data(), index.data(), entriesSize);
+
+    std::memcpy(blob.data.data() + entriesSize, &footer, sizeof(footer));
+
+    MessageSerializer serializer("skan");
+
+    Buffer frame;
+    BufferOutputStream output(frame);
+
+    return_false_unless(serializer.writeMessage(output, blob));
+
+    return frame.size() == fwrite(frame.data(), 1, frame.size(), file);
+}
+
+//------------------------------------------------------------------------------
+
+struct RecordingReader::Mapping
+{
+    Mapping ()
+    : bytes(0)
+    , size(0)
+# if _WIN32
+    , file(INVALID_HANDLE_VALUE)
+    , mapping(0)
+# endif
+    {
+    }
+
+    ~Mapping ()
+    {
+# if _WIN32
+        if (0 != bytes)
+            UnmapViewOfFile(bytes);
+
+        if (0 != mapping)
+            CloseHandle(mapping);
+
+        if (INVALID_HANDLE_VALUE != file)
+            CloseHandle(file);
+# else
+        if (0 != bytes)
+            munmap(bytes, size);
+# endif
+    }
+
+    // Private, writable mappings: pages written to by image consumers are copied, and the file is left untouched.
+    bool map (CString path)
+    {
+# if _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        report_false_if("Cannot open the recording.", INVALID_HANDLE_VALUE == file);
+
+        LARGE_INTEGER fileSize;
+        report_false_unless("Cannot size the recording.", GetFileSizeEx(file, &fileSize) && 0 < fileSize.QuadPart);
+
+        mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+        report_false_if("Cannot map the recording.", 0 == mapping);
+
+        bytes = (Byte*) MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        report_false_if("Cannot map the recording.", 0 == bytes);
+
+        size = Size(fileSize.QuadPart);
+# else
+        const int descriptor = ::open(path, O_RDONLY);
+        report_false_if("Cannot open the recording.", descriptor < 0);
+
+        struct stat status;
+
+        if (0 != fstat(descriptor, &status) || status.st_size <= 0)
+        {
+            ::close(descriptor);
+
+            uplink_log_error("Cannot size the recording: %s", path);
+
+            return false;
+        }
+
+        void* const mapped = mmap(0, Size(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+
+        ::close(descriptor); // The mapping keeps the file open.
+
+        report_false_if("Cannot map the recording.", MAP_FAILED == mapped);
+
+        bytes = (Byte*) mapped;
+        size  = Size(status.st_size);
+# endif
+
+        return true;
+    }
+
+    Byte* bytes;
+    Size  size;
+
+# if _WIN32
+    HANDLE file;
+    HANDLE mapping;
+# endif
+};
+
+//------------------------------------------------------------------------------
+
+inline
+RecordingReader::MappedInputStream::MappedInputStream (const Byte* bytes, Size length, const uplink_ref<void>& owner)
+    : bytes(bytes)
+    , length(length)
+    , offset(0)
+    , owner(owner)
+{
+}
+
+inline bool
+RecordingReader::MappedInputStream::read (Byte* bytes, Size size)
+{
+    return_false_if(length - offset < size);
+
+    std::memcpy(bytes, this->bytes + offset, size);
+
+    offset += size;
+
+    return true;
+}
+
+inline const Byte*
+RecordingReader::MappedInputStream::lend (Size size, uplink_ref<void>& owner)
+{
+    return_zero_if(length - offset < size);
+
+    const Byte* const lent = bytes + offset;
+
+    offset += size;
+
+    owner = this->owner;
+
+    return lent;
+}
+
+//------------------------------------------------------------------------------
+
+inline
+RecordingReader::RecordingReader ()
+    : bytes(0)
+    , size(0)
+    , headerSize(MessageHeader("skan").chunkSize())
+{
+# define UPLINK_MESSAGE(Name, name) \
+    messages.push_back(new Name());
+         UPLINK_MESSAGES()
+# undef  UPLINK_MESSAGE
+}
+
+inline
+RecordingReader::~RecordingReader ()
+{
+    close();
+
+    for (size_t n = 0; n < messages.size(); ++n)
+        delete messages[n];
+}
+
+inline bool
+RecordingReader::open (CString path)
+{
+    assert(0 != path);
+
+    close();
+
+    uplink_ref<Mapping> mapped(new Mapping());
+
+    return_false_unless(mapped->map(path));
+
+    mapping = mapped;
+    bytes   = mapped->bytes;
+    size    = mapped->size;
+
+    if (!loadIndex())
+    {
+        uplink_log_warning("Recording without an index: scanning %s.", path);
+
+        if (!scanMessages())
+        {
+            close();
+
+            return false;
+        }
+    }
+
+    for (size_t n = 0; n < entries.size(); ++n)
+        channels[entries[n].kind].push_back(n);
+
+    return true;
+}
+
+inline void
+RecordingReader::close ()
+{
+    // Messages read earlier keep the mapping alive, as long as they view its images.
+    mapping.reset();
+
+    bytes = 0;
+    size  = 0;
+
+    entries.clear();
+
+    for (int n = 0; n < MessageKind_HowMany; ++n)
+        channels[n].clear();
+}
+
+inline double
+RecordingReader::startTime () const
+{
+    return entries.empty() ? 0. : entries.front().receptionTime;
+}
+
+inline double
+RecordingReader::endTime () const
+{
+    return entries.empty() ? 0. : entries.back().receptionTime;
+}
+
+namespace {
+
+inline bool
+recording_entry_before (const RecordingIndexEntry& entry, double receptionTime)
+{
+    return entry.receptionTime < receptionTime;
+}
+
+}
+
+inline size_t
+RecordingReader::seek (double receptionTime) const
+{
+    return std::lower_bound(entries.begin(), entries.end(), receptionTime, recording_entry_before) - entries.begin();
+}
+
+inline size_t
+RecordingReader::seek (MessageKind kind, double receptionTime) const
+{
+    const std::vector<size_t>& indices = channels[kind];
+
+    return std::lower_bound(indices.begin(), indices.end(), receptionTime, [this] (size_t index, double time)
+    {
+        return entries[index].receptionTime < time;
+    }) - indices.begin();
+}
+
+inline Message*
+RecordingReader::readMessage (size_t index)
+{
+    assert(index < entries.size());
+
+    const RecordingIndexEntry& entry = entries[index];
+
+    Message* const message = messages[entry.kind];
+
+    MappedInputStream input(bytes + entry.offset + headerSize, Size(entry.length) - headerSize, mapping);
+
+    report_zero_unless("Cannot read the recorded message.", message->readFrom(input));
+
+    message->sessionId = entry.session;
+
+    return message;
+}
+
+inline const Byte*
+RecordingReader::framedBytes (size_t index) const
+{
+    assert(index < entries.size());
+
+    return bytes + entries[index].offset;
+}
+
+inline bool
+RecordingReader::loadIndex ()
+{
+    RecordingIndexFooter footer;
+
+    return_false_if(size < sizeof(footer));
+
+    std::memcpy(&footer, bytes + size - sizeof(footer), sizeof(footer));
+
+    return_false_if(RecordingIndexFooter::Magic != footer.magic || RecordingIndexFooter::Version != footer.version);
+
+    // Checked before multiplying, as foreign or corrupt footers may count anything.
+    return_false_if((size - sizeof(footer)) / sizeof(RecordingIndexEntry) < footer.numEntries);
+
+    const uint64 entriesSize = footer.numEntries * sizeof(RecordingIndexEntry);
+
+    return_false_if(size - sizeof(footer) - entriesSize < footer.messagesSize);
+
+    // Copied out, as the entries of the index message are not aligned.
+    entries.resize(size_t(footer.numEntries));
+
+    if (0 < entriesSize)
+        std::memcpy(entries.data(), bytes + size - sizeof(footer) - entriesSize, size_t(entriesSize));
+
+    for (size_t n = 0; n < entries.size(); ++n)
+    {
+        const RecordingIndexEntry& entry = entries[n];
+
+        if (MessageKind_HowMany <= entry.kind || entry.length < headerSize || footer.messagesSize < entry.length || footer.messagesSize - entry.length < entry.offset)
+        {
+            entries.clear();
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline bool
+RecordingReader::scanMessages ()
+{
+    // Scanned recordings have no reception times: capture times stand for them, when known.
+
+    MessageHeader header("skan");
+
+    double receptionTime = 0.;
+
+    for (Size offset = 0; headerSize <= size - offset;)
+    {
+        header.fetchFrom(bytes + offset);
+
+        if ("skan" != header.magic || MessageKind_HowMany <= header.kind || size - offset - headerSize < header.length)
+            break; // Truncated, most likely.
+
+        entries.push_back(RecordingIndexEntry());
+
+        RecordingIndexEntry& entry = entries.back();
+
+        entry.kind      = uint16(header.kind);
+        entry.reserved  = 0;
+        entry.session   = header.session;
+        entry.offset    = offset;
+        entry.length    = uint32(headerSize + header.length);
+        entry.reserved2 = 0;
+
+        offset += entry.length;
+
+        const Message* const message = readMessage(entries.size() - 1);
+
+        if (0 == message)
+        {
+            entries.pop_back();
+
+            break;
+        }
+
+        if (!Endpoint::captureTime(*message, entry.captureTime))
+            entry.captureTime = -1.;
+
+        receptionTime = std::max(receptionTime, entry.captureTime);
+
+        entry.receptionTime = receptionTime;
+    }
+
+    report_false_if("No messages in the recording.", entries.empty());
+
+    // Leading messages without capture times take the first known one.
+    size_t first = 0;
+
+    while (first < entries.size() && entries[first].receptionTime <= 0.)
+        ++first;
+
+    if (first < entries.size())
+        for (size_t n = 0; n < first; ++n)
+            entries[n].receptionTime = entries[first].receptionTime;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+}
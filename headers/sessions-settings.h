@@ -59,8 +59,38 @@ UPLINK_ENUM_BEGIN(ImageCodecId)
     ImageCodecId_CompressedShifts,
     ImageCodecId_JPEG,
     ImageCodecId_H264,
+    ImageCodecId_LosslessColor,
+    ImageCodecId_NearLosslessShifts,
+    ImageCodecId_RANSShifts,
 UPLINK_ENUM_END(ImageCodecId)
 
+inline CString
+imageCodecName (ImageCodecId imageCodecId)
+{
+    switch (imageCodecId)
+    {
+        case ImageCodecId_CompressedShifts  : return "CompressedShifts";
+        case ImageCodecId_JPEG              : return "JPEG";
+        case ImageCodecId_H264              : return "H264";
+        case ImageCodecId_LosslessColor     : return "LosslessColor";
+        case ImageCodecId_NearLosslessShifts: return "NearLosslessShifts";
+        case ImageCodecId_RANSShifts        : return "RANSShifts";
+        default                             : return "Invalid";
+    }
+}
+
+// Codec sets are bit masks over codec identifiers, with one extra bit for uncompressed images.
+
+inline uint32 imageCodecBit (ImageCodecId imageCodecId) { return uint32(1) << int(imageCodecId); }
+
+static const uint32 UncompressedImageCodecBit = uint32(1) << 31;
+
+UPLINK_ENUM_BEGIN(DepthTemporalFilterMode)
+    DepthTemporalFilterMode_None,
+    DepthTemporalFilterMode_Median,
+    DepthTemporalFilterMode_ExponentialMovingAverage,
+UPLINK_ENUM_END(DepthTemporalFilterMode)
+
 UPLINK_ENUM_BEGIN(BufferingStrategy)
     BufferingStrategy_One,
     BufferingStrategy_Some,
@@ -155,7 +185,18 @@ struct ChannelSettings : Serializable
          UPLINK_SESSION_SETTING(ImageCodecId               , DepthCameraCodec           , depthCameraCodec) \
          UPLINK_SESSION_SETTING(ImageCodecId               , ColorCameraCodec           , colorCameraCodec) \
          UPLINK_SESSION_SETTING(ImageCodecId               , FeedbackImageCodec         , feedbackImageCodec) \
-         UPLINK_SESSION_SETTING(uint16                     , MotionRate                 , motionRate)
+         UPLINK_SESSION_SETTING(uint16                     , MotionRate                 , motionRate) \
+         UPLINK_SESSION_SETTING(uint8                      , DepthCameraCodecMaxError   , depthCameraCodecMaxError) \
+         UPLINK_SESSION_SETTING(uint32                     , DepthCameraCodecs          , depthCameraCodecs) \
+         UPLINK_SESSION_SETTING(uint32                     , ColorCameraCodecs          , colorCameraCodecs) \
+         UPLINK_SESSION_SETTING(bool                       , DeliverDepthInMillimeters  , deliverDepthInMillimeters) \
+         UPLINK_SESSION_SETTING(DepthTemporalFilterMode    , DepthTemporalFilterMode    , depthTemporalFilterMode) \
+         UPLINK_SESSION_SETTING(uint8                      , DepthTemporalFilterLength  , depthTemporalFilterLength) \
+         UPLINK_SESSION_SETTING(float                      , DepthTemporalFilterWeight  , depthTemporalFilterWeight) \
+         UPLINK_SESSION_SETTING(uint8                      , DepthBilateralFilterRadius , depthBilateralFilterRadius) \
+         UPLINK_SESSION_SETTING(float                      , DepthBilateralFilterSigma  , depthBilateralFilterSigma) \
+         UPLINK_SESSION_SETTING(uint8                      , FeedbackImageDownscale     , feedbackImageDownscale) \
+         UPLINK_SESSION_SETTING(float                      , ClockSyncInterval          , clockSyncInterval)
 # undef  UPLINK_SESSION_SETTING
 
 //------------------------------------------------------------------------------
@@ -41,6 +41,29 @@ SessionSettings::SessionSettings ()
     colorCameraCodec = ImageCodecId_Invalid;
     feedbackImageCodec = ImageCodecId_Invalid;
 
+    // Lossy depth codecs are lossless, unless told otherwise.
+    depthCameraCodecMaxError = 0;
+
+    // Camera images are compressed with the session codecs only, unless other decodable codecs are advertised.
+    depthCameraCodecs = 0;
+    colorCameraCodecs = 0;
+
+    // Depth camera images are delivered as shifts, unless told otherwise.
+    deliverDepthInMillimeters = false;
+
+    // Received depth camera images are delivered unfiltered, unless told otherwise.
+    depthTemporalFilterMode    = DepthTemporalFilterMode_None;
+    depthTemporalFilterLength  = 5;   // Frames, for the median.
+    depthTemporalFilterWeight  = .5f; // Of the newest frame, for the moving average.
+    depthBilateralFilterRadius = 0;   // Pixels. Zero disables the filter.
+    depthBilateralFilterSigma  = .02f; // Of the center depth value, for the range weights.
+
+    // Feedback images are sent at full resolution, unless told otherwise. Powers of two only.
+    feedbackImageDownscale = 1;
+
+    // Clocks are not synchronized, unless told otherwise, since earlier peers do not know the ClockSync messages.
+    clockSyncInterval = 0.f; // Seconds between requests. Zero disables them.
+
     // Channel settings are initialized in their default-constructor.
 }
 
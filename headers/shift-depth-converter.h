@@ -4,6 +4,7 @@
 
 # pragma once
 
+# include "./camera-calibration.h"
 # include <cmath>
 # include <cstdint>
 
@@ -41,6 +42,54 @@ private:
     double B = NAN;
 };
 
+//------------------------------------------------------------------------------
+
+// Shift to depth (in millimeters) lookup table, generated from the depth camera fixed parameters.
+// Tables are only regenerated when the parameters change, so updating them with each frame is cheap.
+
+class ShiftToDepthTable
+{
+public:
+    enum
+    {
+        NumShifts             = 0x800, // Shifts are 11-bit values.
+        MaxDepthInMillimeters = 10000, // Farther depths saturate, like in the fixed shift2depth table.
+    };
+
+public:
+    ShiftToDepthTable ();
+
+public:
+    // Frames without fixed parameters fall back to the default ones.
+    void update (const CameraInfo& cameraInfo);
+
+    void update (
+        float cmosAndEmitterDistance,
+        float referencePlaneDistance,
+        float planePixelSize,
+        int   sensorPixelSizeFactor
+    );
+
+    // Whether the table was generated for the camera fixed parameters.
+    bool matches (const CameraInfo& cameraInfo) const;
+
+public:
+    uint16 operator [] (uint16 shift) const { return table[shift < NumShifts ? shift : NumShifts - 1]; }
+
+    // Input and output may be the same buffer.
+    void convert (const uint16* shifts, uint16* depths, size_t size) const;
+
+private:
+    static void fixedParameters (const CameraInfo& cameraInfo, float& cmosAndEmitterDistance, float& referencePlaneDistance, float& planePixelSize, int& sensorPixelSizeFactor);
+
+private:
+    float  cmosAndEmitterDistance;
+    float  referencePlaneDistance;
+    float  planePixelSize;
+    int    sensorPixelSizeFactor;
+    uint16 table [NumShifts];
+};
+
 } // uplink namespace
 
 # include "shift-depth-converter.hpp"
@@ -7,6 +7,7 @@
 # include "shift-depth-converter.h"
 
 # include <cassert>
+# include <algorithm>
 
 namespace uplink {
 
@@ -90,4 +91,133 @@ ShiftDepthConverter::depthInMillimetersToShift (float depthInMillimeters)
     return -B + 1.0 / ((depthInMillimeters - fRegisteredDepthOffset) / A);
 }
 
+//------------------------------------------------------------------------------
+
+inline
+ShiftToDepthTable::ShiftToDepthTable ()
+    : cmosAndEmitterDistance(NAN)
+    , referencePlaneDistance(NAN)
+    , planePixelSize(NAN)
+    , sensorPixelSizeFactor(-1)
+{
+    std::fill(table, table + NumShifts, uint16(0));
+}
+
+inline void
+ShiftToDepthTable::fixedParameters (const CameraInfo& cameraInfo, float& cmosAndEmitterDistance, float& referencePlaneDistance, float& planePixelSize, int& sensorPixelSizeFactor)
+{
+    if (isnan(cameraInfo.cmosAndEmitterDistance)
+     || isnan(cameraInfo.referencePlaneDistance)
+     || isnan(cameraInfo.planePixelSize)
+     || cameraInfo.pixelSizeFactor < 1)
+    {
+        // Same values as ShiftDepthConverter::initializeWithDefaults.
+        cmosAndEmitterDistance = 6.5f;
+        referencePlaneDistance = 90.0f;
+        planePixelSize         = 0.078f;
+        sensorPixelSizeFactor  = 1;
+
+        return;
+    }
+
+    cmosAndEmitterDistance = cameraInfo.cmosAndEmitterDistance;
+    referencePlaneDistance = cameraInfo.referencePlaneDistance;
+    planePixelSize         = cameraInfo.planePixelSize;
+    sensorPixelSizeFactor  = cameraInfo.pixelSizeFactor;
+}
+
+inline void
+ShiftToDepthTable::update (const CameraInfo& cameraInfo)
+{
+    float cmosAndEmitterDistance, referencePlaneDistance, planePixelSize;
+    int   sensorPixelSizeFactor;
+
+    fixedParameters(cameraInfo, cmosAndEmitterDistance, referencePlaneDistance, planePixelSize, sensorPixelSizeFactor);
+
+    update(cmosAndEmitterDistance, referencePlaneDistance, planePixelSize, sensorPixelSizeFactor);
+}
+
+inline bool
+ShiftToDepthTable::matches (const CameraInfo& cameraInfo) const
+{
+    float cmosAndEmitterDistance, referencePlaneDistance, planePixelSize;
+    int   sensorPixelSizeFactor;
+
+    fixedParameters(cameraInfo, cmosAndEmitterDistance, referencePlaneDistance, planePixelSize, sensorPixelSizeFactor);
+
+    return cmosAndEmitterDistance == this->cmosAndEmitterDistance
+        && referencePlaneDistance == this->referencePlaneDistance
+        && planePixelSize         == this->planePixelSize
+        && sensorPixelSizeFactor  == this->sensorPixelSizeFactor
+        ;
+}
+
+inline void
+ShiftToDepthTable::update (
+    float cmosAndEmitterDistance,
+    float referencePlaneDistance,
+    float planePixelSize,
+    int   sensorPixelSizeFactor
+)
+{
+    if (cmosAndEmitterDistance == this->cmosAndEmitterDistance
+     && referencePlaneDistance == this->referencePlaneDistance
+     && planePixelSize         == this->planePixelSize
+     && sensorPixelSizeFactor  == this->sensorPixelSizeFactor)
+        return; // Same calibration, same table.
+
+    this->cmosAndEmitterDistance = cmosAndEmitterDistance;
+    this->referencePlaneDistance = referencePlaneDistance;
+    this->planePixelSize         = planePixelSize;
+    this->sensorPixelSizeFactor  = sensorPixelSizeFactor;
+
+    ShiftDepthConverter converter;
+    converter.initialize(cmosAndEmitterDistance, referencePlaneDistance, planePixelSize, sensorPixelSizeFactor, 0.f);
+
+    // Zero shifts mean no depth. Past the maximum depth, shifts saturate to the last depth.
+    table[0] = 0;
+
+    uint16 last = 0;
+
+    for (int shift = 1; shift < NumShifts; ++shift)
+    {
+        const float depth = converter.shiftToDepthInMillimeters(float(shift));
+
+        if (0 < last && !(last <= depth && depth <= float(MaxDepthInMillimeters)))
+        {
+            std::fill(table + shift, table + NumShifts, last);
+
+            break;
+        }
+
+        table[shift] = last = 0.f < depth && depth <= float(MaxDepthInMillimeters) ? uint16(depth) : uint16(0);
+    }
+}
+
+inline void
+ShiftToDepthTable::convert (const uint16* shifts, uint16* depths, size_t size) const
+{
+    assert(0 != shifts);
+    assert(0 != depths);
+
+    // The table fits in L1 caches, and gathers have no portable vector form: unrolling lets the loads overlap.
+    size_t n = 0;
+
+    for (; n + 4 <= size; n += 4)
+    {
+        const uint16 d0 = (*this)[shifts[n + 0]];
+        const uint16 d1 = (*this)[shifts[n + 1]];
+        const uint16 d2 = (*this)[shifts[n + 2]];
+        const uint16 d3 = (*this)[shifts[n + 3]];
+
+        depths[n + 0] = d0;
+        depths[n + 1] = d1;
+        depths[n + 2] = d2;
+        depths[n + 3] = d3;
+    }
+
+    for (; n < size; ++n)
+        depths[n] = (*this)[shifts[n]];
+}
+
 } // uplink namespace
@@ -0,0 +1,95 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./image.h"
+# include "./camera-calibration.h"
+# include "./core/threads.h"
+# include <list>
+# include <vector>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+// Fixed-point bilinear remap table of one image plane, mapping each undistorted pixel to its distorted source.
+
+struct UndistortionRemap
+{
+    enum { FractionBits = 8, FractionOne = 1 << FractionBits };
+
+    struct Entry
+    {
+        uint16 x; // Top-left source pixel, with x == InvalidX when the source falls outside of the plane.
+        uint16 y;
+        uint16 fractionX; // [0, FractionOne]
+        uint16 fractionY;
+    };
+
+    enum { InvalidX = 0xffff };
+
+    void build (const CameraCalibration& calibration, size_t width, size_t height);
+
+    size_t             width;
+    size_t             height;
+    std::vector<Entry> entries;
+};
+
+// Remap tables of all the planes of an image format.
+
+struct UndistortionMaps
+{
+    UndistortionMaps (const CameraCalibration& calibration, ImageFormat format, size_t width, size_t height);
+
+    bool matches (const CameraCalibration& calibration, ImageFormat format, size_t width, size_t height) const;
+
+    CameraCalibration calibration;
+    ImageFormat       format;
+    size_t            width;
+    size_t            height;
+    int               numPlanes;
+    int               numChannels [Image::MaxNumPlanes];
+    uint8             border      [Image::MaxNumPlanes]; // Fill value of pixels without source.
+    UndistortionRemap remaps      [Image::MaxNumPlanes];
+};
+
+//------------------------------------------------------------------------------
+
+// Undistorts ImageFormat_RGB and ImageFormat_YCbCr color images, keeping their intrinsics.
+// Remap tables are built once per calibration, and kept in a small cache shared by concurrent callers.
+
+class ColorUndistorter
+{
+public:
+    enum
+    {
+        StripHeight = 32, // Rows per parallel remapping task.
+        CacheSize   = 4,
+    };
+
+public:
+    static bool canUndistort (const Image& image);
+
+public:
+    // Produces an image of the same format and size, whose calibration has no distortion left.
+    bool undistort           (const Image& source, Image& target);
+    bool undistortInParallel (const Image& source, Image& target);
+
+public:
+    uplink_ref<const UndistortionMaps> maps (const CameraCalibration& calibration, ImageFormat format, size_t width, size_t height);
+
+private:
+    bool undistort (const Image& source, Image& target, bool parallel);
+
+private:
+    Mutex                                         mutex;
+    std::list<uplink_ref<const UndistortionMaps>> cache; // Most recently used first.
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+# include "./undistortion.hpp"
@@ -0,0 +1,371 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+# pragma once
+
+# include "./undistortion.h"
+# include "./context.h"
+# include <algorithm>
+# include <cmath>
+
+namespace uplink {
+
+//------------------------------------------------------------------------------
+
+inline void
+UndistortionRemap::build (const CameraCalibration& calibration, size_t width, size_t height)
+{
+    this->width  = width;
+    this->height = height;
+
+    entries.resize(width * height);
+
+    for (size_t v = 0; v < height; ++v)
+    for (size_t u = 0; u < width ; ++u)
+    {
+        Entry& entry = entries[v * width + u];
+
+        float x, y;
+
+        calibration.distort(
+            (float(u) - calibration.cx) / calibration.fx,
+            (float(v) - calibration.cy) / calibration.fy,
+            x, y
+        );
+
+        const float sourceX = calibration.fx * x + calibration.cx;
+        const float sourceY = calibration.fy * y + calibration.cy;
+
+        if (!(0.f <= sourceX && sourceX <= float(width - 1) && 0.f <= sourceY && sourceY <= float(height - 1)))
+        {
+            entry.x = uint16(InvalidX);
+            entry.y = 0;
+            entry.fractionX = 0;
+            entry.fractionY = 0;
+
+            continue;
+        }
+
+        // The bottom-right neighbors stay inside of the plane, with a full weight on the last row or column.
+        const size_t x0 = std::min(size_t(sourceX), width  < 2 ? size_t(0) : width  - 2);
+        const size_t y0 = std::min(size_t(sourceY), height < 2 ? size_t(0) : height - 2);
+
+        entry.x = uint16(x0);
+        entry.y = uint16(y0);
+        entry.fractionX = uint16(std::min(int(FractionOne), int((sourceX - float(x0)) * FractionOne + .5f)));
+        entry.fractionY = uint16(std::min(int(FractionOne), int((sourceY - float(y0)) * FractionOne + .5f)));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+inline
+UndistortionMaps::UndistortionMaps (const CameraCalibration& calibration, ImageFormat format, size_t width, size_t height)
+    : calibration(calibration)
+    , format(format)
+    , width(width)
+    , height(height)
+    , numPlanes(0)
+{
+    size_t planeWidths  [Image::MaxNumPlanes];
+    size_t planeHeights [Image::MaxNumPlanes];
+
+    switch (format)
+    {
+        case ImageFormat_RGB:
+        {
+            numPlanes = 1;
+
+            planeWidths[0] = width; planeHeights[0] = height; numChannels[0] = 3; border[0] = 0;
+
+            break;
+        }
+
+        case ImageFormat_YCbCr: // Bi-planar 4:2:0, with interleaved chroma.
+        {
+            numPlanes = 2;
+
+            planeWidths[0] = width;           planeHeights[0] = height;           numChannels[0] = 1; border[0] = 0;
+            planeWidths[1] = (width + 1) / 2; planeHeights[1] = (height + 1) / 2; numChannels[1] = 2; border[1] = 0x80;
+
+            break;
+        }
+
+        default:
+            return;
+    }
+
+    for (int p = 0; p < numPlanes; ++p)
+    {
+        // Subsampled planes see the same lens, with their sample centers scaled from the full resolution ones.
+        CameraCalibration planeCalibration = calibration;
+
+        const float scaleX = float(planeWidths [p]) / float(width);
+        const float scaleY = float(planeHeights[p]) / float(height);
+
+        planeCalibration.fx = calibration.fx * scaleX;
+        planeCalibration.fy = calibration.fy * scaleY;
+        planeCalibration.cx = (calibration.cx + .5f) * scaleX - .5f;
+        planeCalibration.cy = (calibration.cy + .5f) * scaleY - .5f;
+
+        remaps[p].build(planeCalibration, planeWidths[p], planeHeights[p]);
+    }
+}
+
+inline bool
+UndistortionMaps::matches (const CameraCalibration& calibration, ImageFormat format, size_t width, size_t height) const
+{
+    return format == this->format
+        && width  == this->width
+        && height == this->height
+        && calibration == this->calibration
+        ;
+}
+
+//------------------------------------------------------------------------------
+
+template < int NumChannels >
+inline void
+undistortion_remap_rows (
+    const UndistortionRemap& remap,
+    const uint8*             source,
+    size_t                   sourceBytesPerRow,
+    uint8*                   target,
+    size_t                   targetBytesPerRow,
+    size_t                   firstRow,
+    size_t                   numRows,
+    uint8                    border
+)
+{
+    enum { One = UndistortionRemap::FractionOne, Shift = 2 * UndistortionRemap::FractionBits };
+
+    for (size_t v = firstRow; v < firstRow + numRows; ++v)
+    {
+        const UndistortionRemap::Entry* entries = &remap.entries[v * remap.width];
+
+        uint8* pixel = target + v * targetBytesPerRow;
+
+        for (size_t u = 0; u < remap.width; ++u, pixel += NumChannels)
+        {
+            const UndistortionRemap::Entry& entry = entries[u];
+
+            if (UndistortionRemap::InvalidX == entry.x)
+            {
+                for (int c = 0; c < NumChannels; ++c)
+                    pixel[c] = border;
+
+                continue;
+            }
+
+            const uint32 w11 = uint32(entry.fractionX) * entry.fractionY;
+            const uint32 w10 = uint32(entry.fractionX) * One - w11;
+            const uint32 w01 = uint32(entry.fractionY) * One - w11;
+            const uint32 w00 = uint32(One) * One - w10 - w01 - w11;
+
+            const uint8* top    = source + entry.y * sourceBytesPerRow + entry.x * NumChannels;
+            const uint8* bottom = 1 < remap.height ? top + sourceBytesPerRow : top;
+            const int    right  = 1 < remap.width ? NumChannels : 0;
+
+            for (int c = 0; c < NumChannels; ++c)
+            {
+                const uint32 value =
+                      w00 * top   [c] + w10 * top   [c + right]
+                    + w01 * bottom[c] + w11 * bottom[c + right]
+                    ;
+
+                pixel[c] = uint8((value + (1u << (Shift - 1))) >> Shift);
+            }
+        }
+    }
+}
+
+inline void
+undistortion_remap_rows (
+    const UndistortionRemap& remap,
+    int                      numChannels,
+    const uint8*             source,
+    size_t                   sourceBytesPerRow,
+    uint8*                   target,
+    size_t                   targetBytesPerRow,
+    size_t                   firstRow,
+    size_t                   numRows,
+    uint8                    border
+)
+{
+    switch (numChannels)
+    {
+        case 1: return undistortion_remap_rows<1>(remap, source, sourceBytesPerRow, target, targetBytesPerRow, firstRow, numRows, border);
+        case 2: return undistortion_remap_rows<2>(remap, source, sourceBytesPerRow, target, targetBytesPerRow, firstRow, numRows, border);
+        case 3: return undistortion_remap_rows<3>(remap, source, sourceBytesPerRow, target, targetBytesPerRow, firstRow, numRows, border);
+    }
+
+    assert(false); // Unsupported channel count.
+}
+
+struct UndistortionStrip
+{
+    int    plane;
+    size_t firstRow;
+    size_t numRows;
+};
+
+//------------------------------------------------------------------------------
+
+inline bool
+ColorUndistorter::canUndistort (const Image& image)
+{
+    return (ImageFormat_RGB == image.format || ImageFormat_YCbCr == image.format)
+        && !image.isEmpty()
+        && image.cameraInfo.calibration.isValid()
+        && 0 < image.cameraInfo.calibration.fy
+        ;
+}
+
+inline uplink_ref<const UndistortionMaps>
+ColorUndistorter::maps (const CameraCalibration& calibration, ImageFormat format, size_t width, size_t height)
+{
+    const MutexLocker _(mutex);
+
+    for (std::list<uplink_ref<const UndistortionMaps> >::iterator i = cache.begin(); i != cache.end(); ++i)
+    {
+        if (!(*i)->matches(calibration, format, width, height))
+            continue;
+
+        cache.splice(cache.begin(), cache, i);
+
+        return cache.front();
+    }
+
+    // Building happens under the lock, so that concurrent callers never build the same maps twice.
+    cache.push_front(uplink_ref<const UndistortionMaps>(new UndistortionMaps(calibration, format, width, height)));
+
+    if (CacheSize < cache.size())
+        cache.pop_back();
+
+    return cache.front();
+}
+
+inline bool
+ColorUndistorter::undistort (const Image& source, Image& target)
+{
+    return undistort(source, target, false);
+}
+
+inline bool
+ColorUndistorter::undistortInParallel (const Image& source, Image& target)
+{
+    return undistort(source, target, true);
+}
+
+inline bool
+ColorUndistorter::undistort (const Image& source, Image& target, bool parallel)
+{
+    report_false_unless("Undistortion requires calibrated RGB or YCbCr images.", canUndistort(source));
+
+    const uplink_ref<const UndistortionMaps> maps = this->maps(source.cameraInfo.calibration, source.format, source.width, source.height);
+
+    const uint8* sourceRows        [Image::MaxNumPlanes];
+    size_t       sourceBytesPerRow [Image::MaxNumPlanes];
+    size_t       targetOffsets     [Image::MaxNumPlanes];
+    size_t       targetSize = 0;
+
+    for (int p = 0; p < maps->numPlanes; ++p)
+    {
+        const Image::Plane&      plane = source.planes[p];
+        const UndistortionRemap& remap = maps->remaps[p];
+
+        const size_t bytesPerRow = remap.width * maps->numChannels[p];
+
+        sourceRows[p]        = (const uint8*) plane.buffer;
+        sourceBytesPerRow[p] = 0 != plane.bytesPerRow ? plane.bytesPerRow : bytesPerRow;
+
+        report_false_unless("Invalid undistortion source image plane.",
+               0 != sourceRows[p]
+            && bytesPerRow <= sourceBytesPerRow[p]
+            && (remap.height - 1) * sourceBytesPerRow[p] + bytesPerRow <= plane.sizeInBytes
+        );
+
+        targetOffsets[p] = targetSize;
+        targetSize      += remap.height * bytesPerRow;
+    }
+
+    uint8* targetBuffer = new uint8[targetSize];
+
+    std::vector<UndistortionStrip> strips;
+
+    for (int p = 0; p < maps->numPlanes; ++p)
+    {
+        const size_t numRows = parallel ? size_t(StripHeight) : maps->remaps[p].height;
+
+        for (size_t row = 0; row < maps->remaps[p].height; row += numRows)
+        {
+            UndistortionStrip strip;
+            strip.plane    = p;
+            strip.firstRow = row;
+            strip.numRows  = std::min(numRows, maps->remaps[p].height - row);
+
+            strips.push_back(strip);
+        }
+    }
+
+    const auto remapStrip = [&] (int n)
+    {
+        const UndistortionStrip& strip = strips[n];
+
+        const UndistortionRemap& remap = maps->remaps[strip.plane];
+
+        undistortion_remap_rows(
+            remap,
+            maps->numChannels[strip.plane],
+            sourceRows[strip.plane],
+            sourceBytesPerRow[strip.plane],
+            targetBuffer + targetOffsets[strip.plane],
+            remap.width * maps->numChannels[strip.plane],
+            strip.firstRow,
+            strip.numRows,
+            maps->border[strip.plane]
+        );
+    };
+
+    if (parallel)
+    {
+        context.tasks().parallelFor(int(strips.size()), remapStrip);
+    }
+    else
+    {
+        for (size_t n = 0; n < strips.size(); ++n)
+            remapStrip(int(n));
+    }
+
+    target.clear();
+
+    target.width  = source.width;
+    target.height = source.height;
+    target.format = source.format;
+
+    for (int p = 0; p < maps->numPlanes; ++p)
+    {
+        const UndistortionRemap& remap = maps->remaps[p];
+
+        target.planes[p].buffer      = targetBuffer + targetOffsets[p];
+        target.planes[p].bytesPerRow = remap.width * maps->numChannels[p];
+        target.planes[p].sizeInBytes = remap.height * target.planes[p].bytesPerRow;
+    }
+
+    target.cameraInfo = source.cameraInfo;
+    target.cameraInfo.calibration.k1 = 0.f;
+    target.cameraInfo.calibration.k2 = 0.f;
+    target.cameraInfo.calibration.k3 = 0.f;
+    target.cameraInfo.calibration.p1 = 0.f;
+    target.cameraInfo.calibration.p2 = 0.f;
+
+    target.release = [targetBuffer] () { delete [] targetBuffer; };
+    target.retain  = std::function<void ()>();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+}
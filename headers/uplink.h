@@ -23,17 +23,26 @@
 //------------------------------------------------------------------------------
 
 # include "./context.h"
+# include "./core/tracing.h"
+# include "./core/impairments.h"
+# include "./metrics.h"
 # include "./clients.h"
+# include "./clock-sync.h"
 # include "./image.h"
 # include "./image-codecs.h"
+# include "./image-pyramids.h"
 # include "./camera-calibration.h"
 # include "./camera-fixedparams.h"
 # include "./camera-pose.h"
 # include "./camera-frame.h"
+# include "./depth-registration.h"
+# include "./depth-filters.h"
 # include "./endpoints.h"
 # include "./discovery.h"
 # include "./messages.h"
 # include "./motion.h"
+# include "./point-clouds.h"
+# include "./recordings.h"
 # include "./servers.h"
 # include "./desktop-server.h"
 # include "./services.h"
@@ -41,6 +50,7 @@
 # include "./sessions-setup.h"
 # include "./sessions-setup-presets.h"
 # include "./shift-depth-converter.h"
+# include "./undistortion.h"
 
 //------------------------------------------------------------------------------
 
@@ -0,0 +1,1044 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+// Codec and transport benchmarks, reporting JSON, so that releases and engines can be compared.
+// Inputs are synthetic and deterministic, and every benchmark reports the median of several timed repetitions.
+
+#include <uplink.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace uplink;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+struct Options
+{
+    Options ()
+    : filter(0)
+    , output(0)
+    , repetitions(5)
+    , minTime(.2)
+    , list(false)
+    , receivePipelineDepth(0)
+    {
+        impairment.parse(defaultImpairment);
+    }
+
+    static CString const defaultImpairment;
+
+    CString           filter;      // Substring of the benchmark names to run.
+    CString           output;      // JSON file. Standard output by default.
+    int               repetitions;
+    double            minTime;     // Seconds per repetition.
+    bool              list;
+    NetworkImpairment impairment;  // Of the impaired wire benchmarks.
+    int               receivePipelineDepth; // Of the wire benchmark receivers.
+};
+
+// A congested wireless link, fixed so that the impaired wire benchmarks compare from one run to the next.
+CString const Options::defaultImpairment = "bandwidth=100,latency=10,jitter=4,stall-every=500,stall-for=25,seed=1";
+
+
+void
+printUsage ()
+{
+    fprintf(stderr,
+        "Usage: uplink-bench [options]\n"
+        "\n"
+        "  --filter TEXT       Runs the benchmarks whose names contain the text.\n"
+        "  --repetitions N     Timed repetitions per benchmark (default: 5).\n"
+        "  --min-time S        Minimum seconds per repetition (default: 0.2).\n"
+        "  --output PATH       Writes the JSON report to a file, instead of the standard output.\n"
+        "  --list              Lists the benchmark names.\n"
+        "  --impairment SPEC   Network conditions of the wire/impaired benchmarks (default: %s).\n"
+        "                      See NetworkImpairment, in headers/core/impairments.h.\n"
+        "  --receive-pipeline-depth N\n"
+        "                      Receives the wire benchmark messages through a pipeline that deep (default: 0, none).\n",
+        Options::defaultImpairment
+    );
+}
+
+bool
+parseOptions (int argc, char* argv [], Options& options)
+{
+    for (int n = 1; n < argc; ++n)
+    {
+        const String option = argv[n];
+
+        if ("--list" == option)
+        {
+            options.list = true;
+
+            continue;
+        }
+
+        return_false_if(argc <= n + 1);
+
+        CString const value = argv[++n];
+
+        if      ("--filter"      == option) options.filter      = value;
+        else if ("--output"      == option) options.output      = value;
+        else if ("--repetitions" == option) options.repetitions = atoi(value);
+        else if ("--min-time"    == option) options.minTime     = atof(value);
+        else if ("--impairment"  == option) { return_false_unless(options.impairment.parse(value)); }
+        else if ("--receive-pipeline-depth" == option) options.receivePipelineDepth = atoi(value);
+        else
+            return false;
+    }
+
+    return 0 < options.repetitions && 0. < options.minTime && 0 <= options.receivePipelineDepth;
+}
+
+//------------------------------------------------------------------------------
+
+struct Result
+{
+    String name;
+    uint64 iterations;     // Per repetition.
+    double medianSeconds;  // Per iteration.
+    double minSeconds;
+    double maxSeconds;
+    double bytes;          // Per iteration, zero when irrelevant.
+    double ratio;          // Compression ratio, zero when irrelevant.
+};
+
+class Bench
+{
+public:
+    Bench (const Options& options) : options(options), failed(false) {}
+
+public:
+    bool selects (CString name) const
+    {
+        return 0 == options.filter || 0 != strstr(name, options.filter);
+    }
+
+    // When listing, prints the name of a selected benchmark, which is not to run, nor to be set up.
+    bool lists (CString name) const
+    {
+        return_false_unless(options.list && selects(name));
+
+        printf("%s\n", name);
+
+        return true;
+    }
+
+    // Checks the results of the benchmarked code once, before timing it. Failed checks fail the whole run.
+    template < typename Check >
+    bool checks (CString what, const Check& check)
+    {
+        return_true_if(options.list); // Nothing runs.
+
+        return_true_if(check());
+
+        fprintf(stderr, "%s: round trip check failed.\n", what);
+
+        failed = true;
+
+        return false;
+    }
+
+    bool hasFailed () const { return failed; }
+
+    // Times the calls, doubling their number until a repetition takes long enough.
+    template < typename Call >
+    void run (CString name, double bytes, double ratio, const Call& call)
+    {
+        return_if(!selects(name) || lists(name));
+
+        uint64 iterations = 1;
+
+        for (;;)
+        {
+            const double start = getTime();
+
+            for (uint64 n = 0; n < iterations; ++n)
+                call();
+
+            if (options.minTime <= getTime() - start)
+                break;
+
+            iterations *= 2;
+        }
+
+        // Timed repetitions, calibration having warmed up caches and allocators.
+        std::vector<double> seconds(options.repetitions);
+
+        for (int r = 0; r < options.repetitions; ++r)
+        {
+            const double start = getTime();
+
+            for (uint64 n = 0; n < iterations; ++n)
+                call();
+
+            seconds[r] = (getTime() - start) / double(iterations);
+        }
+
+        record(name, iterations, seconds, bytes, ratio);
+    }
+
+    // For benchmarks timing themselves, one repetition per call.
+    template < typename Repetition >
+    void runTimed (CString name, double bytes, const Repetition& repetition)
+    {
+        return_if(!selects(name) || lists(name));
+
+        uint64 iterations = 0;
+
+        repetition(iterations); // Warm-up.
+
+        std::vector<double> seconds(options.repetitions);
+
+        for (int r = 0; r < options.repetitions; ++r)
+            seconds[r] = repetition(iterations) / double(iterations);
+
+        record(name, iterations, seconds, bytes, 0.);
+    }
+
+    String json () const;
+
+private:
+    void record (CString name, uint64 iterations, std::vector<double>& seconds, double bytes, double ratio)
+    {
+        std::sort(seconds.begin(), seconds.end());
+
+        Result result;
+
+        result.name          = name;
+        result.iterations    = iterations;
+        result.medianSeconds = seconds[seconds.size() / 2];
+        result.minSeconds    = seconds.front();
+        result.maxSeconds    = seconds.back();
+        result.bytes         = bytes;
+        result.ratio         = ratio;
+
+        results.push_back(result);
+
+        fprintf(stderr, "%-48s %12.1f ns", name, 1e9 * result.medianSeconds);
+
+        if (0. < bytes)
+            fprintf(stderr, " %10.1f MB/s", 1e-6 * bytes / result.medianSeconds);
+
+        if (0. < ratio)
+            fprintf(stderr, " %8.2f:1", ratio);
+
+        fprintf(stderr, "\n");
+    }
+
+private:
+    const Options&      options;
+    std::vector<Result> results;
+    bool                failed;
+};
+
+String
+Bench::json () const
+{
+    String json = "{\n";
+
+    json += formatted_copy("  \"uplink_version\": \"%d.%d\",\n", UPLINK_CLIENT_VERSION_MAJOR, UPLINK_CLIENT_VERSION_MINOR);
+
+# if defined(__clang__)
+    json += formatted_copy("  \"compiler\": \"clang %d.%d\",\n", __clang_major__, __clang_minor__);
+# elif defined(__GNUC__)
+    json += formatted_copy("  \"compiler\": \"gcc %d.%d\",\n", __GNUC__, __GNUC_MINOR__);
+# elif defined(_MSC_VER)
+    json += formatted_copy("  \"compiler\": \"msvc %d\",\n", _MSC_VER);
+# endif
+
+    json += formatted_copy("  \"repetitions\": %d,\n", options.repetitions);
+    json += formatted_copy("  \"min_time_s\": %g,\n", options.minTime);
+    json += formatted_copy("  \"impairment\": \"%s\",\n", options.impairment.toString().c_str());
+    json += formatted_copy("  \"receive_pipeline_depth\": %d,\n", options.receivePipelineDepth);
+    json += "  \"benchmarks\": [\n";
+
+    for (size_t n = 0; n < results.size(); ++n)
+    {
+        const Result& result = results[n];
+
+        json += formatted_copy("    { \"name\": \"%s\", \"iterations\": %llu, \"median_ns\": %.1f, \"min_ns\": %.1f, \"max_ns\": %.1f",
+            result.name.c_str(),
+            (unsigned long long) result.iterations,
+            1e9 * result.medianSeconds,
+            1e9 * result.minSeconds,
+            1e9 * result.maxSeconds
+        );
+
+        if (0. < result.bytes)
+            json += formatted_copy(", \"bytes\": %.0f, \"mb_per_s\": %.2f", result.bytes, 1e-6 * result.bytes / result.medianSeconds);
+
+        if (0. < result.ratio)
+            json += formatted_copy(", \"compression_ratio\": %.3f", result.ratio);
+
+        json += n + 1 < results.size() ? " },\n" : " }\n";
+    }
+
+    json += "  ]\n}\n";
+
+    return json;
+}
+
+//------------------------------------------------------------------------------
+
+// Deterministic inputs.
+
+struct Random
+{
+    Random () : state(0x2545F491) {}
+
+    uint32 next ()
+    {
+        state = state * 1664525u + 1013904223u;
+
+        return state >> 8;
+    }
+
+    uint32 state;
+};
+
+// A tilted wall, with a sphere in front of it, and sparse holes: shifts as captured by the depth sensor.
+void
+makeShifts (std::vector<uint16>& shifts, int width, int height)
+{
+    Random random;
+
+    shifts.resize(width * height);
+
+    for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width ; ++x)
+    {
+        const double u = double(x) / width  - .5;
+        const double v = double(y) / height - .5;
+
+        const double distance = std::sqrt(u * u + v * v);
+
+        double shift = 600. + 200. * u + 50. * v;
+
+        if (distance < .2)
+            shift += 150. * std::sqrt(1. - (distance / .2) * (distance / .2));
+
+        shift += double(random.next() % 3) - 1.; // Sensor noise.
+
+        shifts[y * width + x] = 0 == random.next() % 64 ? uint16(0) : uint16(shift);
+    }
+}
+
+void
+makeColors (std::vector<uint8>& pixels, int width, int height)
+{
+    Random random;
+
+    pixels.resize(3 * width * height);
+
+    for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width ; ++x)
+    {
+        uint8* const pixel = &pixels[3 * (y * width + x)];
+
+        pixel[0] = uint8(255 * x / width);
+        pixel[1] = uint8(255 * y / height);
+        pixel[2] = uint8(128 + 64 * std::sin(20. * x / width) + random.next() % 4);
+    }
+}
+
+void
+wrapImage (Image& image, ImageFormat format, void* buffer, size_t sizeInBytes, int width, int height, size_t bytesPerRow)
+{
+    image.format                = format;
+    image.width                 = width;
+    image.height                = height;
+    image.planes[0].buffer      = buffer;
+    image.planes[0].sizeInBytes = sizeInBytes;
+    image.planes[0].bytesPerRow = bytesPerRow;
+    image.release               = [] () {}; // Owned by the benchmark.
+    image.retain                = [] () {};
+}
+
+//------------------------------------------------------------------------------
+
+enum { Width = 640, Height = 480, NumShifts = Width * Height };
+
+void
+benchShiftCoding (Bench& bench)
+{
+    std::vector<uint16> shifts;
+
+    makeShifts(shifts, Width, Height);
+
+    std::vector<uint16> decoded(NumShifts);
+    std::vector<uint8>  encoded(std::max(size_t(2 * NumShifts), rans_max_encoded_size(NumShifts)));
+
+    const double rawBytes = double(2 * NumShifts);
+
+    {
+        const uint32 size = encode(shifts.data(), NumShifts, encoded.data(), uint32(encoded.size()));
+
+        const bool roundTrips = bench.checks("shift_coding/occ", [&] () -> bool
+        {
+            return 0 != decode(encoded.data(), size, NumShifts, decoded.data()) && decoded == shifts;
+        });
+
+        if (roundTrips)
+        {
+            bench.run("shift_coding/occ/encode", rawBytes, rawBytes / size, [&] () { encode(shifts.data(), NumShifts, encoded.data(), uint32(encoded.size())); });
+            bench.run("shift_coding/occ/decode", rawBytes, rawBytes / size, [&] () { decode(encoded.data(), size, NumShifts, decoded.data()); });
+        }
+    }
+
+    {
+        static const int maxError = 2;
+
+        const uint32 size = encode_near_lossless(shifts.data(), NumShifts, encoded.data(), uint32(encoded.size()), maxError);
+
+        const bool roundTrips = bench.checks("shift_coding/near_lossless", [&] () -> bool
+        {
+            return_false_unless(0 != size && decode_near_lossless(encoded.data(), size, NumShifts, decoded.data(), maxError));
+
+            for (int n = 0; n < NumShifts; ++n)
+                return_false_if(maxError < std::abs(int(decoded[n]) - int(shifts[n])));
+
+            return true;
+        });
+
+        if (roundTrips)
+        {
+            bench.run("shift_coding/near_lossless/encode", rawBytes, rawBytes / size, [&] () { encode_near_lossless(shifts.data(), NumShifts, encoded.data(), uint32(encoded.size()), maxError); });
+            bench.run("shift_coding/near_lossless/decode", rawBytes, rawBytes / size, [&] () { decode_near_lossless(encoded.data(), size, NumShifts, decoded.data(), maxError); });
+        }
+    }
+
+    {
+        const uint32 size = encode_rans(shifts.data(), NumShifts, encoded.data(), uint32(encoded.size()));
+
+        const bool roundTrips = bench.checks("shift_coding/rans", [&] () -> bool
+        {
+            return 0 != size && decode_rans(encoded.data(), size, NumShifts, decoded.data()) && decoded == shifts;
+        });
+
+        if (roundTrips)
+        {
+            bench.run("shift_coding/rans/encode", rawBytes, rawBytes / size, [&] () { encode_rans(shifts.data(), NumShifts, encoded.data(), uint32(encoded.size())); });
+            bench.run("shift_coding/rans/decode", rawBytes, rawBytes / size, [&] () { decode_rans(encoded.data(), size, NumShifts, decoded.data()); });
+        }
+    }
+}
+
+void
+benchColorCoding (Bench& bench)
+{
+    std::vector<uint8> pixels;
+
+    makeColors(pixels, Width, Height);
+
+    Image source;
+
+    wrapImage(source, ImageFormat_RGB, pixels.data(), pixels.size(), Width, Height, 3 * Width);
+
+    Image compressed;
+
+    if (!compress_image_Color_LosslessColor(source, compressed))
+        return;
+
+    return_unless(bench.checks("color_coding/lossless", [&] () -> bool
+    {
+        Image decompressed;
+
+        return_false_unless(decompress_image_LosslessColor_Color(compressed, decompressed));
+        return_false_unless(ImageFormat_RGB == decompressed.format && Width == int(decompressed.width) && Height == int(decompressed.height));
+
+        const Image::Plane& plane = decompressed.planes[0];
+
+        const size_t bytesPerRow = 0 != plane.bytesPerRow ? plane.bytesPerRow : size_t(3 * Width);
+
+        for (int y = 0; y < Height; ++y)
+            return_false_if(0 != memcmp((const uint8*) plane.buffer + y * bytesPerRow, &pixels[3 * y * Width], 3 * Width));
+
+        return true;
+    }));
+
+    const double rawBytes = double(pixels.size());
+    const double ratio    = rawBytes / double(compressed.planes[0].sizeInBytes);
+
+    bench.run("color_coding/lossless/compress", rawBytes, ratio, [&] ()
+    {
+        Image target;
+
+        compress_image_Color_LosslessColor(source, target);
+    });
+
+    bench.run("color_coding/lossless/decompress", rawBytes, ratio, [&] ()
+    {
+        Image target;
+
+        decompress_image_LosslessColor_Color(compressed, target);
+    });
+}
+
+void
+benchBitstream (Bench& bench)
+{
+    enum { NumBytes = 1 << 16 };
+
+    std::vector<uint8> bytes(NumBytes + 1);
+
+    bench.run("bitstream/put_8_bits", NumBytes, 0., [&] ()
+    {
+        bitstream_t bitstream;
+        bs_init(&bitstream);
+        bs_attach(&bitstream, bytes.data(), int(bytes.size()));
+
+        for (int n = 0; n < NumBytes; ++n)
+            bs_put(&bitstream, uint8(n), 8);
+
+        bs_flush(&bitstream);
+    });
+
+    bench.run("bitstream/put_3_bits", NumBytes, 0., [&] ()
+    {
+        bitstream_t bitstream;
+        bs_init(&bitstream);
+        bs_attach(&bitstream, bytes.data(), int(bytes.size()));
+
+        for (int n = 0; n < NumBytes * 8 / 3; ++n)
+            bs_put(&bitstream, uint8(n & 7), 3);
+
+        bs_flush(&bitstream);
+    });
+
+    volatile uint8 sink = 0; // Keeps the reads alive.
+
+    bench.run("bitstream/get_8_bits", NumBytes, 0., [&] ()
+    {
+        bitstream_t bitstream;
+        bs_init(&bitstream);
+        bs_attach(&bitstream, bytes.data(), int(bytes.size()));
+
+        uint8 sum = 0;
+
+        for (int n = 0; n < NumBytes; ++n)
+            sum += bs_get(&bitstream, 8);
+
+        sink = sum;
+    });
+
+    bench.run("bitstream/get_3_bits", NumBytes, 0., [&] ()
+    {
+        bitstream_t bitstream;
+        bs_init(&bitstream);
+        bs_attach(&bitstream, bytes.data(), int(bytes.size()));
+
+        uint8 sum = 0;
+
+        for (int n = 0; n < NumBytes * 8 / 3; ++n)
+            sum += bs_get(&bitstream, 3);
+
+        sink = sum;
+    });
+}
+
+void
+benchShiftToDepth (Bench& bench)
+{
+    std::vector<uint16> shifts;
+
+    makeShifts(shifts, Width, Height);
+
+    std::vector<uint16> depths(NumShifts);
+
+    volatile uint16 sink = 0;
+
+    bench.run("shift2depth/scalar", 2. * NumShifts, 0., [&] ()
+    {
+        uint16 sum = 0;
+
+        for (int n = 0; n < NumShifts; ++n)
+            sum += shift2depth(shifts[n]);
+
+        sink = sum;
+    });
+
+    bench.run("shift2depth/buffer", 2. * NumShifts, 0., [&] ()
+    {
+        std::copy(shifts.begin(), shifts.end(), depths.begin());
+
+        shift2depth(depths.data(), depths.size());
+    });
+}
+
+void
+benchDepthFilters (Bench& bench)
+{
+    static const int   radius = 2;
+    static const float sigma  = .02f;
+
+    // Near and far depths, alternating as a checkerboard, that an edge-preserving filter must leave untouched.
+    const bool preservesEdges = bench.checks("depth_filters/bilateral", [&] () -> bool
+    {
+        enum { Size = 16 };
+
+        std::vector<uint16> depths(Size * Size);
+
+        for (int y = 0; y < Size; ++y)
+        for (int x = 0; x < Size; ++x)
+            depths[y * Size + x] = 0 == (x + y) % 2 ? 2 : 60000;
+
+        const std::vector<uint16> original = depths;
+
+        Image image;
+
+        wrapImage(image, ImageFormat_DepthMillimeters, depths.data(), 2 * depths.size(), Size, Size, 2 * Size);
+
+        return filter_depth_bilateral(image, radius, sigma) && depths == original;
+    });
+
+    return_unless(preservesEdges);
+
+    std::vector<uint16> shifts;
+
+    makeShifts(shifts, Width, Height);
+
+    std::vector<uint16> filtered(NumShifts);
+
+    bench.run("depth_filters/bilateral", 2. * NumShifts, 0., [&] ()
+    {
+        std::copy(shifts.begin(), shifts.end(), filtered.begin());
+
+        Image image;
+
+        wrapImage(image, ImageFormat_Shifts, filtered.data(), 2 * filtered.size(), Width, Height, 2 * Width);
+
+        filter_depth_bilateral(image, radius, sigma);
+    });
+}
+
+//------------------------------------------------------------------------------
+
+void
+benchQueues (Bench& bench)
+{
+    bench.run("queue/push_pop/uncontended", 0., 0., [&] ()
+    {
+        static Queue<GyroscopeEvent> queue;
+
+        GyroscopeEvent event (0., RotationRate()); // Fully set, as popping swaps every member.
+        event.sessionId = InvalidSessionId;
+
+        queue.pushByCopy(event);
+        queue.popBySwap(event);
+    });
+
+    // Producers push copies, while one consumer pops them all.
+    struct Producer : Thread
+    {
+        Producer (Queue<GyroscopeEvent>& queue, int count) : Thread("uplink-bench::Producer"), queue(queue), count(count) {}
+        ~Producer () { join(); }
+
+        virtual void run ()
+        {
+            GyroscopeEvent event (0., RotationRate());
+
+            for (int n = 0; n < count; ++n)
+                queue.pushByCopy(event);
+        }
+
+        Queue<GyroscopeEvent>& queue;
+        const int              count;
+    };
+
+    static const int numProducers        = 4;
+    static const int numItemsPerProducer = 50000;
+
+    bench.runTimed("queue/push_pop/contended_4_producers", 0., [&] (uint64& iterations) -> double
+    {
+        iterations = numProducers * numItemsPerProducer;
+
+        Queue<GyroscopeEvent> queue;
+
+        const double start = getTime();
+
+        std::vector<Producer*> producers;
+
+        for (int n = 0; n < numProducers; ++n)
+        {
+            producers.push_back(new Producer(queue, numItemsPerProducer));
+            producers.back()->start();
+        }
+
+        GyroscopeEvent event (0., RotationRate());
+        event.sessionId = InvalidSessionId;
+
+        for (uint64 popped = 0; popped < iterations;)
+            if (queue.popBySwap(event))
+                ++popped;
+
+        const double seconds = getTime() - start;
+
+        for (int n = 0; n < numProducers; ++n)
+            delete producers[n];
+
+        return seconds;
+    });
+}
+
+//------------------------------------------------------------------------------
+
+void
+registerAllMessages (MessageSerializer& serializer)
+{
+    serializer.setMagic("skan");
+
+# define UPLINK_MESSAGE(Name, name) \
+    serializer.registerMessage(new Name());
+         UPLINK_MESSAGES()
+# undef  UPLINK_MESSAGE
+}
+
+void
+benchMessageSerializer (Bench& bench, CString name, const Message& message)
+{
+    MessageSerializer serializer;
+
+    registerAllMessages(serializer);
+
+    Buffer buffer;
+
+    {
+        BufferOutputStream output(buffer);
+
+        if (!serializer.writeMessage(output, message))
+            return;
+    }
+
+    const double bytes = double(buffer.size());
+
+    bench.run(formatted_copy("message_serializer/write/%s", name).c_str(), bytes, 0., [&] ()
+    {
+        buffer.clear();
+
+        BufferOutputStream output(buffer);
+
+        serializer.writeMessage(output, message);
+    });
+
+    bench.run(formatted_copy("message_serializer/read/%s", name).c_str(), bytes, 0., [&] ()
+    {
+        BufferInputStream input(buffer);
+
+        serializer.readMessage(input);
+    });
+}
+
+void
+benchMessageSerializers (Bench& bench)
+{
+    GyroscopeEvent gyroscopeEvent;
+
+    gyroscopeEvent.sessionId = FirstSessionId;
+    gyroscopeEvent.timestamp = 1.;
+
+    benchMessageSerializer(bench, "gyroscope_event", gyroscopeEvent);
+
+    Blob blob;
+
+    blob.sessionId = FirstSessionId;
+    blob.data.resize(1 << 20, 0x5a);
+
+    benchMessageSerializer(bench, "blob_1mb", blob);
+
+    std::vector<uint16> shifts;
+    std::vector<uint8>  pixels;
+
+    makeShifts(shifts, Width, Height);
+    makeColors(pixels, Width, Height);
+
+    CameraFrame cameraFrame;
+
+    cameraFrame.sessionId = FirstSessionId;
+
+    wrapImage(cameraFrame.depthImage, ImageFormat_Shifts, shifts.data(), 2 * shifts.size(), Width, Height, 2 * Width);
+    wrapImage(cameraFrame.colorImage, ImageFormat_RGB   , pixels.data(),     pixels.size(), Width, Height, 3 * Width);
+
+    benchMessageSerializer(bench, "camera_frame_vga_raw", cameraFrame);
+}
+
+//------------------------------------------------------------------------------
+
+// Loopback wires: one endpoint sends blobs, as fast as its queue takes them, and the other one counts their arrival.
+
+struct LoopbackEndpoint : Endpoint
+{
+    LoopbackEndpoint ()
+    : numReceived(0)
+    {
+        currentSessionId = FirstSessionId;
+
+        blobQueue.setMaximumSize(0); // The sender waits on the queue size instead.
+    }
+
+    ~LoopbackEndpoint ()
+    {
+        if (0 != wire)
+            wire->stop();
+    }
+
+    virtual void disconnected () {}
+    virtual void onVersionInfo (const VersionInfo&) {}
+    virtual void onSessionSetup (const SessionSetup&) {}
+    virtual void onSessionSetupReply (const SessionSetupReply&) {}
+
+    virtual bool onMessage (const Message& message)
+    {
+        if (MessageKind_Blob == message.kind())
+        {
+            const MutexLocker _(mutex);
+
+            ++numReceived;
+
+            received.signal();
+        }
+
+        return true;
+    }
+
+    void waitForReceived (uint64 count)
+    {
+        const MutexLocker _(mutex);
+
+        while (numReceived < count)
+            received.waitLocked(&mutex);
+    }
+
+    Mutex     mutex;
+    Condition received;
+    uint64    numReceived;
+};
+
+void
+benchWire (Bench& bench, const Options& options, CString name, DuplexStream* senderStream, DuplexStream* receiverStream, size_t blobSize, double bytesPerRepetition = 64 << 20)
+{
+    if (0 == senderStream || 0 == receiverStream)
+    {
+        zero_delete(senderStream);
+        zero_delete(receiverStream);
+
+        return;
+    }
+
+    LoopbackEndpoint sender;
+    LoopbackEndpoint receiver;
+
+    receiver.receivePipelineDepth = options.receivePipelineDepth;
+
+    (new Wire(senderStream  , &sender  ))->start();
+    (new Wire(receiverStream, &receiver))->start();
+
+    static const int maxNumQueuedBlobs = 8;
+
+    const int numBlobs = std::max(16, int(bytesPerRepetition / blobSize));
+
+    bench.runTimed(name, double(blobSize), [&] (uint64& iterations) -> double
+    {
+        iterations = numBlobs;
+
+        const uint64 target = receiver.numReceived + numBlobs;
+
+        const double start = getTime();
+
+        for (int n = 0; n < numBlobs; ++n)
+        {
+            while (maxNumQueuedBlobs <= sender.blobQueue.getSize())
+                Thread::sleep(.0001f);
+
+            Blob blob;
+
+            blob.data.resize(blobSize);
+
+            sender.sendBlob(blob);
+        }
+
+        receiver.waitForReceived(target);
+
+        return getTime() - start;
+    });
+}
+
+# if _WIN32
+typedef SOCKET Descriptor;
+# else
+typedef int    Descriptor;
+# endif
+
+void
+closeDescriptor (Descriptor descriptor)
+{
+# if _WIN32
+    closesocket(descriptor);
+# else
+    close(descriptor);
+# endif
+}
+
+// Connects to an ephemeral port on the loopback interface.
+bool
+connectLoopback (TCPConnection*& clientStream, TCPConnection*& serverStream)
+{
+    const Descriptor listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = 0;
+
+    socklen_t addressSize = sizeof(address);
+
+    if (0 != ::bind(listener, (sockaddr*) &address, sizeof(address))
+     || 0 != ::listen(listener, 1)
+     || 0 != ::getsockname(listener, (sockaddr*) &address, &addressSize))
+    {
+        closeDescriptor(listener);
+
+        return false;
+    }
+
+    clientStream = TCPConnection::connect("127.0.0.1", ntohs(address.sin_port));
+
+    const Descriptor accepted = ::accept(listener, 0, 0);
+
+    closeDescriptor(listener);
+
+    report_false_unless("Cannot connect over the loopback interface.", 0 != clientStream);
+
+    serverStream = TCPConnection::create(int(accepted));
+
+    return 0 != serverStream;
+}
+
+void
+benchWires (Bench& bench, const Options& options)
+{
+    static const size_t blobSizes [] = { 1 << 10, 64 << 10, 1 << 20 };
+    static CString const blobNames [] = { "1kb", "64kb", "1mb" };
+
+    for (int n = 0; n < int(sizeof_array(blobSizes)); ++n)
+    {
+        const String name = formatted_copy("wire/tcp_loopback/blob_%s", blobNames[n]);
+
+        if (!bench.selects(name.c_str()) || bench.lists(name.c_str()))
+            continue;
+
+        TCPConnection* clientStream = 0;
+        TCPConnection* serverStream = 0;
+
+        if (!connectLoopback(clientStream, serverStream))
+            continue;
+
+        benchWire(bench, options, name.c_str(), clientStream, serverStream, blobSizes[n]);
+    }
+
+# if !_WIN32
+    for (int n = 0; n < int(sizeof_array(blobSizes)); ++n)
+    {
+        const String name = formatted_copy("wire/socketpair/blob_%s", blobNames[n]);
+
+        if (!bench.selects(name.c_str()) || bench.lists(name.c_str()))
+            continue;
+
+        int descriptors [2];
+
+        if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors))
+            continue;
+
+        benchWire(bench, options, name.c_str(), TCPConnection::create(descriptors[0]), TCPConnection::create(descriptors[1]), blobSizes[n]);
+    }
+# endif
+
+    // Both directions impaired, as over a real link. Capped links only move so many bytes per repetition.
+    const double impairedBytesPerRepetition = 0. < options.impairment.bytesPerSecond ? options.impairment.bytesPerSecond * options.minTime : double(64 << 20);
+
+    for (int n = 0; n < int(sizeof_array(blobSizes)); ++n)
+    {
+        const String name = formatted_copy("wire/impaired/blob_%s", blobNames[n]);
+
+        if (!bench.selects(name.c_str()) || bench.lists(name.c_str()))
+            continue;
+
+        TCPConnection* clientStream = 0;
+        TCPConnection* serverStream = 0;
+
+        if (!connectLoopback(clientStream, serverStream))
+            continue;
+
+        benchWire(bench, options, name.c_str(),
+            new ImpairedConnection(clientStream, options.impairment),
+            new ImpairedConnection(serverStream, options.impairment),
+            blobSizes[n],
+            impairedBytesPerRepetition
+        );
+    }
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+int
+main (int argc, char* argv [])
+{
+    Options options;
+
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+
+        return 1;
+    }
+
+    Bench bench(options);
+
+    benchShiftCoding(bench);
+    benchColorCoding(bench);
+    benchBitstream(bench);
+    benchShiftToDepth(bench);
+    benchDepthFilters(bench);
+    benchQueues(bench);
+    benchMessageSerializers(bench);
+    benchWires(bench, options);
+
+    if (options.list)
+        return 0;
+
+    if (bench.hasFailed())
+        return 1;
+
+    const String json = bench.json();
+
+    if (0 == options.output)
+    {
+        fputs(json.c_str(), stdout);
+
+        return 0;
+    }
+
+    FILE* const file = fopen(options.output, "wb");
+
+    if (0 == file)
+    {
+        fprintf(stderr, "Cannot write %s.\n", options.output);
+
+        return 1;
+    }
+
+    fputs(json.c_str(), file);
+    fclose(file);
+
+    return 0;
+}
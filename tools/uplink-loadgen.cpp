@@ -0,0 +1,844 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+// Headless load generator, standing in for capture devices.
+// Opens concurrent sessions against a server, answers its session setups like the capture app does,
+// streams synthetic or pre-recorded camera frames and motion events, and reports what the server sustained.
+
+#include <uplink.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace uplink;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+struct Options
+{
+    Options ()
+    : host(0)
+    , port(6666)
+    , numSessions(1)
+    , duration(10.)
+    , reportInterval(1.)
+    , frameRate(0.)
+    , motionRate(-1.)
+    , colorCodec(ImageCodecId_Invalid)
+    , depthCodec(ImageCodecId_Invalid)
+    , overrideColorCodec(false)
+    , overrideDepthCodec(false)
+    , recording(0)
+    , metricsPort(0)
+    , receivePipelineDepth(0)
+    {
+    }
+
+    CString           host;
+    uint16            port;
+    int               numSessions;
+    double            duration;       // Seconds. Zero runs until all sessions are disconnected.
+    double            reportInterval; // Seconds.
+    double            frameRate;      // Zero follows the session depth mode.
+    double            motionRate;     // Negative follows the session settings.
+    ImageCodecId      colorCodec;     // ImageCodecId_Invalid stands for uncompressed images.
+    ImageCodecId      depthCodec;
+    bool              overrideColorCodec;
+    bool              overrideDepthCodec;
+    CString           recording;
+    uint16            metricsPort;
+    NetworkImpairment impairment; // Of the sent bytes.
+    int               receivePipelineDepth;
+};
+
+void
+printUsage ()
+{
+    fprintf(stderr,
+        "Usage: uplink-loadgen [options] host\n"
+        "\n"
+        "  --port N             Server port (default: 6666).\n"
+        "  --sessions N         Concurrent sessions (default: 1).\n"
+        "  --duration S         Seconds to stream, zero for as long as connected (default: 10).\n"
+        "  --report-interval S  Seconds between reports (default: 1).\n"
+        "  --frame-rate HZ      Camera frame rate (default: 30, or 60 in QVGA 60 FPS depth mode).\n"
+        "  --motion-rate HZ     Gyroscope and accelerometer event rate (default: the session motion rate, when motion is requested).\n"
+        "  --color-codec NAME   Color codec: JPEG, LosslessColor, or none (default: as set up by the server).\n"
+        "  --depth-codec NAME   Depth codec: CompressedShifts, NearLosslessShifts, RANSShifts, or none (default: as set up by the server).\n"
+        "  --recording PATH     Replays the camera frames and motion events of a recorded message stream, in a loop.\n"
+        "  --metrics-port N     Serves the load generator metrics to Prometheus scrapers.\n"
+        "  --impairment SPEC    Simulates network conditions on the sent bytes, such as: bandwidth=20,latency=30,jitter=10\n"
+        "                       See NetworkImpairment, in headers/core/impairments.h. Each session draws from its own seed.\n"
+        "  --receive-pipeline-depth N\n"
+        "                       Decodes up to that many received messages, such as feedback images, while reading the next ones (default: 0).\n"
+    );
+}
+
+bool
+parseCodec (CString name, ImageCodecId& codec)
+{
+    if (0 == strcmp(name, "none"))
+    {
+        codec = ImageCodecId_Invalid;
+
+        return true;
+    }
+
+    for (int n = 0; n < ImageCodecId_HowMany; ++n)
+    {
+        if (0 != strcmp(name, imageCodecName(ImageCodecId_Enum(n))))
+            continue;
+
+        codec = ImageCodecId_Enum(n);
+
+        return true;
+    }
+
+    return false;
+}
+
+bool
+parseOptions (int argc, char* argv [], Options& options)
+{
+    for (int n = 1; n < argc; ++n)
+    {
+        const String option = argv[n];
+
+        if ('-' != option[0])
+        {
+            return_false_if(0 != options.host);
+
+            options.host = argv[n];
+
+            continue;
+        }
+
+        return_false_if(argc <= n + 1);
+
+        CString const value = argv[++n];
+
+        if      ("--port"            == option) options.port           = uint16(atoi(value));
+        else if ("--sessions"        == option) options.numSessions    = atoi(value);
+        else if ("--duration"        == option) options.duration       = atof(value);
+        else if ("--report-interval" == option) options.reportInterval = atof(value);
+        else if ("--frame-rate"      == option) options.frameRate      = atof(value);
+        else if ("--motion-rate"     == option) options.motionRate     = atof(value);
+        else if ("--recording"       == option) options.recording      = value;
+        else if ("--metrics-port"    == option) options.metricsPort    = uint16(atoi(value));
+        else if ("--receive-pipeline-depth" == option) options.receivePipelineDepth = atoi(value);
+        else if ("--color-codec"     == option) { return_false_unless(parseCodec(value, options.colorCodec)); options.overrideColorCodec = true; }
+        else if ("--depth-codec"     == option) { return_false_unless(parseCodec(value, options.depthCodec)); options.overrideDepthCodec = true; }
+        else if ("--impairment"      == option) { return_false_unless(options.impairment.parse(value)); }
+        else
+            return false;
+    }
+
+    return 0 != options.host && 0 < options.numSessions && 0. < options.reportInterval && 0 <= options.receivePipelineDepth;
+}
+
+//------------------------------------------------------------------------------
+
+// Camera frames and motion events, replayed in a loop. Images are shallow copies of the source ones.
+
+struct Footage
+{
+    std::vector<CameraFrame>        cameraFrames;
+    std::vector<GyroscopeEvent>     gyroscopeEvents;
+    std::vector<AccelerometerEvent> accelerometerEvents;
+};
+
+// Recordings are sequences of messages, as written by message serializers.
+bool
+loadRecording (CString path, Footage& footage)
+{
+    RecordingReader recording;
+
+    return_false_unless(recording.open(path));
+
+    // Only the replayed channels are read. Their images view the mapped recording, which they keep alive.
+    const std::vector<size_t>& cameraFrames        = recording.channel(MessageKind_CameraFrame);
+    const std::vector<size_t>& gyroscopeEvents     = recording.channel(MessageKind_GyroscopeEvent);
+    const std::vector<size_t>& accelerometerEvents = recording.channel(MessageKind_AccelerometerEvent);
+
+    for (size_t n = 0; n < cameraFrames.size(); ++n)
+    {
+        Message* const message = recording.readMessage(cameraFrames[n]);
+
+        report_false_unless("Cannot read the recording.", 0 != message);
+
+        footage.cameraFrames.push_back(message->as<CameraFrame>());
+    }
+
+    for (size_t n = 0; n < gyroscopeEvents.size(); ++n)
+    {
+        Message* const message = recording.readMessage(gyroscopeEvents[n]);
+
+        report_false_unless("Cannot read the recording.", 0 != message);
+
+        footage.gyroscopeEvents.push_back(message->as<GyroscopeEvent>());
+    }
+
+    for (size_t n = 0; n < accelerometerEvents.size(); ++n)
+    {
+        Message* const message = recording.readMessage(accelerometerEvents[n]);
+
+        report_false_unless("Cannot read the recording.", 0 != message);
+
+        footage.accelerometerEvents.push_back(message->as<AccelerometerEvent>());
+    }
+
+    report_false_if("No camera frames in the recording.", footage.cameraFrames.empty());
+
+    uplink_log_info("Recording: %d camera frames, %d gyroscope events, %d accelerometer events.",
+        int(footage.cameraFrames.size()), int(footage.gyroscopeEvents.size()), int(footage.accelerometerEvents.size()));
+
+    return true;
+}
+
+void
+allocateImage (Image& image, ImageFormat format, size_t width, size_t height, size_t bytesPerPixel)
+{
+    const size_t sizeInBytes = width * height * bytesPerPixel;
+
+    uplink_ref<uint8> buffer(new uint8 [sizeInBytes], [] (uint8* buffer) { delete [] buffer; });
+
+    image.format                 = format;
+    image.width                  = width;
+    image.height                 = height;
+    image.planes[0].buffer       = buffer.get();
+    image.planes[0].sizeInBytes  = sizeInBytes;
+    image.planes[0].bytesPerRow  = width * bytesPerPixel;
+    image.release                = [buffer] () {};
+    image.retain                 = [buffer] () {};
+}
+
+// A tilted wall, with a sphere sweeping across it, and a matching color gradient.
+void
+makeSyntheticCameraFrame (CameraFrame& cameraFrame, size_t depthWidth, size_t depthHeight, size_t colorWidth, size_t colorHeight, double phase)
+{
+    const double sphereX = .5 + .3 * std::cos(2. * M_PI * phase);
+    const double sphereY = .5 + .2 * std::sin(2. * M_PI * phase);
+
+    if (0 < depthWidth * depthHeight)
+    {
+        allocateImage(cameraFrame.depthImage, ImageFormat_Shifts, depthWidth, depthHeight, sizeof(uint16));
+
+        uint16* const shifts = (uint16*) cameraFrame.depthImage.planes[0].buffer;
+
+        for (size_t y = 0; y < depthHeight; ++y)
+        for (size_t x = 0; x < depthWidth ; ++x)
+        {
+            const double u = double(x) / depthWidth;
+            const double v = double(y) / depthHeight;
+
+            const double distance = std::sqrt((u - sphereX) * (u - sphereX) + (v - sphereY) * (v - sphereY));
+
+            double shift = 600. + 200. * u + 50. * v; // Wall.
+
+            if (distance < .15)
+                shift += 150. * std::sqrt(1. - (distance / .15) * (distance / .15)); // Sphere.
+
+            const bool hole = 0 == (x * 7 + y * 13) % 97; // Sparse invalid pixels.
+
+            shifts[y * depthWidth + x] = hole ? uint16(0) : uint16(shift);
+        }
+
+        cameraFrame.depthImage.cameraInfo.cmosAndEmitterDistance = 6.5f;
+        cameraFrame.depthImage.cameraInfo.referencePlaneDistance = 90.f;
+        cameraFrame.depthImage.cameraInfo.planePixelSize         = .078f;
+        cameraFrame.depthImage.cameraInfo.pixelSizeFactor        = depthWidth < 640 ? 2 : 1;
+    }
+
+    if (0 < colorWidth * colorHeight)
+    {
+        allocateImage(cameraFrame.colorImage, ImageFormat_RGB, colorWidth, colorHeight, 3);
+
+        uint8* const pixels = (uint8*) cameraFrame.colorImage.planes[0].buffer;
+
+        for (size_t y = 0; y < colorHeight; ++y)
+        for (size_t x = 0; x < colorWidth ; ++x)
+        {
+            const double u = double(x) / colorWidth;
+            const double v = double(y) / colorHeight;
+
+            const bool onSphere = (u - sphereX) * (u - sphereX) + (v - sphereY) * (v - sphereY) < .15 * .15;
+
+            uint8* const pixel = pixels + 3 * (y * colorWidth + x);
+
+            pixel[0] = onSphere ? 220 : uint8(255. * u);
+            pixel[1] = onSphere ?  60 : uint8(255. * v);
+            pixel[2] = onSphere ?  40 : uint8(128. + 64. * std::sin(20. * u));
+        }
+    }
+}
+
+void
+makeSyntheticFootage (const SessionSettings& settings, Footage& footage)
+{
+    static const int numFrames = 30; // Looped, so that generating frames does not bound the load.
+
+    size_t depthWidth  = 0;
+    size_t depthHeight = 0;
+    size_t colorWidth  = 0;
+    size_t colorHeight = 0;
+
+    switch (settings.depthMode)
+    {
+        case DepthMode_QVGA:
+        case DepthMode_QVGA_60FPS: depthWidth = 320; depthHeight = 240; break;
+        case DepthMode_VGA       : depthWidth = 640; depthHeight = 480; break;
+        default                  : break;
+    }
+
+    switch (settings.colorMode)
+    {
+        case ColorMode_640x480 : colorWidth =  640; colorHeight = 480; break;
+        case ColorMode_1296x968: colorWidth = 1296; colorHeight = 968; break;
+        default                : break;
+    }
+
+    footage.cameraFrames.resize(numFrames);
+
+    for (int n = 0; n < numFrames; ++n)
+        makeSyntheticCameraFrame(footage.cameraFrames[n], depthWidth, depthHeight, colorWidth, colorHeight, double(n) / numFrames);
+}
+
+//------------------------------------------------------------------------------
+
+struct LoadSession : ClientEndpoint
+{
+public:
+    LoadSession (const Options& options, const Footage& recordedFootage, int index);
+    ~LoadSession ();
+
+public:
+    bool connect ();
+
+    // Metrics since connection.
+    uint64 numSentCameraFrames    () const { return channelStats[MessageKind_CameraFrame].sending.messages->value(); }
+    uint64 numSentBytes           () const;
+    uint64 numSentMotionEvents    () const;
+    uint64 numDroppedCameraFrames () const { return cameraFrameQueue.getNumDropped(); }
+    bool   isStreaming            () const { const MutexLocker _(mutex); return streaming; }
+
+    const MetricHistogram& cameraFrameLatencies () const { return *channelStats[MessageKind_CameraFrame].sending.ages; }
+
+public:
+    virtual void disconnected ();
+    virtual bool setupSession (const SessionSettings& nextSessionSettings);
+    virtual void onSessionSetupSuccess ();
+    virtual void onSessionSetupFailure ();
+    virtual void onCustomCommand (const String& command);
+    virtual bool onMessage (const Message& message);
+
+private:
+    struct Streamer : Thread
+    {
+        Streamer (LoadSession* that) : Thread("uplink::LoadSession::Streamer"), that(that) {}
+        ~Streamer () { join(); }
+
+        virtual void run () { that->stream(); }
+
+        LoadSession* that;
+    };
+
+    void stream ();
+    void overrideCodec (CString what, ImageCodecId codec, ImageCodecId& sessionCodec, uint32& sessionCodecs);
+
+private:
+    const Options&  options;
+    const Footage&  recordedFootage;
+    const int       index;
+    mutable Mutex   mutex;
+    bool            streaming;
+    int             numSetups;       // Bumped on each successful session setup.
+    SessionSettings settings;        // As set up last.
+    double          frameRate;
+    double          motionRate;
+    Footage         syntheticFootage; // Streamer thread only.
+    Streamer        streamer;
+};
+
+inline
+LoadSession::LoadSession (const Options& options, const Footage& recordedFootage, int index)
+    : options(options)
+    , recordedFootage(recordedFootage)
+    , index(index)
+    , streaming(false)
+    , numSetups(0)
+    , frameRate(0.)
+    , motionRate(0.)
+    , streamer(this)
+{
+    // Same desktop codecs as the server sessions.
+    imageCodecs.jpeg.compressInputFormat = ImageFormat_RGB;
+    imageCodecs.jpeg.compress   = compress_image_RGB_JPEG;
+    imageCodecs.jpeg.decompressOutputFormat = ImageFormat_RGB;
+    imageCodecs.jpeg.decompress = decompress_image_JPEG_RGB;
+
+    receivePipelineDepth = options.receivePipelineDepth;
+}
+
+inline
+LoadSession::~LoadSession ()
+{
+    streamer.join();
+
+    // Stopping now, rather than from the endpoint destructor, while the disconnection callbacks can still reach this session.
+    if (0 != wire)
+        wire->stop();
+}
+
+inline bool
+LoadSession::connect ()
+{
+    TCPConnection* connection = TCPConnection::connect(options.host, options.port);
+
+    if (0 == connection)
+    {
+        uplink_log_error("Session %d: cannot connect to %s:%d.", index, options.host, int(options.port));
+
+        return false;
+    }
+
+    if (!options.impairment.isNone())
+    {
+        NetworkImpairment impairment = options.impairment;
+
+        impairment.seed += uint32(index);
+
+        connection = new ImpairedConnection(connection, impairment);
+    }
+
+    (new Wire(connection, this))->start(); // The endpoint owns its wire.
+
+    streamer.start();
+
+    return true;
+}
+
+inline uint64
+LoadSession::numSentBytes () const
+{
+    uint64 bytes = 0;
+
+    for (int kind = 0; kind < MessageKind_HowMany; ++kind)
+        bytes += channelStats[kind].sending.bytes->value();
+
+    return bytes;
+}
+
+inline uint64
+LoadSession::numSentMotionEvents () const
+{
+    return channelStats[MessageKind_GyroscopeEvent    ].sending.messages->value()
+         + channelStats[MessageKind_AccelerometerEvent].sending.messages->value()
+         ;
+}
+
+inline void
+LoadSession::disconnected ()
+{
+    uplink_log_info("Session %d: disconnected.", index);
+
+    const MutexLocker _(mutex);
+
+    streaming = false;
+}
+
+inline bool
+LoadSession::setupSession (const SessionSettings& nextSessionSettings)
+{
+    return ClientEndpoint::setupSession(nextSessionSettings);
+}
+
+inline void
+LoadSession::overrideCodec (CString what, ImageCodecId codec, ImageCodecId& sessionCodec, uint32& sessionCodecs)
+{
+    // Servers only accept the codecs they advertised.
+    const bool accepted = ImageCodecId_Invalid == codec
+        ? 0 != (sessionCodecs & UncompressedImageCodecBit)
+        : codec == sessionCodec || 0 != (sessionCodecs & imageCodecBit(codec))
+        ;
+
+    if (!accepted)
+    {
+        uplink_log_warning("Session %d: the server does not accept %s %s images, keeping the session codec.", index, ImageCodecId_Invalid == codec ? "uncompressed" : imageCodecName(codec), what);
+
+        return;
+    }
+
+    sessionCodec  = codec;
+    sessionCodecs = ImageCodecId_Invalid == codec ? UncompressedImageCodecBit : 0; // No other candidates.
+}
+
+inline void
+LoadSession::onSessionSetupSuccess ()
+{
+    if (options.overrideColorCodec)
+        overrideCodec("color", options.colorCodec, currentSessionSettings.colorCameraCodec, currentSessionSettings.colorCameraCodecs);
+
+    if (options.overrideDepthCodec)
+        overrideCodec("depth", options.depthCodec, currentSessionSettings.depthCameraCodec, currentSessionSettings.depthCameraCodecs);
+
+    const MutexLocker _(mutex);
+
+    frameRate = 0. < options.frameRate
+        ? options.frameRate
+        : DepthMode_QVGA_60FPS == currentSessionSettings.depthMode ? 60. : 30.
+        ;
+
+    motionRate = 0. <= options.motionRate
+        ? options.motionRate
+        : currentSessionSettings.sendMotion ? double(currentSessionSettings.motionRate) : 0.
+        ;
+
+    settings = currentSessionSettings;
+
+    streaming = true;
+
+    ++numSetups;
+
+    uplink_log_info("Session %d: streaming at %.1f Hz, with %.1f Hz motion.", index, frameRate, motionRate);
+}
+
+inline void
+LoadSession::onSessionSetupFailure ()
+{
+    uplink_log_error("Session %d: session setup failed.", index);
+}
+
+inline void
+LoadSession::onCustomCommand (const String&)
+{
+    // Servers send user interface commands, meant for the capture app.
+}
+
+inline bool
+LoadSession::onMessage (const Message&)
+{
+    return true; // Feedback images and the like are counted, then ignored.
+}
+
+inline void
+LoadSession::stream ()
+{
+    int    setup      = 0;
+    double nextFrame  = 0.;
+    double nextMotion = 0.;
+    size_t frameIndex = 0;
+    size_t gyroscopeIndex = 0;
+    size_t accelerometerIndex = 0;
+
+    while (streamer.isRunning() && isConnected())
+    {
+        double framePeriod  = 0.;
+        double motionPeriod = 0.;
+
+        {
+            const MutexLocker _(mutex);
+
+            if (!streaming)
+            {
+                Thread::sleep(.01f);
+
+                continue;
+            }
+
+            if (setup != numSetups)
+            {
+                setup = numSetups;
+
+                if (0 == recordedFootage.cameraFrames.size())
+                {
+                    syntheticFootage = Footage();
+
+                    makeSyntheticFootage(settings, syntheticFootage);
+                }
+
+                nextFrame  = getTime();
+                nextMotion = nextFrame;
+            }
+
+            framePeriod  = 1. / frameRate;
+            motionPeriod = 0. < motionRate ? 1. / motionRate : 0.;
+        }
+
+        const Footage& footage = recordedFootage.cameraFrames.empty() ? syntheticFootage : recordedFootage;
+
+        const double now = getTime();
+
+        if (nextFrame <= now && !footage.cameraFrames.empty())
+        {
+            CameraFrame cameraFrame = footage.cameraFrames[frameIndex++ % footage.cameraFrames.size()];
+
+            // Fresh capture times, so that ages are measured from now.
+            cameraFrame.depthImage.cameraInfo.timestamp = now;
+            cameraFrame.depthImage.cameraInfo.duration  = framePeriod;
+            cameraFrame.colorImage.cameraInfo.timestamp = now;
+            cameraFrame.colorImage.cameraInfo.duration  = framePeriod;
+
+            sendCameraFrame(cameraFrame);
+
+            nextFrame += framePeriod;
+
+            if (nextFrame < now) // Fell behind: skip ticks rather than bursting.
+                nextFrame = now + framePeriod;
+        }
+
+        if (0. < motionPeriod && nextMotion <= now)
+        {
+            GyroscopeEvent     gyroscopeEvent;
+            AccelerometerEvent accelerometerEvent;
+
+            if (!footage.gyroscopeEvents.empty())
+            {
+                gyroscopeEvent.value = footage.gyroscopeEvents[gyroscopeIndex++ % footage.gyroscopeEvents.size()].value;
+            }
+            else
+            {
+                gyroscopeEvent.value.x = .1 * std::sin(now);
+                gyroscopeEvent.value.y = .1 * std::cos(now);
+                gyroscopeEvent.value.z = 0.;
+            }
+
+            if (!footage.accelerometerEvents.empty())
+            {
+                accelerometerEvent.value = footage.accelerometerEvents[accelerometerIndex++ % footage.accelerometerEvents.size()].value;
+            }
+            else
+            {
+                accelerometerEvent.value.x = 0.;
+                accelerometerEvent.value.y = -1.;
+                accelerometerEvent.value.z = .01 * std::sin(now);
+            }
+
+            gyroscopeEvent    .timestamp = now;
+            accelerometerEvent.timestamp = now;
+
+            sendGyroscopeEvent(gyroscopeEvent);
+            sendAccelerometerEvent(accelerometerEvent);
+
+            nextMotion += motionPeriod;
+
+            if (nextMotion < now)
+                nextMotion = now + motionPeriod;
+        }
+
+        const double next = 0. < motionPeriod ? std::min(nextFrame, nextMotion) : nextFrame;
+
+        Thread::sleep(float(std::max(0., std::min(next - getTime(), .001))));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+struct Totals
+{
+    Totals ()
+    : numConnected(0)
+    , numStreaming(0)
+    , numCameraFrames(0)
+    , numDroppedCameraFrames(0)
+    , numMotionEvents(0)
+    , numBytes(0)
+    {
+    }
+
+    void add (const LoadSession& session)
+    {
+        numConnected           += session.isConnected() ? 1 : 0;
+        numStreaming           += session.isStreaming() ? 1 : 0;
+        numCameraFrames        += session.numSentCameraFrames();
+        numDroppedCameraFrames += session.numDroppedCameraFrames();
+        numMotionEvents        += session.numSentMotionEvents();
+        numBytes               += session.numSentBytes();
+    }
+
+    int    numConnected;
+    int    numStreaming;
+    uint64 numCameraFrames;
+    uint64 numDroppedCameraFrames;
+    uint64 numMotionEvents;
+    uint64 numBytes;
+};
+
+// Percentile of the merged latencies of all sessions, in seconds.
+double
+latencyPercentile (const std::vector<LoadSession*>& sessions, double fraction)
+{
+    uint64 counts [MetricHistogram::NumBuckets] = { 0 };
+    uint64 count = 0;
+
+    for (size_t s = 0; s < sessions.size(); ++s)
+    {
+        for (int n = 0; n < MetricHistogram::NumBuckets; ++n)
+        {
+            const uint64 bucket = sessions[s]->cameraFrameLatencies().bucket(n);
+
+            counts[n] += bucket;
+            count     += bucket;
+        }
+    }
+
+    return_zero_if(0 == count);
+
+    const uint64 rank = std::max(uint64(1), uint64(std::ceil(fraction * double(count))));
+
+    uint64 cumulated = 0;
+
+    for (int n = 0; n < MetricHistogram::NumBuckets; ++n)
+    {
+        cumulated += counts[n];
+
+        if (rank <= cumulated)
+            return MetricHistogram::upperBound(n);
+    }
+
+    return MetricHistogram::upperBound(MetricHistogram::NumBuckets - 1);
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+int
+main (int argc, char* argv [])
+{
+    Options options;
+
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+
+        return 1;
+    }
+
+    Footage recordedFootage;
+
+    if (0 != options.recording && !loadRecording(options.recording, recordedFootage))
+        return 1;
+
+    std::unique_ptr<MetricsServer> metricsServer;
+
+    if (0 != options.metricsPort)
+    {
+        metricsServer.reset(new MetricsServer(context.metrics()));
+
+        if (!metricsServer->startListening(options.metricsPort))
+            return 1;
+    }
+
+    std::vector<LoadSession*> sessions;
+
+    for (int n = 0; n < options.numSessions; ++n)
+    {
+        LoadSession* const session = new LoadSession(options, recordedFootage, n);
+
+        if (!session->connect())
+        {
+            delete session;
+
+            continue;
+        }
+
+        sessions.push_back(session);
+    }
+
+    if (sessions.empty())
+    {
+        fprintf(stderr, "No session could connect to %s:%d.\n", options.host, int(options.port));
+
+        return 1;
+    }
+
+    printf("%d of %d sessions connected to %s:%d.\n", int(sessions.size()), options.numSessions, options.host, int(options.port));
+
+    if (!options.impairment.isNone())
+        printf("Impairment: %s\n", options.impairment.toString().c_str());
+
+    const double start = getTime();
+
+    Totals previous;
+    double previousTime = start;
+
+    for (;;)
+    {
+        Thread::sleep(float(options.reportInterval));
+
+        Totals totals;
+
+        for (size_t n = 0; n < sessions.size(); ++n)
+            totals.add(*sessions[n]);
+
+        const double now     = getTime();
+        const double elapsed = now - previousTime;
+
+        printf("%7.1f s | sessions: %d connected, %d streaming | frames: %8.1f Hz, %6llu dropped | motion: %8.1f Hz | %8.2f Mb/s | capture to send: p50 %6.1f ms, p99 %6.1f ms\n",
+            now - start,
+            totals.numConnected,
+            totals.numStreaming,
+            double(totals.numCameraFrames - previous.numCameraFrames) / elapsed,
+            (unsigned long long) totals.numDroppedCameraFrames,
+            double(totals.numMotionEvents - previous.numMotionEvents) / elapsed,
+            8e-6 * double(totals.numBytes - previous.numBytes) / elapsed,
+            1e3 * latencyPercentile(sessions, .5),
+            1e3 * latencyPercentile(sessions, .99)
+        );
+
+        previous     = totals;
+        previousTime = now;
+
+        if (0 == totals.numConnected)
+            break;
+
+        if (0. < options.duration && options.duration <= now - start)
+            break;
+    }
+
+    const double elapsed = getTime() - start;
+
+    printf("\nSession   Frames   Dropped   Frame rate   Motion rate   Throughput\n");
+
+    Totals totals;
+
+    for (size_t n = 0; n < sessions.size(); ++n)
+    {
+        const LoadSession& session = *sessions[n];
+
+        totals.add(session);
+
+        printf("%7d %8llu %9llu %9.1f Hz %10.1f Hz %8.2f Mb/s\n",
+            int(n),
+            (unsigned long long) session.numSentCameraFrames(),
+            (unsigned long long) session.numDroppedCameraFrames(),
+            double(session.numSentCameraFrames()) / elapsed,
+            double(session.numSentMotionEvents()) / elapsed,
+            8e-6 * double(session.numSentBytes()) / elapsed
+        );
+    }
+
+    printf("  Total %8llu %9llu %9.1f Hz %10.1f Hz %8.2f Mb/s\n",
+        (unsigned long long) totals.numCameraFrames,
+        (unsigned long long) totals.numDroppedCameraFrames,
+        double(totals.numCameraFrames) / elapsed,
+        double(totals.numMotionEvents) / elapsed,
+        8e-6 * double(totals.numBytes) / elapsed
+    );
+
+    printf("\nCapture to send latency: p50 %.1f ms, p90 %.1f ms, p99 %.1f ms.\n",
+        1e3 * latencyPercentile(sessions, .5),
+        1e3 * latencyPercentile(sessions, .9),
+        1e3 * latencyPercentile(sessions, .99)
+    );
+
+    for (size_t n = 0; n < sessions.size(); ++n)
+        delete sessions[n];
+
+    return 0;
+}
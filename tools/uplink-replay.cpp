@@ -0,0 +1,663 @@
+// This file is part of Uplink, an easy-to-use cross-platform live RGBD streaming protocol.
+// Copyright (c) 2016, Occipital, Inc.  All rights reserved.
+// License: See LICENSE.
+
+// Recording player, standing in for a capture device.
+// Connects to a server, answers its session setups like the capture app does, then sends the messages of an
+// indexed recording through the regular endpoint and wire, with their recorded pacing, faster, or as fast as possible.
+
+#include <uplink.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace uplink;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+struct Options
+{
+    Options ()
+    : host(0)
+    , recording(0)
+    , port(6666)
+    , speed(1.)
+    , numLoops(1)
+    , from(0.)
+    , to(0.)
+    , reportInterval(1.)
+    , metricsPort(0)
+    {
+    }
+
+    CString           host;
+    CString           recording;
+    uint16            port;
+    double            speed;          // Zero replays as fast as the wire sends.
+    int               numLoops;       // Zero loops until disconnected.
+    double            from;           // Seconds from the start of the recording.
+    double            to;             // Zero replays up to the end.
+    double            reportInterval; // Seconds.
+    uint16            metricsPort;
+    NetworkImpairment impairment;     // Of the sent bytes.
+};
+
+void
+printUsage ()
+{
+    fprintf(stderr,
+        "Usage: uplink-replay [options] recording host\n"
+        "\n"
+        "  --port N             Server port (default: 6666).\n"
+        "  --speed X            Pacing, relative to the recording: 1 is real time, 2 twice as fast (default: 1).\n"
+        "                       Zero sends as fast as the wire goes, waiting for queue room instead of dropping messages.\n"
+        "  --loops N            Replays, zero looping until disconnected (default: 1).\n"
+        "  --from S             Starts that many seconds into the recording (default: 0).\n"
+        "  --to S               Stops that many seconds into the recording (default: the end).\n"
+        "  --report-interval S  Seconds between reports (default: 1).\n"
+        "  --metrics-port N     Serves the player metrics to Prometheus scrapers.\n"
+        "  --impairment SPEC    Simulates network conditions on the sent bytes, such as: bandwidth=20,latency=30,jitter=10\n"
+        "                       See NetworkImpairment, in headers/core/impairments.h.\n"
+    );
+}
+
+bool
+parseOptions (int argc, char* argv [], Options& options)
+{
+    for (int n = 1; n < argc; ++n)
+    {
+        const String option = argv[n];
+
+        if ('-' != option[0])
+        {
+            if (0 == options.recording)
+                options.recording = argv[n];
+            else if (0 == options.host)
+                options.host = argv[n];
+            else
+                return false;
+
+            continue;
+        }
+
+        return_false_if(argc <= n + 1);
+
+        CString const value = argv[++n];
+
+        if      ("--port"            == option) options.port           = uint16(atoi(value));
+        else if ("--speed"           == option) options.speed          = atof(value);
+        else if ("--loops"           == option) options.numLoops       = atoi(value);
+        else if ("--from"            == option) options.from           = atof(value);
+        else if ("--to"              == option) options.to             = atof(value);
+        else if ("--report-interval" == option) options.reportInterval = atof(value);
+        else if ("--metrics-port"    == option) options.metricsPort    = uint16(atoi(value));
+        else if ("--impairment"      == option) { return_false_unless(options.impairment.parse(value)); }
+        else
+            return false;
+    }
+
+    return 0 != options.recording
+        && 0 != options.host
+        && 0. <= options.speed
+        && 0 <= options.numLoops
+        && 0. <= options.from
+        && 0. < options.reportInterval
+        ;
+}
+
+// Messages capture devices send. Session management and commands are left to the live endpoints.
+bool
+isReplayed (MessageKind kind)
+{
+    switch (kind)
+    {
+        case MessageKind_CameraFrame:
+        case MessageKind_Image:
+        case MessageKind_CameraPose:
+        case MessageKind_GyroscopeEvent:
+        case MessageKind_AccelerometerEvent:
+        case MessageKind_DeviceMotionEvent:
+        case MessageKind_Blob:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+struct ReplaySession : ClientEndpoint
+{
+public:
+    ReplaySession (const Options& options, RecordingReader& recording, size_t first, size_t last);
+    ~ReplaySession ();
+
+public:
+    bool connect ();
+
+    // Metrics since connection.
+    uint64 numSentCameraFrames    () const { return channelStats[MessageKind_CameraFrame].sending.messages->value(); }
+    uint64 numSentMessages        () const;
+    uint64 numSentBytes           () const;
+    uint64 numSentMotionEvents    () const;
+    uint64 numDroppedCameraFrames () const { return cameraFrameQueue.getNumDropped(); }
+    uint64 numSkippedCameraFrames () const { const MutexLocker _(mutex); return skippedCameraFrames; }
+
+    const MetricHistogram& cameraFrameLatencies () const { return *channelStats[MessageKind_CameraFrame].sending.ages; }
+
+    bool   isFinished () const { const MutexLocker _(mutex); return finished; }
+    double position   () const { const MutexLocker _(mutex); return replayedTime; } // Seconds into the recording.
+    int    loop       () const { const MutexLocker _(mutex); return replayedLoop; }
+    double duration   () const; // Seconds of playback, session setup excluded.
+
+public:
+    virtual void disconnected ();
+    virtual bool setupSession (const SessionSettings& nextSessionSettings);
+    virtual void onSessionSetupSuccess ();
+    virtual void onSessionSetupFailure ();
+    virtual void onCustomCommand (const String& command);
+    virtual bool onMessage (const Message& message);
+
+private:
+    struct Player : Thread
+    {
+        Player (ReplaySession* that) : Thread("uplink::ReplaySession::Player"), that(that) {}
+        ~Player () { join(); }
+
+        virtual void run () { that->play(); }
+
+        ReplaySession* that;
+    };
+
+    void play ();
+    bool waitUntil (double time);
+    void send (const Message& message, double now);
+    bool accepts (CString what, const Image& image, ImageCodecId sessionCodec, uint32 sessionCodecs, bool& warned);
+
+    // As fast as possible only goes as fast as the wire, rather than dropping messages.
+    template < class Item >
+    void waitForRoom (const Queue<Item>& queue)
+    {
+        static const int maxNumQueuedItems = 8; // Unbounded queues included.
+
+        while (player.isRunning() && isConnected() && (1.f <= queue.getUsageRatio() || maxNumQueuedItems <= queue.getSize()))
+            Thread::sleep(.0001f);
+    }
+
+private:
+    const Options&   options;
+    RecordingReader& recording; // Player thread only, once started.
+    const size_t     first;
+    const size_t     last;
+    mutable Mutex    mutex;
+    bool             streaming;
+    bool             finished;
+    double           replayedTime;
+    int              replayedLoop;
+    double           playStart;
+    double           playEnd;
+    uint64           skippedCameraFrames;
+    bool             warnedColorCodec; // Player thread only.
+    bool             warnedDepthCodec;
+    Player           player;
+};
+
+inline
+ReplaySession::ReplaySession (const Options& options, RecordingReader& recording, size_t first, size_t last)
+    : options(options)
+    , recording(recording)
+    , first(first)
+    , last(last)
+    , streaming(false)
+    , finished(false)
+    , replayedTime(0.)
+    , replayedLoop(0)
+    , playStart(0.)
+    , playEnd(0.)
+    , skippedCameraFrames(0)
+    , warnedColorCodec(false)
+    , warnedDepthCodec(false)
+    , player(this)
+{
+    assert(first < last);
+
+    // Same desktop codecs as the server sessions.
+    imageCodecs.jpeg.compressInputFormat = ImageFormat_RGB;
+    imageCodecs.jpeg.compress   = compress_image_RGB_JPEG;
+    imageCodecs.jpeg.decompressOutputFormat = ImageFormat_RGB;
+    imageCodecs.jpeg.decompress = decompress_image_JPEG_RGB;
+}
+
+inline
+ReplaySession::~ReplaySession ()
+{
+    player.join();
+
+    // Stopping now, rather than from the endpoint destructor, while the disconnection callbacks can still reach this session.
+    if (0 != wire)
+        wire->stop();
+}
+
+inline bool
+ReplaySession::connect ()
+{
+    TCPConnection* connection = TCPConnection::connect(options.host, options.port);
+
+    if (0 == connection)
+    {
+        uplink_log_error("Cannot connect to %s:%d.", options.host, int(options.port));
+
+        return false;
+    }
+
+    if (!options.impairment.isNone())
+        connection = new ImpairedConnection(connection, options.impairment);
+
+    (new Wire(connection, this))->start(); // The endpoint owns its wire.
+
+    player.start();
+
+    return true;
+}
+
+inline uint64
+ReplaySession::numSentMessages () const
+{
+    uint64 messages = 0;
+
+    for (int kind = 0; kind < MessageKind_HowMany; ++kind)
+        if (isReplayed(MessageKind_Enum(kind)))
+            messages += channelStats[kind].sending.messages->value();
+
+    return messages;
+}
+
+inline uint64
+ReplaySession::numSentBytes () const
+{
+    uint64 bytes = 0;
+
+    for (int kind = 0; kind < MessageKind_HowMany; ++kind)
+        bytes += channelStats[kind].sending.bytes->value();
+
+    return bytes;
+}
+
+inline uint64
+ReplaySession::numSentMotionEvents () const
+{
+    return channelStats[MessageKind_GyroscopeEvent    ].sending.messages->value()
+         + channelStats[MessageKind_AccelerometerEvent].sending.messages->value()
+         + channelStats[MessageKind_DeviceMotionEvent ].sending.messages->value()
+         ;
+}
+
+inline double
+ReplaySession::duration () const
+{
+    const MutexLocker _(mutex);
+
+    if (0. == playStart)
+        return 0.;
+
+    return (0. < playEnd ? playEnd : getTime()) - playStart;
+}
+
+inline void
+ReplaySession::disconnected ()
+{
+    uplink_log_info("Disconnected.");
+
+    const MutexLocker _(mutex);
+
+    streaming = false;
+}
+
+inline bool
+ReplaySession::setupSession (const SessionSettings& nextSessionSettings)
+{
+    return ClientEndpoint::setupSession(nextSessionSettings);
+}
+
+inline bool
+ReplaySession::accepts (CString what, const Image& image, ImageCodecId sessionCodec, uint32 sessionCodecs, bool& warned)
+{
+    return_true_unless(image.isCompressed()); // The endpoint compresses the others as set up.
+
+    const ImageCodecId codec = imageCodecs.decompressorOf(image.format);
+
+    // Recorded images are sent as they were captured, and servers only accept the codecs they advertised.
+    return_true_if(ImageCodecId_Invalid != codec && (codec == sessionCodec || 0 != (sessionCodecs & imageCodecBit(codec))));
+
+    if (!warned)
+        uplink_log_warning("The server does not accept the recorded %s images: skipping their camera frames.", what);
+
+    warned = true;
+
+    return false;
+}
+
+inline void
+ReplaySession::onSessionSetupSuccess ()
+{
+    const MutexLocker _(mutex);
+
+    streaming = true;
+}
+
+inline void
+ReplaySession::onSessionSetupFailure ()
+{
+    uplink_log_error("Session setup failed.");
+}
+
+inline void
+ReplaySession::onCustomCommand (const String&)
+{
+    // Servers send user interface commands, meant for the capture app.
+}
+
+inline bool
+ReplaySession::onMessage (const Message&)
+{
+    return true; // Feedback images and the like are counted, then ignored.
+}
+
+inline bool
+ReplaySession::waitUntil (double time)
+{
+    for (;;)
+    {
+        return_false_unless(player.isRunning() && isConnected());
+
+        const double wait = time - getTime();
+
+        return_true_if(wait <= 0.);
+
+        Thread::sleep(float(std::min(wait, .01)));
+    }
+}
+
+inline void
+ReplaySession::send (const Message& message, double now)
+{
+    // Fresh capture times, so that ages are measured from the replay.
+    switch (message.kind())
+    {
+        case MessageKind_CameraFrame:
+        {
+            CameraFrame cameraFrame = message.as<CameraFrame>(); // Shallow, the images view the recording.
+
+            if (!accepts("color", cameraFrame.colorImage, currentSessionSettings.colorCameraCodec, currentSessionSettings.colorCameraCodecs, warnedColorCodec)
+             || !accepts("depth", cameraFrame.depthImage, currentSessionSettings.depthCameraCodec, currentSessionSettings.depthCameraCodecs, warnedDepthCodec))
+            {
+                const MutexLocker _(mutex);
+
+                ++skippedCameraFrames;
+
+                break;
+            }
+
+            if (!cameraFrame.depthImage.isEmpty())
+                cameraFrame.depthImage.cameraInfo.timestamp = now;
+
+            if (!cameraFrame.colorImage.isEmpty())
+                cameraFrame.colorImage.cameraInfo.timestamp = now;
+
+            if (0. == options.speed)
+                waitForRoom(cameraFrameQueue);
+
+            sendCameraFrame(cameraFrame);
+
+            break;
+        }
+
+        case MessageKind_Image:
+        {
+            Image image = message.as<Image>();
+
+            image.cameraInfo.timestamp = now;
+
+            if (0. == options.speed)
+                waitForRoom(imageQueue);
+
+            sendImage(image);
+
+            break;
+        }
+
+# define REPLAY_TIMESTAMPED(Name, name) \
+        case MessageKind_##Name: \
+        { \
+            Name name = message.as<Name>(); \
+            \
+            name.timestamp = now; \
+            \
+            if (0. == options.speed) \
+                waitForRoom(name##Queue); \
+            \
+            send##Name(name); \
+            \
+            break; \
+        }
+        REPLAY_TIMESTAMPED(CameraPose        , cameraPose        )
+        REPLAY_TIMESTAMPED(GyroscopeEvent    , gyroscopeEvent    )
+        REPLAY_TIMESTAMPED(AccelerometerEvent, accelerometerEvent)
+        REPLAY_TIMESTAMPED(DeviceMotionEvent , deviceMotionEvent )
+# undef  REPLAY_TIMESTAMPED
+
+        case MessageKind_Blob:
+        {
+            Blob blob = message.as<Blob>();
+
+            if (0. == options.speed)
+                waitForRoom(blobQueue);
+
+            sendBlob(blob);
+
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+inline void
+ReplaySession::play ()
+{
+    while (player.isRunning() && isConnected())
+    {
+        {
+            const MutexLocker _(mutex);
+
+            if (streaming)
+                break;
+        }
+
+        Thread::sleep(.01f);
+    }
+
+    const double startTime = recording.startTime();
+    const double firstTime = recording.entry(first).receptionTime;
+
+    {
+        const MutexLocker _(mutex);
+
+        playStart = getTime();
+    }
+
+    for (int loop = 0; 0 == options.numLoops || loop < options.numLoops; ++loop)
+    {
+        const double start = getTime();
+
+        for (size_t n = first; n < last; ++n)
+        {
+            const RecordingIndexEntry& entry = recording.entry(n);
+
+            if (!isReplayed(MessageKind_Enum(entry.kind)))
+                continue;
+
+            // Recorded reception times reproduce the pacing of the messages, as they arrived from the capture device.
+            if (0. < options.speed && !waitUntil(start + (entry.receptionTime - firstTime) / options.speed))
+                return;
+
+            return_unless(player.isRunning() && isConnected());
+
+            const Message* const message = recording.readMessage(n);
+
+            if (0 == message)
+                continue;
+
+            send(*message, getTime());
+
+            const MutexLocker _(mutex);
+
+            replayedTime = entry.receptionTime - startTime;
+            replayedLoop = loop;
+        }
+    }
+
+    const MutexLocker _(mutex);
+
+    playEnd  = getTime();
+    finished = true;
+}
+
+//------------------------------------------------------------------------------
+
+// Percentile of the capture to send latencies, in milliseconds.
+double
+latencyPercentile (const ReplaySession& session, double fraction)
+{
+    return 1e3 * session.cameraFrameLatencies().percentile(fraction);
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+int
+main (int argc, char* argv [])
+{
+    Options options;
+
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+
+        return 1;
+    }
+
+    RecordingReader recording;
+
+    if (!recording.open(options.recording))
+        return 1;
+
+    const double duration = recording.endTime() - recording.startTime();
+
+    const size_t first = recording.seek(recording.startTime() + options.from);
+    const size_t last  = 0. < options.to ? recording.seek(recording.startTime() + options.to) : recording.numMessages();
+
+    if (last <= first)
+    {
+        fprintf(stderr, "No messages to replay between %.1f s and %.1f s: the recording lasts %.1f s.\n", options.from, 0. < options.to ? options.to : duration, duration);
+
+        return 1;
+    }
+
+    printf("%s: %d messages, %d camera frames, %.1f s.\n",
+        options.recording,
+        int(recording.numMessages()),
+        int(recording.channel(MessageKind_CameraFrame).size()),
+        duration
+    );
+
+    std::unique_ptr<MetricsServer> metricsServer;
+
+    if (0 != options.metricsPort)
+    {
+        metricsServer.reset(new MetricsServer(context.metrics()));
+
+        if (!metricsServer->startListening(options.metricsPort))
+            return 1;
+    }
+
+    std::unique_ptr<ReplaySession> session(new ReplaySession(options, recording, first, last));
+
+    if (!session->connect())
+        return 1;
+
+    if (0. == options.speed)
+        printf("Replaying to %s:%d, as fast as possible.\n", options.host, int(options.port));
+    else
+        printf("Replaying to %s:%d, at %gx speed.\n", options.host, int(options.port), options.speed);
+
+    if (!options.impairment.isNone())
+        printf("Impairment: %s\n", options.impairment.toString().c_str());
+
+    const double start = getTime();
+
+    uint64 previousFrames       = 0;
+    uint64 previousMotionEvents = 0;
+    uint64 previousBytes        = 0;
+    double previousTime         = start;
+
+    for (;;)
+    {
+        Thread::sleep(float(options.reportInterval));
+
+        const uint64 frames       = session->numSentCameraFrames();
+        const uint64 motionEvents = session->numSentMotionEvents();
+        const uint64 bytes        = session->numSentBytes();
+
+        const double now     = getTime();
+        const double elapsed = now - previousTime;
+
+        printf("%7.1f s | loop %d, at %7.1f s | frames: %8.1f Hz, %6llu dropped | motion: %8.1f Hz | %8.2f Mb/s | capture to send: p50 %6.1f ms, p99 %6.1f ms\n",
+            now - start,
+            session->loop() + 1,
+            session->position(),
+            double(frames - previousFrames) / elapsed,
+            (unsigned long long) session->numDroppedCameraFrames(),
+            double(motionEvents - previousMotionEvents) / elapsed,
+            8e-6 * double(bytes - previousBytes) / elapsed,
+            latencyPercentile(*session, .5),
+            latencyPercentile(*session, .99)
+        );
+
+        previousFrames       = frames;
+        previousMotionEvents = motionEvents;
+        previousBytes        = bytes;
+        previousTime         = now;
+
+        if (!session->isConnected() || session->isFinished())
+            break;
+    }
+
+    const double elapsed = std::max(1e-3, session->duration());
+
+    const double replayed = (recording.entry(last - 1).receptionTime - recording.entry(first).receptionTime) * double(std::max(1, session->loop() + 1));
+
+    printf("\nReplayed %llu messages, %llu camera frames (%llu dropped, %llu skipped), in %.2f s: %.2fx the recorded pace, %.1f frames/s, %.2f Mb/s.\n",
+        (unsigned long long) session->numSentMessages(),
+        (unsigned long long) session->numSentCameraFrames(),
+        (unsigned long long) session->numDroppedCameraFrames(),
+        (unsigned long long) session->numSkippedCameraFrames(),
+        elapsed,
+        replayed / elapsed,
+        double(session->numSentCameraFrames()) / elapsed,
+        8e-6 * double(session->numSentBytes()) / elapsed
+    );
+
+    printf("Capture to send latency: p50 %.1f ms, p90 %.1f ms, p99 %.1f ms.\n",
+        latencyPercentile(*session, .5),
+        latencyPercentile(*session, .9),
+        latencyPercentile(*session, .99)
+    );
+
+    return 0;
+}